@@ -6,9 +6,12 @@
 
 #include "core.h"
 
+#include <QDataStream>
 #include <QDir>
 #include <QNetworkInterface>
 #include <QProgressBar>
+#include <QSaveFile>
+#include <QSharedPointer>
 
 #include <KIO/CopyJob>
 #include <KIO/StoredTransferJob>
@@ -45,6 +48,7 @@
 #include <util/fileops.h>
 #include <util/functions.h>
 #include <util/log.h>
+#include <util/tracer.h>
 #include <util/waitjob.h>
 #include <utp/utpserver.h>
 
@@ -53,6 +57,14 @@ using namespace bt;
 namespace kt
 {
 const Uint32 CORE_UPDATE_INTERVAL = 250;
+const Uint32 CORE_IDLE_UPDATE_INTERVAL = 1000; // when none of the running torrents has any traffic
+const Uint32 CORE_BUSY_UPDATE_INTERVAL = 100; // under heavy traffic
+const Uint32 CORE_BUSY_RATE = 10 * 1024 * 1024; // download and upload rate together above which the traffic is heavy
+const Uint32 CORE_IDLE_TICKS = 8; // number of updates without traffic before slowing down
+const int LOAD_BATCH_SIZE = 50; // number of torrents created at once during startup
+const int SNAPSHOT_INTERVAL = 5 * 60 * 1000; // how often the torrent snapshot is written
+const int MAX_CONCURRENT_DELETIONS = 2; // number of removed torrents whose files are deleted at the same time
+const int MAX_CONCURRENT_MIGRATIONS = 4; // number of torrent directories moved at the same time
 
 Core::Core(kt::GUI *gui)
     : gui(gui)
@@ -60,6 +72,13 @@ Core::Core(kt::GUI *gui)
     , sleep_suppression_cookie(0)
     , exiting(false)
     , reordering_queue(false)
+    , loader(nullptr)
+    , torrents_loaded(false)
+    , moving_torrents(false)
+    , load_progress(nullptr)
+    , delete_progress(nullptr)
+    , migrate_progress(nullptr)
+    , idle_ticks(0)
 {
     UpdateCurrentTime();
     qman = new QueueManager();
@@ -85,6 +104,21 @@ Core::Core(kt::GUI *gui)
         data_dir += bt::DirSeparator();
 
     connect(&update_timer, &QTimer::timeout, this, &Core::update);
+    connect(&snapshot_timer, &QTimer::timeout, this, &Core::saveSnapshot);
+
+    // Deletions which did not finish in the previous session are resumed once all torrents have been loaded
+    deletions = new DeletionQueue(kt::DataDir() + QLatin1String("deletions"), MAX_CONCURRENT_DELETIONS, this);
+    connect(deletions, &DeletionQueue::progress, this, &Core::deletionProgress);
+    connect(deletions, &DeletionQueue::finished, this, &Core::deletionsFinished);
+    connect(deletions, &DeletionQueue::error, this, [this](const QString &msg) {
+        gui->errorMsg(msg);
+    });
+
+    // Moves the torrents when the data directory is changed, a move which was interrupted
+    // in the previous session is finished before the torrents are loaded
+    migration = new DataDirMigration(kt::DataDir() + QLatin1String("migration"), MAX_CONCURRENT_MIGRATIONS, this);
+    connect(migration, &DataDirMigration::progress, this, &Core::migrationProgress);
+    connect(migration, &DataDirMigration::finished, this, &Core::migrationFinished);
 
     // Make sure network interface is set properly before server is initialized
     if (!Settings::networkInterface().isEmpty()) {
@@ -193,6 +227,8 @@ void Core::applySettings()
     setMaxDownloads(Settings::maxDownloads());
     setMaxSeeds(Settings::maxSeeds());
     setKeepSeeding(Settings::keepSeeding());
+    qman->setStatsSyncWindow(Settings::statsSyncWindow(), Settings::maxStatsSyncsPerTick());
+    qman->setAdaptiveLimits(Settings::adaptiveQueueLimits());
 
     QString tmp = Settings::tempDir();
     if (tmp.isEmpty())
@@ -261,6 +297,10 @@ bool Core::init(TorrentControl *tc, const QString &group, const QString &locatio
         return false;
     }
 
+    // A torrent removed from the same location may still be waiting for its files to be deleted
+    if (deletions->isPendingIn(tc->getStats().output_path))
+        deletions->keep(deletionJob(tc, true).files);
+
     try {
         tc->createFiles();
     } catch (bt::Error &err) {
@@ -312,8 +352,15 @@ bool Core::init(TorrentControl *tc, const QString &group, const QString &locatio
     return true;
 }
 
-bt::TorrentInterface *Core::loadFromData(const QByteArray &data, const QString &dir, const QString &group, bool silently, const QUrl &url)
+bt::TorrentInterface *
+Core::loadFromData(const QByteArray &data, const QString &dir, const QString &group, bool silently, const QUrl &url, const QString &move_on_completion)
 {
+    // alreadyLoaded does not know the torrents which have not been loaded yet
+    if (!torrents_loaded) {
+        pending_loads.append({data, dir, group, silently, url, move_on_completion});
+        return nullptr;
+    }
+
     QString tdir = findNewTorrentDir();
     TorrentControl *tc = nullptr;
     try {
@@ -322,6 +369,8 @@ bt::TorrentInterface *Core::loadFromData(const QByteArray &data, const QString &
         tc->init(qman, data, tdir, dir);
 
         if (init(tc, group, dir, silently)) {
+            if (!move_on_completion.isEmpty())
+                tc->setMoveWhenCompletedDir(move_on_completion);
             startUpdateTimer();
             return tc;
         }
@@ -489,6 +538,18 @@ bt::TorrentInterface *Core::loadSilently(const QByteArray &data, const QUrl &url
         return nullptr;
 }
 
+void Core::load(const QByteArray &data, const QUrl &url, const MagnetLinkLoadOptions &options)
+{
+    QString dir;
+    if (options.location.isEmpty() || !bt::Exists(options.location))
+        dir = locationHint(options.group);
+    else
+        dir = options.location;
+
+    if (dir != QString())
+        loadFromData(data, dir, options.group, options.silently, url, options.move_on_completion);
+}
+
 void Core::start(bt::TorrentInterface *tc)
 {
     if (tc->getStats().paused) {
@@ -552,7 +613,14 @@ QString Core::findNewTorrentDir() const
     int i = 0;
     while (true) {
         QDir d;
-        QString dir = data_dir % QLatin1String("tor") % QString::number(i) % QLatin1Char('/');
+        QString name = QLatin1String("tor") % QString::number(i) % QLatin1Char('/');
+        // not moved yet from the previous data directory
+        if (migration->isPending(data_dir) && d.exists(migration->source() + name)) {
+            i++;
+            continue;
+        }
+
+        QString dir = data_dir + name;
         if (!d.exists(dir)) {
             return dir;
         }
@@ -563,8 +631,6 @@ QString Core::findNewTorrentDir() const
 
 void Core::loadExistingTorrent(const QString &tor_dir)
 {
-    TorrentControl *tc = nullptr;
-
     QString idir = tor_dir;
     if (!idir.endsWith(bt::DirSeparator()))
         idir += bt::DirSeparator();
@@ -572,45 +638,326 @@ void Core::loadExistingTorrent(const QString &tor_dir)
     if (!bt::Exists(idir + QLatin1String("torrent")))
         return;
 
+    try {
+        initExistingTorrent(idir, bt::LoadFile(idir + QLatin1String("torrent")));
+    } catch (bt::Error &err) {
+        gui->errorMsg(err.toString());
+    }
+}
+
+void Core::initExistingTorrent(const QString &idir, const QByteArray &data)
+{
+    KT_TRACE_SCOPE("core", "Core::initExistingTorrent");
+    TorrentControl *tc = nullptr;
     try {
         tc = new TorrentControl();
-        tc->init(qman, bt::LoadFile(idir + QLatin1String("torrent")), idir, QString());
+        tc->init(qman, data, idir, QString());
+        if (deletions->isPendingIn(tc->getStats().output_path))
+            deletions->keep(deletionJob(tc, true).files);
 
         qman->append(tc);
         connectSignals(tc);
-        Q_EMIT torrentAdded(tc);
+        // a moved torrent goes back into its groups right away, the groups are not loaded again afterwards
+        if (moving_torrents)
+            gman->torrentReloaded(tc);
+        Q_EMIT torrentLoaded(tc);
     } catch (bt::Error &err) {
         gui->errorMsg(err.toString());
         delete tc;
     } catch (bt::Warning &warning) {
         bt::Out(SYS_GEN | LOG_NOTICE) << warning.toString() << endl;
         Q_EMIT canNotLoadSilently(warning.toString());
-        bt::Delete(tor_dir, true);
+        bt::Delete(idir, true);
     }
 }
 
 void Core::loadTorrents()
 {
+    KT_TRACE_SCOPE("core", "Core::loadTorrents");
+    // The torrent files are read in the background, the torrents are created here in batches,
+    // in the meantime the view shows the torrents as they were at the end of the previous session
+    load_time.start();
+    loadPendingLoads();
+    if (startup_snapshot.load(kt::DataDir() + QLatin1String("snapshot")))
+        Out(SYS_GEN | LOG_NOTICE) << "Loaded snapshot of " << startup_snapshot.count() << " torrents in " << load_time.elapsed() << " ms" << endl;
+
+    if (!migration->isPending(data_dir)) {
+        loadTorrentDirs();
+        return;
+    }
+
+    // Move the torrents from the previous data directory first
+    const QStringList sl = QDir(migration->source()).entryList({QStringLiteral("tor*")}, QDir::Dirs);
+    QStringList dirs;
+    for (const QString &s : sl) {
+        if (!deletions->isPending(migration->source() + s))
+            dirs.append(s);
+    }
+
+    migration->start(dirs);
+}
+
+void Core::loadTorrentDirs()
+{
+    KT_TRACE_SCOPE("core", "Core::loadTorrentDirs");
     QDir dir(data_dir);
     QStringList filters;
     filters << QStringLiteral("tor*");
-    const QStringList sl = dir.entryList(filters, QDir::Dirs);
-    for (const QString &s : sl) {
-        QString idir = data_dir + s;
+    QStringList sl;
+    for (const QString &s : dir.entryList(filters, QDir::Dirs))
+        sl.append(data_dir + s);
+    // torrents which could not be moved are loaded from where they are
+    for (const QString &s : migration->failed())
+        sl.append(migration->source() + s);
+
+    // torrents which were not moved stay loaded
+    QSet<QString> loaded;
+    for (bt::TorrentInterface *tc : std::as_const(*qman))
+        loaded.insert(QDir::cleanPath(tc->getTorDir()));
+
+    QStringList dirs;
+    for (const QString &s : std::as_const(sl)) {
+        QString idir = s;
         if (!idir.endsWith(DirSeparator()))
             idir.append(DirSeparator());
+        // removed, but not deleted yet
+        if (deletions->isPending(idir) || loaded.contains(QDir::cleanPath(idir)))
+            continue;
+        dirs.append(idir);
+    }
+
+    Out(SYS_GEN | LOG_NOTICE) << "Loading " << dirs.count() << " torrents" << endl;
+    loader = new TorrentDirLoader(dirs, LOAD_BATCH_SIZE, this);
+    connect(loader, &TorrentDirLoader::loaded, this, &Core::torrentDirsLoaded);
+    connect(loader, &TorrentDirLoader::progress, this, &Core::torrentLoadProgress);
+    connect(loader, &TorrentDirLoader::finished, this, &Core::allTorrentsLoaded);
+    loader->start();
+}
+
+void Core::torrentDirsLoaded(const QList<kt::TorrentDirLoader::Item> &batch)
+{
+    KT_TRACE_SCOPE("core", "Core::torrentDirsLoaded");
+    for (const TorrentDirLoader::Item &item : batch) {
+        Out(SYS_GEN | LOG_NOTICE) << "Loading " << item.dir << endl;
+        if (!item.error.isEmpty())
+            gui->errorMsg(item.error);
+        else if (!item.data.isEmpty())
+            initExistingTorrent(item.dir, item.data);
+    }
+}
+
+void Core::torrentLoadProgress(int done, int total)
+{
+    StatusBarInterface *sb = gui->getStatusBar();
+    if (!sb)
+        return;
+
+    if (!load_progress) {
+        load_progress = sb->createProgressBar();
+        load_progress->setFormat(i18n("Loading torrents: %v of %m"));
+    }
+
+    load_progress->setMaximum(total);
+    load_progress->setValue(done);
+}
+
+void Core::deletionProgress(int done, int total)
+{
+    StatusBarInterface *sb = gui->getStatusBar();
+    if (!sb)
+        return;
 
-        Out(SYS_GEN | LOG_NOTICE) << "Loading " << idir << endl;
-        loadExistingTorrent(idir);
+    if (!delete_progress) {
+        delete_progress = sb->createProgressBar();
+        delete_progress->setFormat(i18n("Deleting files: %p%"));
+    }
+
+    delete_progress->setMaximum(total);
+    delete_progress->setValue(done);
+}
+
+void Core::deletionsFinished()
+{
+    if (delete_progress) {
+        gui->getStatusBar()->removeProgressBar(delete_progress);
+        delete_progress = nullptr;
+    }
+}
+
+void Core::migrationProgress(int done, int total)
+{
+    StatusBarInterface *sb = gui->getStatusBar();
+    if (!sb)
+        return;
+
+    if (!migrate_progress) {
+        migrate_progress = sb->createProgressBar();
+        migrate_progress->setFormat(i18n("Moving torrents: %v of %m"));
+    }
+
+    migrate_progress->setMaximum(total);
+    migrate_progress->setValue(done);
+}
+
+void Core::migrationFinished()
+{
+    if (migrate_progress) {
+        gui->getStatusBar()->removeProgressBar(migrate_progress);
+        migrate_progress = nullptr;
+    }
+
+    const QStringList failed = migration->failed();
+    if (!failed.isEmpty())
+        gui->errorMsg(i18np("Failed to move 1 torrent to %2, it will be tried again the next time KTorrent is started.",
+                            "Failed to move %1 torrents to %2, they will be tried again the next time KTorrent is started.",
+                            failed.count(),
+                            data_dir));
+    loadTorrentDirs();
+}
+
+void Core::allTorrentsLoaded()
+{
+    KT_TRACE_SCOPE("core", "Core::allTorrentsLoaded");
+    Out(SYS_GEN | LOG_NOTICE) << "Loaded " << loader->total() << " torrents in " << load_time.elapsed() << " ms" << endl;
+    if (load_progress) {
+        gui->getStatusBar()->removeProgressBar(load_progress);
+        load_progress = nullptr;
+    }
+
+    loader->deleteLater();
+    loader = nullptr;
+    torrents_loaded = true;
+
+    if (moving_torrents) {
+        movedTorrentsLoaded();
+        return;
     }
 
     gman->torrentsLoaded(qman);
     qman->loadState(KSharedConfig::openConfig());
+
+    // The view has the real torrents now
+    Q_EMIT torrentsLoaded();
+    startup_snapshot.clear();
+    snapshot_timer.start(SNAPSHOT_INTERVAL);
+    deletions->start();
+
     QTimer::singleShot(0, this, &Core::delayedStart);
+    QTimer::singleShot(0, this, &Core::loadPendingTorrents);
+}
+
+void Core::movedTorrentsLoaded()
+{
+    // Only the moved torrents are back, the rest of the session keeps its queue, groups and deletions
+    moving_torrents = false;
+    QList<bt::TorrentInterface *> todo;
+    for (const bt::SHA1Hash &ih : std::as_const(restart_after_move)) {
+        bt::TorrentInterface *tc = qman->find(ih);
+        if (tc)
+            todo.append(tc);
+    }
+    restart_after_move.clear();
+
+    if (!todo.isEmpty())
+        qman->start(todo);
+    qman->orderQueue();
+    gui->updateActions();
+    QTimer::singleShot(0, this, &Core::loadPendingTorrents);
+}
+
+void Core::loadPendingTorrents()
+{
+    // Torrents which were opened while loading
+    const QList<PendingLoad> loads = std::move(pending_loads);
+    pending_loads.clear();
+    for (const PendingLoad &l : loads)
+        loadFromData(l.data, l.dir, l.group, l.silently, l.url, l.move_on_completion);
+}
+
+void Core::saveSnapshot()
+{
+    // Group membership is not known until all torrents have been loaded
+    if (loader || migration->isRunning())
+        return;
+
+    TorrentSnapshot snapshot;
+    for (bt::TorrentInterface *tc : std::as_const(*qman)) {
+        const TorrentStats &s = tc->getStats();
+        TorrentSnapshot::Entry e;
+        e.info_hash = tc->getInfoHash().toString();
+        e.name = tc->getDisplayName();
+        e.output_path = s.output_path;
+        e.total_bytes_to_download = s.total_bytes_to_download;
+        e.bytes_downloaded = s.bytes_downloaded;
+        e.bytes_uploaded = s.bytes_uploaded;
+        e.bytes_left = s.bytes_left;
+        e.status = s.status;
+        e.completed = s.completed;
+        e.percentage = Percentage(s);
+        e.share_ratio = s.shareRatio();
+        e.priority = tc->getPriority();
+        e.time_added = s.time_added.toSecsSinceEpoch();
+        for (GroupManager::Itr g = gman->begin(); g != gman->end(); ++g) {
+            if (g->second->isMember(tc))
+                e.groups.append(g->second->groupPath());
+        }
+        snapshot.append(e);
+    }
+
+    snapshot.save(kt::DataDir() + QLatin1String("snapshot"));
+}
+
+static const quint32 PENDING_LOADS_VERSION = 1;
+
+void Core::loadPendingLoads()
+{
+    // Torrents which were opened before quitting, while the existing torrents were still being loaded
+    const QString file = kt::DataDir() + QLatin1String("pending_loads");
+    QFile fptr(file);
+    if (!fptr.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&fptr);
+    quint32 version = 0, num = 0;
+    in >> version >> num;
+    for (quint32 i = 0; i < num && version == PENDING_LOADS_VERSION && in.status() == QDataStream::Ok; i++) {
+        PendingLoad l;
+        in >> l.data >> l.dir >> l.group >> l.silently >> l.url >> l.move_on_completion;
+        if (in.status() == QDataStream::Ok)
+            pending_loads.append(l);
+    }
+
+    // written again at exit if they are still pending then
+    fptr.close();
+    QFile::remove(file);
+    Out(SYS_GEN | LOG_NOTICE) << "Loading " << pending_loads.count() << " torrents opened in the previous session" << endl;
+}
+
+void Core::savePendingLoads() const
+{
+    if (pending_loads.isEmpty())
+        return;
+
+    const QString file = kt::DataDir() + QLatin1String("pending_loads");
+    QSaveFile fptr(file);
+    if (!fptr.open(QIODevice::WriteOnly)) {
+        Out(SYS_GEN | LOG_IMPORTANT) << "Failed to open " << file << " : " << fptr.errorString() << endl;
+        return;
+    }
+
+    QDataStream out(&fptr);
+    out << PENDING_LOADS_VERSION << (quint32)pending_loads.count();
+    for (const PendingLoad &l : pending_loads)
+        out << l.data << l.dir << l.group << l.silently << l.url << l.move_on_completion;
+
+    if (!fptr.commit())
+        Out(SYS_GEN | LOG_IMPORTANT) << "Failed to write " << file << " : " << fptr.errorString() << endl;
 }
 
 void Core::delayedStart()
 {
+    // Ramp up the torrents in batches, instead of starting all of them in one go
+    qman->beginStartup();
     qman->orderQueue();
     if (!kt::QueueManager::enabled())
         qman->startAutoStartTorrents();
@@ -631,20 +978,16 @@ void Core::remove(bt::TorrentInterface *tc, bool data_to)
         removed_bytes_down += s.session_bytes_downloaded;
         stop(tc);
 
-        QString dir = tc->getTorDir();
-
-        try {
-            if (data_to)
-                tc->deleteDataFiles();
-        } catch (Error &e) {
-            gui->errorMsg(e.toString());
-        }
+        const DeletionQueue::Job job = deletionJob(tc, data_to);
 
         Q_EMIT torrentRemoved(tc);
         gman->torrentRemoved(tc);
+        running.remove(tc);
+        uncountStats(tc);
         qman->torrentRemoved(tc);
         gui->updateActions();
-        bt::Delete(dir, false);
+        // The torrent is gone now, delete its files in the background
+        deletions->add(job);
         delayed_removal.remove(tc);
     } catch (Error &e) {
         gui->errorMsg(e.toString());
@@ -667,31 +1010,44 @@ void Core::remove(QList<bt::TorrentInterface *> &todo, bool data_to)
 
     stop(todo);
 
+    QList<DeletionQueue::Job> jobs;
     for (bt::TorrentInterface *tc : std::as_const(todo)) {
         const bt::TorrentStats &s = tc->getStats();
         removed_bytes_up += s.session_bytes_uploaded;
         removed_bytes_down += s.session_bytes_downloaded;
 
-        QString dir = tc->getTorDir();
-
-        try {
-            if (data_to)
-                tc->deleteDataFiles();
-        } catch (Error &e) {
-            gui->errorMsg(e.toString());
-        }
+        jobs.append(deletionJob(tc, data_to));
 
         Q_EMIT torrentRemoved(tc);
         gman->torrentRemoved(tc);
-        try {
-            bt::Delete(dir, false);
-        } catch (Error &e) {
-            gui->errorMsg(e.toString());
-        }
+        running.remove(tc);
+        uncountStats(tc);
     }
 
     qman->torrentsRemoved(todo);
     gui->updateActions();
+
+    // The torrents are gone now, delete their files in the background
+    for (const DeletionQueue::Job &job : std::as_const(jobs))
+        deletions->add(job);
+}
+
+DeletionQueue::Job Core::deletionJob(bt::TorrentInterface *tc, bool data_to)
+{
+    // Same files as TorrentInterface::deleteDataFiles, but those are deleted by the DeletionQueue
+    DeletionQueue::Job job;
+    job.tor_dir = tc->getTorDir();
+    if (data_to) {
+        const bt::TorrentStats &s = tc->getStats();
+        if (s.multi_file_torrent) {
+            for (Uint32 i = 0; i < tc->getNumFiles(); i++)
+                job.files.append(tc->getTorrentFile(i).getPathOnDisk());
+            job.data_dir = s.output_path;
+        } else {
+            job.files.append(s.output_path);
+        }
+    }
+    return job;
 }
 
 void Core::delayedRemove(bt::TorrentInterface *tc)
@@ -733,6 +1089,8 @@ void Core::onExit()
     // stop timer to prevent updates during wait
     exiting = true;
     update_timer.stop();
+    // the remaining deletions are done at the next start
+    deletions->stop();
 
     net::SocketMonitor::instance().shutdown();
     mman->saveMagnets(kt::DataDir() + QLatin1String("magnets"));
@@ -742,7 +1100,12 @@ void Core::onExit()
     AuthenticationMonitor::instance().shutdown();
 
     WaitJob *job = new WaitJob(5000);
-    qman->saveState(KSharedConfig::openConfig());
+    // Not all torrents are known yet, so keep the state of the previous session
+    if (torrents_loaded)
+        qman->saveState(KSharedConfig::openConfig());
+    savePendingLoads();
+    snapshot_timer.stop();
+    saveSnapshot();
 
     // Sync the config to be sure everything is saved
     Settings::self()->save();
@@ -759,6 +1122,8 @@ void Core::onExit()
     Globals::instance().shutdownUTPServer();
 
     pman->unloadAll();
+    running.clear();
+    counted.clear();
     qman->clear();
 }
 
@@ -771,7 +1136,32 @@ bool Core::changeDataDir(const QString &new_dir)
             || data_dir == new_dir || data_dir == (new_dir + bt::DirSeparator()))
             return true;
 
-        update_timer.stop();
+        // wait until the torrents are loaded, and the ones which are still in the previous data directory have been moved
+        if (!torrents_loaded || migration->isRunning()) {
+            gui->errorMsg(i18n("The data directory cannot be changed while torrents are being loaded or moved to a new data directory."));
+            Settings::setTempDir(data_dir);
+            Settings::self()->save();
+            return false;
+        }
+
+        if (!migration->failed().isEmpty()) {
+            gui->errorMsg(i18n("The data directory cannot be changed until the torrents which could not be moved to %1 have been moved. "
+                               "This will be tried again the next time KTorrent is started.",
+                               data_dir));
+            Settings::setTempDir(data_dir);
+            Settings::self()->save();
+            return false;
+        }
+
+        for (bt::TorrentInterface *tc : std::as_const(*qman)) {
+            if (tc->getJobQueue()->runningJobs()) {
+                gui->errorMsg(i18n("The data directory cannot be changed while torrents are being checked or moved."));
+                Settings::setTempDir(data_dir);
+                Settings::self()->save();
+                return false;
+            }
+        }
+
         // safety check
         if (!bt::Exists(new_dir))
             bt::MakeDir(new_dir);
@@ -781,50 +1171,83 @@ bool Core::changeDataDir(const QString &new_dir)
         if (!nd.endsWith(DirSeparator()))
             nd += DirSeparator();
 
+        // The journal is only needed to finish the move when we quit or crash in the middle of it
         Out(SYS_GEN | LOG_DEBUG) << "Switching to datadir " << nd << endl;
-
-        qman->setSuspendedState(true);
-
-        QList<bt::TorrentInterface *> succes;
-
-        QList<bt::TorrentInterface *>::iterator i = qman->begin();
-        while (i != qman->end()) {
-            bt::TorrentInterface *tc = *i;
-            if (!tc->changeTorDir(nd)) {
-                // failure time to roll back all the successful tc's
-                rollback(succes);
-                // set back the old data_dir in Settings
-                Settings::setTempDir(data_dir);
-                Settings::self()->save();
-                qman->setSuspendedState(false);
-                update_timer.start(CORE_UPDATE_INTERVAL);
-                return false;
-            } else {
-                succes.append(tc);
-            }
-            i++;
+        if (!migration->prepare(data_dir, nd)) {
+            Settings::setTempDir(data_dir);
+            Settings::self()->save();
+            return false;
         }
-        data_dir = nd;
-        qman->setSuspendedState(false);
-        update_timer.start(CORE_UPDATE_INTERVAL);
+
+        moveTorrents(nd);
         return true;
     } catch (bt::Error &e) {
         Out(SYS_GEN | LOG_IMPORTANT) << "Error : " << e.toString() << endl;
-        update_timer.start(CORE_UPDATE_INTERVAL);
         return false;
     }
 }
 
-void Core::rollback(const QList<bt::TorrentInterface *> &succes)
+void Core::moveTorrents(const QString &nd)
 {
-    Out(SYS_GEN | LOG_DEBUG) << "Error, rolling back" << endl;
-    update_timer.stop();
-    QList<bt::TorrentInterface *>::const_iterator i = succes.begin();
-    while (i != succes.end()) {
-        (*i)->rollback();
-        i++;
+    KT_TRACE_SCOPE("core", "Core::moveTorrents");
+    // libktorrent cannot move the directory of a loaded torrent, so the torrents are
+    // unloaded, moved by the workers, and loaded again from the new directory in batches
+    const QString old_dir = QDir::cleanPath(data_dir);
+    QList<bt::TorrentInterface *> todo;
+    QStringList dirs;
+    for (bt::TorrentInterface *tc : std::as_const(*qman)) {
+        const QFileInfo fi(QDir::cleanPath(tc->getTorDir()));
+        if (QDir::cleanPath(fi.path()) == old_dir) {
+            todo.append(tc);
+            dirs.append(fi.fileName());
+            if (tc->getStats().running)
+                restart_after_move.insert(tc->getInfoHash());
+        }
+    }
+
+    // New torrents go to the new directory, once the moved ones are back, so duplicates are recognized
+    data_dir = nd;
+    torrents_loaded = false;
+    moving_torrents = true;
+    load_time.start();
+
+    // Unloaded first, so the queue does not start them again while they are stopping
+    for (bt::TorrentInterface *tc : std::as_const(todo)) {
+        const bt::TorrentStats &s = tc->getStats();
+        removed_bytes_up += s.session_bytes_uploaded;
+        removed_bytes_down += s.session_bytes_downloaded;
+
+        Q_EMIT torrentRemoved(tc);
+        gman->torrentUnloaded(tc);
+        running.remove(tc);
+        uncountStats(tc);
+        disconnect(tc, nullptr, this, nullptr);
+        disconnect(tc, nullptr, qman, nullptr);
+    }
+
+    qman->torrentsRemoved(todo);
+    gui->updateActions();
+
+    // The directories are moved once the torrents are gone, so nothing writes to them anymore
+    QSharedPointer<int> left(new int(todo.count()));
+    for (bt::TorrentInterface *tc : std::as_const(todo)) {
+        connect(tc, &QObject::destroyed, this, [this, left, dirs]() {
+            if (--(*left) == 0)
+                migration->start(dirs);
+        });
+
+        if (!tc->getStats().running)
+            continue;
+
+        try {
+            tc->stop();
+        } catch (bt::Error &err) {
+            Out(SYS_GEN | LOG_IMPORTANT) << "Error stopping " << tc->getDisplayName() << " : " << err.toString() << endl;
+        }
     }
-    update_timer.start(CORE_UPDATE_INTERVAL);
+
+    if (todo.isEmpty())
+        migration->start(dirs);
 }
 
 void Core::startAll()
@@ -842,6 +1265,8 @@ void Core::startUpdateTimer()
 {
     if (!update_timer.isActive()) {
         Out(SYS_GEN | LOG_DEBUG) << "Started update timer" << endl;
+        updateRunningSet();
+        idle_ticks = 0;
         update_timer.start(CORE_UPDATE_INTERVAL);
         if (Settings::suppressSleep() && sleep_suppression_cookie == 0) {
             org::freedesktop::PowerManagement::Inhibit powerManagement(QStringLiteral("org.freedesktop.PowerManagement.Inhibit"),
@@ -866,19 +1291,29 @@ void Core::update()
     if (exiting)
         return;
 
+    KT_TRACE_SCOPE("core", "Core::update");
+
     try {
         bt::UpdateCurrentTime();
         AuthenticationMonitor::instance().update();
 
-        QList<bt::TorrentInterface *>::iterator i = qman->begin();
+        // Only the running torrents need an update, updating a torrent can start or stop others
+        // (or even remove them), so work on a copy and skip those which are no longer in the set
+        const QList<bt::TorrentInterface *> todo = running.values();
         bool updated = false;
-        while (i != qman->end()) {
-            bt::TorrentInterface *tc = *i;
-            if (tc->getStats().running) {
-                tc->update();
-                updated = true;
-            }
-            i++;
+        Uint64 rate = 0;
+        for (bt::TorrentInterface *tc : todo) {
+            if (!running.contains(tc))
+                continue;
+
+            tc->update();
+            updated = true;
+            countStats(tc);
+
+            const TorrentStats &s = tc->getStats();
+            rate += (Uint64)s.download_rate + s.upload_rate;
+            if (!s.running)
+                running.remove(tc);
         }
 
         if (!updated && mman->count() == 0) {
@@ -906,6 +1341,10 @@ void Core::update()
             if (Settings::decreasePriorityOfStalledTorrents()) {
                 qman->checkStalledTorrents(bt::CurrentTime(), Settings::stallTimer());
             }
+            qman->checkLowDiskSpace(bt::CurrentTime());
+            if (qman->adaptLimitsDue(bt::CurrentTime()))
+                qman->adaptLimits(getStats(), bt::CurrentTime());
+            adaptUpdateInterval(rate);
         }
     } catch (bt::Error &err) {
         Out(SYS_GEN | LOG_IMPORTANT) << "Caught bt::Error: " << err.toString() << endl;
@@ -939,23 +1378,47 @@ bt::TorrentInterface *Core::createTorrent(bt::TorrentCreator *mktor, bool seed)
 
 CurrentStats Core::getStats()
 {
+    // The totals are kept up to date during the update, so no need to go over all torrents
     CurrentStats stats;
-    Uint64 bytes_dl = 0, bytes_ul = 0;
-    Uint32 speed_dl = 0, speed_ul = 0;
+    stats.download_speed = totals.download_rate;
+    stats.upload_speed = totals.upload_rate;
+    stats.bytes_downloaded = totals.bytes_downloaded + removed_bytes_down;
+    stats.bytes_uploaded = totals.bytes_uploaded + removed_bytes_up;
+    return stats;
+}
 
-    for (bt::TorrentInterface *tc : std::as_const(*qman)) {
-        const TorrentStats &s = tc->getStats();
-        speed_dl += s.download_rate;
-        speed_ul += s.upload_rate;
-        bytes_dl += s.session_bytes_downloaded;
-        bytes_ul += s.session_bytes_uploaded;
-    }
-    stats.download_speed = speed_dl;
-    stats.upload_speed = speed_ul;
-    stats.bytes_downloaded = bytes_dl + removed_bytes_down;
-    stats.bytes_uploaded = bytes_ul + removed_bytes_up;
+void Core::countStats(bt::TorrentInterface *tc)
+{
+    // Replace what the torrent added to the totals the previous time by its current stats,
+    // the unsigned arithmetic wraps around correctly when a value went down
+    const TorrentStats &s = tc->getStats();
+    // A stopped torrent may still have the rates of its last update, it is not running anymore
+    // and is no longer updated, so they would stay in the totals
+    const Uint32 download_rate = s.running ? s.download_rate : 0;
+    const Uint32 upload_rate = s.running ? s.upload_rate : 0;
+    TransferTotals &c = counted[tc];
+    totals.download_rate += download_rate - c.download_rate;
+    totals.upload_rate += upload_rate - c.upload_rate;
+    totals.bytes_downloaded += s.session_bytes_downloaded - c.bytes_downloaded;
+    totals.bytes_uploaded += s.session_bytes_uploaded - c.bytes_uploaded;
+    c.download_rate = download_rate;
+    c.upload_rate = upload_rate;
+    c.bytes_downloaded = s.session_bytes_downloaded;
+    c.bytes_uploaded = s.session_bytes_uploaded;
+}
 
-    return stats;
+void Core::uncountStats(bt::TorrentInterface *tc)
+{
+    // The session bytes of removed torrents are kept in removed_bytes_down and removed_bytes_up
+    auto i = counted.find(tc);
+    if (i == counted.end())
+        return;
+
+    totals.download_rate -= i->download_rate;
+    totals.upload_rate -= i->upload_rate;
+    totals.bytes_downloaded -= i->bytes_downloaded;
+    totals.bytes_uploaded -= i->bytes_uploaded;
+    counted.erase(i);
 }
 
 bool Core::changePort(Uint16 port)
@@ -1130,6 +1593,7 @@ void Core::connectSignals(bt::TorrentInterface *tc)
     connect(tc, &bt::TorrentInterface::corruptedDataFound, this, &Core::emitCorruptedData);
     connect(tc, &bt::TorrentInterface::needDataCheck, this, &Core::autoCheckData);
     connect(tc, &bt::TorrentInterface::statusChanged, this, &Core::onStatusChanged);
+    countStats(tc);
 }
 
 float Core::getGlobalMaxShareRatio() const
@@ -1171,11 +1635,51 @@ DBus *Core::getExternalInterface()
 
 void Core::onStatusChanged(bt::TorrentInterface *tc)
 {
-    Q_UNUSED(tc);
+    countStats(tc);
+    if (tc->getStats().running) {
+        running.insert(tc);
+        // Do not let a torrent which just started wait for the slow idle updates
+        idle_ticks = 0;
+        if (update_timer.isActive() && update_timer.interval() > (int)CORE_UPDATE_INTERVAL)
+            update_timer.setInterval(CORE_UPDATE_INTERVAL);
+    } else {
+        running.remove(tc);
+    }
+
     if (!reordering_queue)
         gui->updateActions();
 }
 
+void Core::updateRunningSet()
+{
+    running.clear();
+    for (bt::TorrentInterface *tc : std::as_const(*qman)) {
+        if (tc->getStats().running)
+            running.insert(tc);
+    }
+}
+
+void Core::adaptUpdateInterval(bt::Uint64 rate)
+{
+    // Slow down when nothing is going on, and speed up under heavy traffic,
+    // but only slow down after being idle for a while, so short pauses in the traffic do not matter
+    Uint32 interval = CORE_UPDATE_INTERVAL;
+    if (rate > 0 || mman->count() > 0)
+        idle_ticks = 0;
+    else if (idle_ticks < CORE_IDLE_TICKS)
+        idle_ticks++;
+
+    if (idle_ticks >= CORE_IDLE_TICKS)
+        interval = CORE_IDLE_UPDATE_INTERVAL;
+    else if (rate >= CORE_BUSY_RATE)
+        interval = CORE_BUSY_UPDATE_INTERVAL;
+
+    if (update_timer.interval() != (int)interval) {
+        Out(SYS_GEN | LOG_DEBUG) << "Update interval changed to " << interval << " ms" << endl;
+        update_timer.setInterval(interval);
+    }
+}
+
 void Core::beforeQueueReorder()
 {
     reordering_queue = true;
@@ -1184,6 +1688,8 @@ void Core::beforeQueueReorder()
 void Core::afterQueueReorder()
 {
     reordering_queue = false;
+    // Reordering starts and stops lots of torrents, catch up on everything in one go
+    updateRunningSet();
     gui->updateActions();
     gman->updateCount(qman);
     startUpdateTimer();
@@ -1231,16 +1737,7 @@ void Core::onMetadataDownloaded(const bt::MagnetLink &mlink, const QByteArray &d
     out->write(data.data(), data.size());
     enc.end();
 
-    QUrl url(mlink.toString());
-
-    bt::TorrentInterface *tc = nullptr;
-    if (options.silently)
-        tc = loadSilently(tmp, url, options.group, options.location);
-    else
-        tc = load(tmp, url, options.group, options.location);
-
-    if (tc && !options.move_on_completion.isEmpty())
-        tc->setMoveWhenCompletedDir(options.move_on_completion);
+    load(tmp, QUrl(mlink.toString()), options);
 }
 
 QString Core::locationHint(const QString &group) const
@@ -7,13 +7,21 @@
 #ifndef KTCORE_HH
 #define KTCORE_HH
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QMap>
+#include <QSet>
 #include <QTimer>
 
 #include <interfaces/coreinterface.h>
 #include <interfaces/torrentinterface.h>
+#include <torrent/datadirmigration.h>
+#include <torrent/deletionqueue.h>
+#include <torrent/torrentdirloader.h>
+#include <torrent/torrentsnapshot.h>
 
 class KJob;
+class QProgressBar;
 
 namespace bt
 {
@@ -51,6 +59,7 @@ public:
     bt::TorrentInterface *load(const QByteArray &data, const QUrl &url, const QString &group, const QString &savedir) override;
     void loadSilently(const QUrl &url, const QString &group) override;
     bt::TorrentInterface *loadSilently(const QByteArray &data, const QUrl &url, const QString &group, const QString &savedir) override;
+    void load(const QByteArray &data, const QUrl &url, const MagnetLinkLoadOptions &options) override;
     void load(const bt::MagnetLink &mlink, const MagnetLinkLoadOptions &options) override;
     QString findNewTorrentDir() const override;
     void loadExistingTorrent(const QString &tor_dir) override;
@@ -93,6 +102,12 @@ public:
      */
     void loadPlugins();
 
+    /// Get the snapshot of the torrents of the previous session, it is empty once all torrents have been loaded
+    const TorrentSnapshot &startupSnapshot() const
+    {
+        return startup_snapshot;
+    }
+
 public Q_SLOTS:
     /**
      * Start the update timer
@@ -216,8 +231,10 @@ Q_SIGNALS:
      */
     void aboutToQuit();
 
+    /// Emitted when all existing torrents have been loaded at startup, or again after a change of the data directory
+    void torrentsLoaded();
+
 private:
-    void rollback(const QList<bt::TorrentInterface *> &success);
     void connectSignals(bt::TorrentInterface *tc);
     bool init(bt::TorrentControl *tc, const QString &group, const QString &location, bool silently);
     QString locationHint(const QString &group) const;
@@ -225,7 +242,23 @@ private:
     void startTCPServer(bt::Uint16 port);
     bool startUTPServer(bt::Uint16 port);
     bt::TorrentInterface *loadFromFile(const QString &file, const QString &dir, const QString &group, bool silently);
-    bt::TorrentInterface *loadFromData(const QByteArray &data, const QString &dir, const QString &group, bool silently, const QUrl &url);
+    bt::TorrentInterface *loadFromData(const QByteArray &data,
+                                       const QString &dir,
+                                       const QString &group,
+                                       bool silently,
+                                       const QUrl &url,
+                                       const QString &move_on_completion = QString());
+    void initExistingTorrent(const QString &idir, const QByteArray &data);
+    void loadTorrentDirs();
+    void moveTorrents(const QString &nd);
+    void saveSnapshot();
+    void loadPendingLoads();
+    void savePendingLoads() const;
+    DeletionQueue::Job deletionJob(bt::TorrentInterface *tc, bool data_to);
+    void updateRunningSet();
+    void countStats(bt::TorrentInterface *tc);
+    void uncountStats(bt::TorrentInterface *tc);
+    void adaptUpdateInterval(bt::Uint64 rate);
 
 public:
     void loadTorrents();
@@ -240,6 +273,15 @@ private Q_SLOTS:
     void autoCheckData(bt::TorrentInterface *tc);
     void delayedRemove(bt::TorrentInterface *tc);
     void delayedStart();
+    void torrentDirsLoaded(const QList<kt::TorrentDirLoader::Item> &batch);
+    void torrentLoadProgress(int done, int total);
+    void allTorrentsLoaded();
+    void movedTorrentsLoaded();
+    void loadPendingTorrents();
+    void deletionProgress(int done, int total);
+    void deletionsFinished();
+    void migrationProgress(int done, int total);
+    void migrationFinished();
     void beforeQueueReorder();
     void afterQueueReorder();
     void customGroupChanged();
@@ -264,6 +306,43 @@ private:
     QMap<bt::TorrentInterface *, bool> delayed_removal;
     bool exiting;
     bool reordering_queue;
+    TorrentDirLoader *loader; // reads the existing torrents at startup
+    bool torrents_loaded; // all existing torrents have been loaded
+    bool moving_torrents; // the torrents being loaded are the ones moved to a new data directory
+    QSet<bt::SHA1Hash> restart_after_move; // torrents which were running before they were moved
+
+    /// A torrent opened before all existing torrents were loaded
+    struct PendingLoad {
+        QByteArray data;
+        QString dir;
+        QString group;
+        bool silently;
+        QUrl url;
+        QString move_on_completion;
+    };
+
+    QList<PendingLoad> pending_loads; // loaded once all existing torrents are, so duplicates are recognized, kept when quitting before that
+    QProgressBar *load_progress;
+    DeletionQueue *deletions; // deletes the files of removed torrents
+    QProgressBar *delete_progress;
+    DataDirMigration *migration; // moves the torrents to a new data directory
+    QProgressBar *migrate_progress;
+    QElapsedTimer load_time;
+    TorrentSnapshot startup_snapshot; // shown in the view until all torrents have been loaded
+    QTimer snapshot_timer;
+    QSet<bt::TorrentInterface *> running; // torrents which need to be updated
+    bt::Uint32 idle_ticks;
+
+    /// Transfer statistics of all torrents together, or what one torrent contributes to them
+    struct TransferTotals {
+        bt::Uint32 download_rate = 0;
+        bt::Uint32 upload_rate = 0;
+        bt::Uint64 bytes_downloaded = 0;
+        bt::Uint64 bytes_uploaded = 0;
+    };
+
+    TransferTotals totals; // excluding removed torrents, see removed_bytes_up and removed_bytes_down
+    QHash<bt::TorrentInterface *, TransferTotals> counted; // what each torrent has added to totals
 };
 }
 
@@ -36,6 +36,7 @@ SpeedLimitsModel::SpeedLimitsModel(Core *core, QObject *parent)
     }
 
     connect(core, &Core::torrentAdded, this, &SpeedLimitsModel::onTorrentAdded);
+    connect(core, &Core::torrentLoaded, this, &SpeedLimitsModel::onTorrentAdded);
     connect(core, &Core::torrentRemoved, this, &SpeedLimitsModel::onTorrentRemoved);
 }
 
@@ -41,6 +41,7 @@
 #include <util/functions.h>
 #include <util/log.h>
 #include <util/timer.h>
+#include <util/tracer.h>
 
 #include "core.h"
 #include "dbus/dbus.h"
@@ -406,6 +407,7 @@ void GUI::setupActions()
 
 void GUI::update()
 {
+    KT_TRACE_SCOPE("gui", "GUI::update");
     try {
         CurrentStats stats = core->getStats();
         status_bar->updateSpeed(stats.upload_speed, stats.download_speed);
@@ -4,7 +4,12 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 
+#include <algorithm>
+#include <iterator>
+
 #include <KLocalizedString>
+#include <QHostAddress>
+#include <QPair>
 #include <QStringList>
 
 #include "ipfilterlist.h"
@@ -17,8 +22,12 @@ using namespace bt;
 
 namespace kt
 {
+// Maximum number of edits kept beside the index before it is rebuilt
+static const size_t MAX_DELTA = 64;
+
 IPFilterList::IPFilterList()
     : bt::BlockListInterface()
+    , stats(QStringLiteral("manual"))
 {
 }
 
@@ -26,24 +35,148 @@ IPFilterList::~IPFilterList()
 {
 }
 
+Uint128 IPFilterList::toUint128(const QHostAddress &addr)
+{
+    if (addr.protocol() == QAbstractSocket::IPv4Protocol)
+        return Uint128::fromIPv4(addr.toIPv4Address());
+
+    Q_IPV6ADDR ip = addr.toIPv6Address();
+    return Uint128::fromBytes(ip.c);
+}
+
 bool IPFilterList::blocked(const net::Address &addr) const
 {
-    quint32 ip = 0;
-    if (addr.isIPv4Mapped())
-        ip = addr.convertIPv4Mapped().toIPv4Address();
-    else if (addr.ipVersion() != 4)
-        return false;
-    else
-        ip = addr.toIPv4Address();
+    BlockListStats::Lookup lookup(&stats);
 
-    for (const Entry &e : std::as_const(ip_list)) {
-        if (e.start <= ip && ip <= e.end)
+    // IPv4 mapped IPv6 addresses end up in the same place as plain IPv4 addresses
+    const Uint128 ip = toUint128(addr);
+    for (const Range &r : added) {
+        if (r.contains(ip)) {
+            stats.addHit(r.start, r.end);
             return true;
+        }
+    }
+
+    Uint128 start, end;
+    if (!blockedByBase(ip, start, end))
+        return false;
+
+    stats.addHit(start, end);
+    return true;
+}
+
+bool IPFilterList::blockedByBase(const Uint128 &ip, Uint128 &start, Uint128 &end) const
+{
+    Uint32 slot = index.find(ip);
+    if (slot == RangeIndex6::NOT_FOUND)
+        return false;
+
+    index.range(slot, start, end);
+
+    // If none of the removed ranges contain the address, a range which is still there does
+    std::vector<Range> gone;
+    for (const Range &r : removed) {
+        if (r.contains(ip))
+            gone.push_back(r);
     }
+    if (gone.empty())
+        return true;
 
+    // Rare, only until the next rebuild: look for a range containing the address which was not removed,
+    // the ranges before one whose max_end is below the address cannot contain it either
+    auto i = std::upper_bound(base.begin(), base.end(), Range{ip, ip});
+    while (i != base.begin()) {
+        --i;
+        if (max_end[i - base.begin()] < ip)
+            break;
+        if (!i->contains(ip))
+            continue;
+
+        auto g = std::find(gone.begin(), gone.end(), *i);
+        if (g == gone.end()) {
+            start = i->start;
+            end = i->end;
+            return true;
+        }
+        gone.erase(g);
+    }
     return false;
 }
 
+void IPFilterList::insertRange(const Range &r)
+{
+    added.push_back(r);
+}
+
+void IPFilterList::removeRange(const Range &r)
+{
+    auto i = std::find(added.begin(), added.end(), r);
+    if (i != added.end())
+        added.erase(i);
+    else
+        removed.push_back(r);
+}
+
+void IPFilterList::updateIndex()
+{
+    // lookups scan the delta lists, so keep them short
+    if (added.size() + removed.size() > MAX_DELTA)
+        rebuildIndex();
+}
+
+void IPFilterList::rebuildIndex()
+{
+    // Take out the removed ranges and merge in the added ones, both in one pass over base
+    std::sort(removed.begin(), removed.end(), [](const Range &a, const Range &b) {
+        return a.start < b.start || (a.start == b.start && a.end < b.end);
+    });
+    std::vector<Range> remaining;
+    remaining.reserve(base.size());
+    auto r = removed.begin();
+    for (const Range &b : base) {
+        while (r != removed.end() && (r->start < b.start || (r->start == b.start && r->end < b.end)))
+            ++r;
+        if (r != removed.end() && *r == b)
+            ++r;
+        else
+            remaining.push_back(b);
+    }
+
+    std::stable_sort(added.begin(), added.end());
+    base.clear();
+    base.reserve(remaining.size() + added.size());
+    std::merge(remaining.begin(), remaining.end(), added.begin(), added.end(), std::back_inserter(base));
+    added.clear();
+    removed.clear();
+
+    max_end.resize(base.size());
+    for (size_t i = 0; i < base.size(); i++)
+        max_end[i] = (i > 0 && base[i].end < max_end[i - 1]) ? max_end[i - 1] : base[i].end;
+
+    // base is sorted, so overlapping ranges can be merged in one pass
+    std::vector<Range> merged;
+    merged.reserve(base.size());
+    for (const Range &r : base) {
+        if (merged.empty()) {
+            merged.push_back(r);
+            continue;
+        }
+
+        Range &last = merged.back();
+        if (r.start <= last.end) {
+            if (last.end < r.end)
+                last.end = r.end;
+        } else {
+            merged.push_back(r);
+        }
+    }
+
+    index.build(merged.size(), [&merged](bt::Uint32 i, Uint128 &start, Uint128 &end) {
+        start = merged[i].start;
+        end = merged[i].end;
+    });
+}
+
 bool IPFilterList::parseIPWithWildcards(const QString &str, bt::Uint32 &start, bt::Uint32 &end)
 {
     QStringList ip_comps = str.split(QLatin1Char('.'));
@@ -74,41 +207,113 @@ bool IPFilterList::parseIPWithWildcards(const QString &str, bt::Uint32 &start, b
     }
 }
 
-bool IPFilterList::addIP(const QString &str)
+bool IPFilterList::parseIP(const QString &str, Uint128 &start, Uint128 &end)
 {
-    Entry e;
-    e.string_rep = str;
-    if (!parseIPWithWildcards(str, e.start, e.end))
+    bt::Uint32 start4 = 0;
+    bt::Uint32 end4 = 0;
+    if (parseIPWithWildcards(str, start4, end4)) {
+        start = Uint128::fromIPv4(start4);
+        end = Uint128::fromIPv4(end4);
+        return true;
+    }
+
+    // IPv6 address, or IPv6 prefix
+    if (!str.contains(QLatin1Char(':')))
         return false;
 
-    ip_list.append(e);
+    QHostAddress addr;
+    int prefix_len = 128;
+    if (str.contains(QLatin1Char('/'))) {
+        QPair<QHostAddress, int> subnet = QHostAddress::parseSubnet(str);
+        addr = subnet.first;
+        prefix_len = subnet.second;
+    } else if (!addr.setAddress(str)) {
+        return false;
+    }
+
+    if (addr.protocol() != QAbstractSocket::IPv6Protocol)
+        return false;
+
+    // parseSubnet gives us the network address, the end is that with all host bits set
+    start = toUint128(addr);
+    end = start;
+    if (prefix_len < 64) {
+        end.hi |= ~0ULL >> prefix_len;
+        end.lo = ~0ULL;
+    } else if (prefix_len < 128) {
+        end.lo |= ~0ULL >> (prefix_len - 64);
+    }
     return true;
 }
 
-bool IPFilterList::addIPRange(const QString &str)
+bool IPFilterList::parseIPRange(const QString &str, Uint128 &start, Uint128 &end)
 {
     QStringList range = str.split(QLatin1Char('-'));
     if (range.count() != 2)
         return false;
 
-    net::Address start;
-    net::Address end;
-    if (!start.setAddress(range[0]) || !end.setAddress(range[1]))
+    net::Address s;
+    net::Address e;
+    if (!s.setAddress(range[0].trimmed()) || !e.setAddress(range[1].trimmed()) || s.protocol() != e.protocol())
         return false;
 
-    Entry e = {str, start.toIPv4Address(), end.toIPv4Address()};
+    start = toUint128(s);
+    end = toUint128(e);
+    return start <= end;
+}
+
+bool IPFilterList::parseEntry(const QString &str, Uint128 &start, Uint128 &end)
+{
+    if (str.contains(QLatin1Char('-')))
+        return parseIPRange(str, start, end);
+    else
+        return parseIP(str, start, end);
+}
+
+bool IPFilterList::add(const QString &str)
+{
+    Entry e;
+    e.string_rep = str;
+    if (!parseEntry(str, e.start, e.end))
+        return false;
+
+    int pos = ip_list.count();
+    beginInsertRows(QModelIndex(), pos, pos);
     ip_list.append(e);
-    insertRow(ip_list.count());
+    endInsertRows();
+
+    insertRange({e.start, e.end});
+    updateIndex();
     return true;
 }
 
-bool IPFilterList::add(const QString &str)
+int IPFilterList::add(const QStringList &ips)
 {
+    QList<Entry> entries;
+    entries.reserve(ips.count());
+    int failed = 0;
+    for (const QString &str : ips) {
+        Entry e;
+        e.string_rep = str;
+        if (parseEntry(str, e.start, e.end))
+            entries.append(e);
+        else
+            failed++;
+    }
+
+    if (entries.isEmpty())
+        return failed;
+
     int pos = ip_list.count();
-    beginInsertRows(QModelIndex(), pos, pos + 1);
-    bool ret = addIPRange(str) || addIP(str);
+    beginInsertRows(QModelIndex(), pos, pos + entries.count() - 1);
+    ip_list.append(entries);
     endInsertRows();
-    return ret;
+
+    added.reserve(added.size() + entries.count());
+    for (const Entry &e : std::as_const(entries))
+        insertRange({e.start, e.end});
+    updateIndex();
+    return failed;
 }
 
 void IPFilterList::remove(int row, int count)
@@ -121,7 +326,13 @@ void IPFilterList::remove(int row, int count)
 
 void IPFilterList::clear()
 {
+    beginResetModel();
     ip_list.clear();
+    base.clear();
+    max_end.clear();
+    added.clear();
+    removed.clear();
+    index.clear();
     endResetModel();
 }
 
@@ -155,22 +366,17 @@ bool IPFilterList::setData(const QModelIndex &index, const QVariant &value, int
 
     Entry &e = ip_list[index.row()];
     QString str = value.toString();
-    QStringList range = str.split(QLatin1Char('-'));
-    if (range.count() != 2) {
-        if (!parseIPWithWildcards(str, e.start, e.end))
-            return false;
-
-        e.string_rep = str;
-    } else {
-        net::Address start;
-        net::Address end;
-        if (!start.setAddress(range[0]) || !end.setAddress(range[1]))
-            return false;
+    Uint128 start;
+    Uint128 end;
+    if (!parseEntry(str, start, end))
+        return false;
 
-        e.start = start.toIPv4Address();
-        e.end = end.toIPv4Address();
-        e.string_rep = str;
-    }
+    removeRange({e.start, e.end});
+    insertRange({start, end});
+    updateIndex();
+    e.start = start;
+    e.end = end;
+    e.string_rep = str;
 
     Q_EMIT dataChanged(index, index);
     return true;
@@ -192,9 +398,13 @@ bool IPFilterList::removeRows(int row, int count, const QModelIndex &parent)
         return false;
 
     beginRemoveRows(QModelIndex(), row, row + count - 1);
-    for (int i = 0; i < count; i++)
-        ip_list.removeAt(row);
+    for (int i = row; i < row + count; i++) {
+        const Entry &e = ip_list.at(i);
+        removeRange({e.start, e.end});
+    }
+    ip_list.remove(row, count);
     endRemoveRows();
+    updateIndex();
     return true;
 }
 
@@ -9,9 +9,15 @@
 
 #include <QAbstractListModel>
 #include <QList>
+#include <QStringList>
+#include <vector>
 
 #include <interfaces/blocklistinterface.h>
+#include <util/blockliststats.h>
 #include <util/constants.h>
+#include <util/rangeindex.h>
+
+class QHostAddress;
 
 namespace kt
 {
@@ -26,9 +32,12 @@ public:
 
     bool blocked(const net::Address &addr) const override;
 
-    /// Add an IP address with a mask.
+    /// Add an IP address with a mask, an IP range or an IPv6 prefix.
     bool add(const QString &ip);
 
+    /// Add several addresses at once, returns the number of them which could not be parsed
+    int add(const QStringList &ips);
+
     /// Remove the IP address at a given row and count items following that
     void remove(int row, int count);
 
@@ -42,19 +51,56 @@ public:
     bool removeRows(int row, int count, const QModelIndex &parent) override;
     Qt::ItemFlags flags(const QModelIndex &index) const override;
 
+    /// Convert an address to a 128 bit number, IPv4 addresses are mapped to ::ffff:a.b.c.d
+    static Uint128 toUint128(const QHostAddress &addr);
+
 private:
-    bool addIP(const QString &str);
-    bool addIPRange(const QString &str);
+    bool parseEntry(const QString &str, Uint128 &start, Uint128 &end);
     bool parseIPWithWildcards(const QString &str, bt::Uint32 &start, bt::Uint32 &end);
+    bool parseIP(const QString &str, Uint128 &start, Uint128 &end);
+    bool parseIPRange(const QString &str, Uint128 &start, Uint128 &end);
 
 private:
     struct Entry {
         QString string_rep;
-        bt::Uint32 start;
-        bt::Uint32 end;
+        Uint128 start;
+        Uint128 end;
     };
 
+    struct Range {
+        Uint128 start;
+        Uint128 end;
+
+        bool operator<(const Range &r) const
+        {
+            return start < r.start;
+        }
+
+        bool operator==(const Range &r) const
+        {
+            return start == r.start && end == r.end;
+        }
+
+        bool contains(const Uint128 &ip) const
+        {
+            return start <= ip && ip <= end;
+        }
+    };
+
+    void insertRange(const Range &r);
+    void removeRange(const Range &r);
+    void updateIndex();
+    void rebuildIndex();
+    bool blockedByBase(const Uint128 &ip, Uint128 &start, Uint128 &end) const;
+
     QList<Entry> ip_list;
+    // Edits go into small delta lists beside the index, which is only rebuilt once they get too long
+    std::vector<Range> base; // ranges the index was built from, sorted on start, may overlap
+    std::vector<Uint128> max_end; // highest end of base up to and including each range
+    RangeIndex6 index; // the merged base ranges
+    std::vector<Range> added; // ranges added since the index was built
+    std::vector<Range> removed; // ranges of base removed since the index was built
+    mutable BlockListStats stats;
 };
 
 }
@@ -86,10 +86,13 @@ void IPFilterWidget::add()
 
         QString ip = m_ip_to_add->text();
 
-        if (!regex_match(ip.toStdString(), rx) || !filter_list->add(ip)) {
+        // IPv6 addresses are validated by the filter list itself
+        bool valid = ip.contains(QLatin1Char(':')) || regex_match(ip.toStdString(), rx);
+        if (!valid || !filter_list->add(ip)) {
             KMessageBox::error(this,
                                i18n("Invalid IP address <b>%1</b>. IP addresses must be in the format 'XXX.XXX.XXX.XXX'."
-                                    "<br/><br/>You can also use wildcards like '127.0.0.*' or specify ranges like '200.10.10.0-200.10.10.40'.",
+                                    "<br/><br/>You can also use wildcards like '127.0.0.*' or specify ranges like '200.10.10.0-200.10.10.40'."
+                                    "<br/><br/>IPv6 addresses, ranges and prefixes like '2001:db8::/32' are also supported.",
                                     ip));
 
             return;
@@ -172,20 +175,20 @@ void IPFilterWidget::loadFilter(const QString &fn)
         "([0-9]{1,3}).([0-9]{1,3}).([0-9]{1,3}).([0-9]{1,3}))");
 
     bool err = false;
+    QStringList lines;
 
     while (!stream.atEnd()) {
         line = stream.readLine();
-        if (!regex_match(line.toStdString(), rx)) {
+        if (!line.contains(QLatin1Char(':')) && !regex_match(line.toStdString(), rx))
             err = true;
-        } else {
-            try {
-                filter_list->add(line);
-            } catch (...) {
-                err = true;
-            }
-        }
+        else
+            lines.append(line);
     }
 
+    // Add everything in one go, so the filter is only rebuilt once
+    if (filter_list->add(lines) > 0)
+        err = true;
+
     if (err)
         Out(SYS_IPF | LOG_NOTICE) << "Some lines could not be loaded. Check your filter file..." << endl;
 
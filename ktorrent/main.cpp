@@ -40,6 +40,7 @@
 #include <util/error.h>
 #include <util/functions.h>
 #include <util/log.h>
+#include <util/tracer.h>
 #ifndef Q_OS_WIN
 #include <util/signalcatcher.h>
 #endif
@@ -179,6 +180,9 @@ int main(int argc, char **argv)
     parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("verbose"),
                                         i18n("Enable logging to standard output. Requires --enable-logging to be specified as well.")));
     parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("silent"), i18n("Silently open torrent given on URL")));
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("trace"),
+                                        i18n("Record where time is spent, and save it in Chrome trace format to a file when quitting."),
+                                        QStringLiteral("file")));
     parser.addPositionalArgument(QStringLiteral("+[URL]"), i18n("Document to open"));
     parser.process(app);
     about.processCommandLine(&parser);
@@ -224,6 +228,11 @@ int main(int argc, char **argv)
             bt::InitLog(data_dir + QLatin1String("log"), true, true, logToStdout);
         }
 
+        // switched on before the GUI is created, so startup is traced too
+        const QString trace_file = parser.value(QStringLiteral("trace"));
+        if (!trace_file.isEmpty())
+            kt::Tracer::setEnabled(true);
+
         kt::GUI widget;
 
         auto handleCmdLine = [&widget, &parser](const QStringList &arguments, const QString &workingDirectory) {
@@ -256,6 +265,9 @@ int main(int argc, char **argv)
 
         app.setQuitOnLastWindowClosed(false);
         app.exec();
+
+        if (!trace_file.isEmpty())
+            kt::Tracer::save(trace_file);
     } catch (bt::Error &err) {
         Out(SYS_GEN | LOG_IMPORTANT) << "Uncaught exception: " << err.toString() << endl;
     } catch (std::exception &err) {
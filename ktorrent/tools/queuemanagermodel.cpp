@@ -430,7 +430,7 @@ void QueueManagerModel::updatePriorities()
 {
     int idx = queue.size();
     for (const Item &i : std::as_const(queue))
-        i.tc->setPriority(idx--);
+        qman->setPriority(i.tc, idx--);
 }
 
 void QueueManagerModel::update()
@@ -89,6 +89,7 @@ TorrentActivity::TorrentActivity(Core *core, GUI *gui, QWidget *parent)
 
     qm = new QueueManagerWidget(core->getQueueManager(), this);
     connect(core, &Core::torrentAdded, qm, &QueueManagerWidget::onTorrentAdded);
+    connect(core, &Core::torrentLoaded, qm, &QueueManagerWidget::onTorrentAdded);
     connect(core, &Core::torrentRemoved, qm, &QueueManagerWidget::onTorrentRemoved);
     tool_views->addTab(qm, i18n("Queue Manager"), QStringLiteral("kt-queue-manager"), i18n("Widget to manage the torrent queue"));
 
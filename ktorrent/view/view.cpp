@@ -413,10 +413,10 @@ void View::forceStartTorrents()
     QueueManager *qm = core->getQueueManager();
     if (qm->enabled()) {
         // Give everybody in the selection a high priority
-        int prio = qm->count();
+        int prio = qm->highestPriority();
         int idx = 0;
         for (bt::TorrentInterface *tc : std::as_const(sel))
-            tc->setPriority(prio + sel.count() - idx++);
+            qm->setPriority(tc, prio + sel.count() - idx++);
 
         core->start(sel);
     } else
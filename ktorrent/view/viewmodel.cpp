@@ -15,6 +15,8 @@
 #include <QLocale>
 #include <QMimeData>
 #include <QPalette>
+#include <QSet>
+#include <QTimer>
 
 #include <KLocalizedString>
 
@@ -24,6 +26,7 @@
 #include <torrent/timeestimator.h>
 #include <util/functions.h>
 #include <util/sha1hash.h>
+#include <util/tracer.h>
 
 #include "core.h"
 #include "settings.h"
@@ -59,8 +62,44 @@ ViewModel::Item::Item(bt::TorrentInterface *tc)
     highlight = false;
 }
 
+ViewModel::Item::Item(const TorrentSnapshot::Entry &e)
+    : tc(nullptr)
+    , snapshot(e)
+{
+    status = e.status;
+    bytes_downloaded = e.bytes_downloaded;
+    total_bytes_to_download = e.total_bytes_to_download;
+    bytes_uploaded = e.bytes_uploaded;
+    bytes_left = e.bytes_left;
+    download_rate = 0;
+    upload_rate = 0;
+    eta = bt::TimeEstimator::ALREADY_FINISHED;
+    seeders_connected_to = seeders_total = 0;
+    leechers_connected_to = leechers_total = 0;
+    percentage = e.percentage;
+    share_ratio = e.share_ratio;
+    runtime_dl = runtime_ul = 0;
+    hidden = false;
+    time_added = QDateTime::fromSecsSinceEpoch(e.time_added);
+    highlight = false;
+}
+
+QString ViewModel::Item::displayName() const
+{
+    return tc ? tc->getDisplayName() : snapshot.name;
+}
+
+QString ViewModel::Item::location() const
+{
+    return tc ? tc->getStats().output_path : snapshot.output_path;
+}
+
 bool ViewModel::Item::update(int row, int sort_column, QModelIndexList &to_update, kt::ViewModel *model)
 {
+    // placeholders do not change
+    if (!tc)
+        return false;
+
     bool ret = false;
     const TorrentStats &s = tc->getStats();
 
@@ -110,10 +149,9 @@ bool ViewModel::Item::update(int row, int sort_column, QModelIndexList &to_updat
 QVariant ViewModel::Item::data(int col) const
 {
     static QLocale locale;
-    const TorrentStats &s = tc->getStats();
     switch (col) {
     case NAME:
-        return tc->getDisplayName();
+        return displayName();
     case BYTES_DOWNLOADED:
         return BytesToString(bytes_downloaded);
     case TOTAL_BYTES_TO_DOWNLOAD:
@@ -123,7 +161,7 @@ QVariant ViewModel::Item::data(int col) const
     case BYTES_LEFT:
         return bytes_left > 0 ? BytesToString(bytes_left) : QVariant();
     case DOWNLOAD_RATE:
-        if (download_rate >= 103 && s.bytes_left_to_download > 0) // lowest "visible" speed, all below will be 0,0 Kb/s
+        if (download_rate >= 103 && tc->getStats().bytes_left_to_download > 0) // lowest "visible" speed, all below will be 0,0 Kb/s
             return BytesPerSecToString(download_rate);
         else
             return QVariant();
@@ -140,8 +178,12 @@ QVariant ViewModel::Item::data(int col) const
         else
             return QVariant();
     case SEEDERS:
+        if (!tc)
+            return QVariant();
         return QString(QString::number(seeders_connected_to) + QLatin1String(" (") + QString::number(seeders_total) + QLatin1Char(')'));
     case LEECHERS:
+        if (!tc)
+            return QVariant();
         return QString(QString::number(leechers_connected_to) + QLatin1String(" (") + QString::number(leechers_total) + QLatin1Char(')'));
     // xgettext: no-c-format
     case PERCENTAGE:
@@ -149,11 +191,11 @@ QVariant ViewModel::Item::data(int col) const
     case SHARE_RATIO:
         return locale.toString(share_ratio, 'f', 2);
     case DOWNLOAD_TIME:
-        return DurationToString(runtime_dl);
+        return tc ? DurationToString(runtime_dl) : QVariant();
     case SEED_TIME:
-        return DurationToString(runtime_ul);
+        return tc ? DurationToString(runtime_ul) : QVariant();
     case DOWNLOAD_LOCATION:
-        return tc->getStats().output_path;
+        return location();
     case TIME_ADDED:
         return locale.toString(time_added, QLocale::ShortFormat);
     default:
@@ -165,7 +207,7 @@ bool ViewModel::Item::lessThan(int col, const Item *other) const
 {
     switch (col) {
     case NAME:
-        return QString::localeAwareCompare(tc->getDisplayName(), other->tc->getDisplayName()) < 0;
+        return QString::localeAwareCompare(displayName(), other->displayName()) < 0;
     case BYTES_DOWNLOADED:
         return bytes_downloaded < other->bytes_downloaded;
     case TOTAL_BYTES_TO_DOWNLOAD:
@@ -199,7 +241,7 @@ bool ViewModel::Item::lessThan(int col, const Item *other) const
     case SEED_TIME:
         return runtime_ul < other->runtime_ul;
     case DOWNLOAD_LOCATION:
-        return tc->getStats().output_path < other->tc->getStats().output_path;
+        return location() < other->location();
     case TIME_ADDED:
         return time_added < other->time_added;
     default:
@@ -217,7 +259,7 @@ QVariant ViewModel::Item::color(int col) const
         case bt::ALLOCATING_DISKSPACE:
         case bt::STALLED:
         case bt::CHECKING_DATA: {
-            if (Settings::highlightTorrentNameByTrackerStatus()) {
+            if (tc && Settings::highlightTorrentNameByTrackerStatus()) {
                 // apply additional highlighting to torrent names
                 const bt::TrackersStatusInfo tsi = tc->getTrackersList()->getTrackersStatusInfo();
                 if (tsi.trackers_count) {
@@ -252,15 +294,19 @@ QVariant ViewModel::Item::color(int col) const
 
 bool ViewModel::Item::visible(Group *group, const QString &filter_string) const
 {
-    if (group && !group->isMember(tc))
-        return false;
+    if (group) {
+        // group membership of placeholders is taken from the snapshot
+        if (tc ? !group->isMember(tc) : !snapshot.groups.contains(group->groupPath()))
+            return false;
+    }
 
-    return filter_string.isEmpty() || tc->getDisplayName().contains(filter_string, Qt::CaseInsensitive);
+    return filter_string.isEmpty() || displayName().contains(filter_string, Qt::CaseInsensitive);
 }
 
 QVariant ViewModel::Item::statusIcon() const
 {
-    switch (tc->getStats().status) {
+    const bool completed = tc ? tc->getStats().completed : snapshot.completed;
+    switch (status) {
     case NOT_STARTED:
     case STOPPED:
         return QIcon::fromTheme(QStringLiteral("kt-stop"));
@@ -273,7 +319,7 @@ QVariant ViewModel::Item::statusIcon() const
     case DOWNLOADING:
         return QIcon::fromTheme(QStringLiteral("go-down"));
     case STALLED:
-        if (tc->getStats().completed)
+        if (completed)
             return QIcon::fromTheme(QStringLiteral("go-up"));
         else
             return QIcon::fromTheme(QStringLiteral("go-down"));
@@ -283,7 +329,7 @@ QVariant ViewModel::Item::statusIcon() const
     case NO_SPACE_LEFT:
         return QIcon::fromTheme(QStringLiteral("dialog-error"));
     case QUEUED:
-        return QIcon::fromTheme(tc->getStats().completed ? QStringLiteral("upload-later") : QStringLiteral("download-later"));
+        return QIcon::fromTheme(completed ? QStringLiteral("upload-later") : QStringLiteral("download-later"));
     case CHECKING_DATA:
         return QIcon::fromTheme(QStringLiteral("kt-check-data"));
     case PAUSED:
@@ -302,17 +348,37 @@ ViewModel::ViewModel(Core *core, View *parent)
 {
     connect(core, &Core::aboutToQuit, this, &ViewModel::onExit); // model must be in core's thread to be notified in time
     connect(core, &Core::torrentAdded, this, &ViewModel::addTorrent);
+    connect(core, &Core::torrentLoaded, this, &ViewModel::loadTorrent);
     connect(core, &Core::torrentRemoved, this, &ViewModel::removeTorrent);
     sort_column = 0;
     sort_order = Qt::AscendingOrder;
     group = nullptr;
     num_visible = 0;
+    resort_pending = false;
 
     const kt::QueueManager *const qman = core->getQueueManager();
+    QSet<QString> loaded;
     for (bt::TorrentInterface *i : *qman) {
         torrents.append(new Item(i));
+        loaded.insert(i->getInfoHash().toString());
+        num_visible++;
+    }
+
+    // Show the torrents which are still being loaded as they were in the previous session
+    const TorrentSnapshot &snapshot = core->startupSnapshot();
+    for (int i = 0; i < snapshot.count(); i++) {
+        const TorrentSnapshot::Entry &e = snapshot.entry(i);
+        if (loaded.contains(e.info_hash) || placeholders.contains(e.info_hash))
+            continue;
+
+        Item *item = new Item(e);
+        torrents.append(item);
+        placeholders.insert(e.info_hash, item);
         num_visible++;
     }
+
+    if (!placeholders.isEmpty())
+        connect(core, &Core::torrentsLoaded, this, &ViewModel::removePlaceholders);
 }
 
 ViewModel::~ViewModel()
@@ -351,6 +417,30 @@ void ViewModel::addTorrent(bt::TorrentInterface *ti)
     }
 }
 
+void ViewModel::loadTorrent(bt::TorrentInterface *ti)
+{
+    // A torrent loaded at startup takes over its placeholder, in place, its row may move
+    // once the real stats are in, which is left to the sort after the batch
+    Item *placeholder = placeholders.take(ti->getInfoHash().toString());
+    if (placeholder) {
+        const bool hidden = placeholder->hidden;
+        *placeholder = Item(ti);
+        placeholder->hidden = hidden;
+    } else {
+        // Existing torrents are not highlighted or scrolled to. They are loaded in batches,
+        // the new rows show up when the batch is sorted, once it has been loaded.
+        torrents.append(new Item(ti));
+    }
+
+    if (!resort_pending) {
+        resort_pending = true;
+        QTimer::singleShot(0, this, [this]() {
+            if (resort_pending)
+                update(view->viewDelegate(), true);
+        });
+    }
+}
+
 void ViewModel::removeTorrent(bt::TorrentInterface *ti)
 {
     int idx = 0;
@@ -364,6 +454,18 @@ void ViewModel::removeTorrent(bt::TorrentInterface *ti)
     }
 }
 
+void ViewModel::removePlaceholders()
+{
+    // Torrents which could not be loaded
+    for (int idx = torrents.count() - 1; idx >= 0; idx--) {
+        if (!torrents[idx]->tc)
+            removeRow(idx);
+    }
+
+    placeholders.clear();
+    update(view->viewDelegate(), true);
+}
+
 void ViewModel::emitDataChanged(int row, int col)
 {
     QModelIndex idx = createIndex(row, col);
@@ -373,8 +475,10 @@ void ViewModel::emitDataChanged(int row, int col)
 
 bool ViewModel::update(ViewDelegate *delegate, bool force_resort)
 {
+    KT_TRACE_SCOPE("gui", "ViewModel::update");
     update_list.clear();
-    bool resort = force_resort;
+    bool resort = force_resort || resort_pending;
+    resort_pending = false;
     num_visible = 0;
 
     int row = 0;
@@ -389,7 +493,7 @@ bool ViewModel::update(ViewDelegate *delegate, bool force_resort)
         }
 
         // hide the extender if there is one shown
-        if (hidden && delegate->extended(i->tc))
+        if (hidden && i->tc && delegate->extended(i->tc))
             delegate->hideExtender(i->tc);
 
         if (!i->hidden)
@@ -537,12 +641,15 @@ QVariant ViewModel::data(const QModelIndex &index, int role) const
     } else if (role == Qt::DisplayRole) {
         return item->data(index.column());
     } else if (role == Qt::EditRole && index.column() == NAME) {
-        return item->tc->getDisplayName();
+        return item->displayName();
     } else if (role == Qt::DecorationRole && index.column() == NAME) {
         return item->statusIcon();
     } else if (role == Qt::ToolTipRole && index.column() == NAME) {
         QString tooltip;
         bt::TorrentInterface *tc = item->tc;
+        if (!tc)
+            return i18n("%1<br/><br/>Loading...", item->displayName());
+
         if (tc->loadUrl().isValid())
             tooltip = i18n("%1<br>Url: <b>%2</b>", tc->getDisplayName(), tc->loadUrl().toDisplayString());
         else
@@ -579,7 +686,7 @@ bool ViewModel::setData(const QModelIndex &index, const QVariant &value, int rol
 
     QString name = value.toString();
     Item *item = reinterpret_cast<Item *>(index.internalPointer());
-    if (!item)
+    if (!item || !item->tc)
         return false;
 
     bt::TorrentInterface *tc = item->tc;
@@ -595,6 +702,11 @@ Qt::ItemFlags ViewModel::flags(const QModelIndex &index) const
     if (!index.isValid() || index.row() >= torrents.count())
         return QAbstractTableModel::flags(index) | Qt::ItemIsDropEnabled;
 
+    // Placeholders can only be looked at until their torrent has been loaded
+    const Item *item = reinterpret_cast<const Item *>(index.internalPointer());
+    if (item && !item->tc)
+        return Qt::ItemIsEnabled;
+
     Qt::ItemFlags flags = QAbstractTableModel::flags(index) | Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled;
     if (index.column() == NAME)
         flags |= Qt::ItemIsEditable;
@@ -689,7 +801,7 @@ bt::TorrentInterface *ViewModel::torrentFromRow(int index) const
 void ViewModel::allTorrents(QList<bt::TorrentInterface *> &tlist) const
 {
     for (Item *item : std::as_const(torrents)) {
-        if (item->visible(group, filter_string))
+        if (item->tc && item->visible(group, filter_string))
             tlist.append(item->tc);
     }
 }
@@ -8,8 +8,10 @@
 #define KTVIEWMODEL_H
 
 #include <QAbstractTableModel>
+#include <QHash>
 #include <QList>
 
+#include <torrent/torrentsnapshot.h>
 #include <torrent/torrentstats.h>
 #include <util/constants.h>
 
@@ -112,7 +114,7 @@ public:
     void visit(Action &a)
     {
         for (Item *item : std::as_const(torrents)) {
-            if (item->visible(group, filter_string))
+            if (item->tc && item->visible(group, filter_string))
                 if (!a(item->tc))
                     break;
         }
@@ -126,7 +128,9 @@ public:
 
 public Q_SLOTS:
     void addTorrent(bt::TorrentInterface *ti);
+    void loadTorrent(bt::TorrentInterface *ti);
     void removeTorrent(bt::TorrentInterface *ti);
+    void removePlaceholders();
     void sort(int col, Qt::SortOrder order) override;
     void onExit();
 
@@ -154,8 +158,14 @@ public:
         _NUMBER_OF_COLUMNS,
     };
 
+    /**
+     * A row in the view. Until all torrents have been loaded at startup, the torrents
+     * which are not loaded yet are shown as placeholders, which have no tc, using the
+     * values from the snapshot of the previous session.
+     */
     struct Item {
         bt::TorrentInterface *tc;
+        TorrentSnapshot::Entry snapshot; // only set for placeholders
         // cached values to avoid unneeded updates
         bt::TorrentStatus status;
         bt::Uint64 bytes_downloaded;
@@ -178,7 +188,10 @@ public:
         bool highlight;
 
         Item(bt::TorrentInterface *tc);
+        Item(const TorrentSnapshot::Entry &e);
 
+        QString displayName() const;
+        QString location() const;
         bool update(int row, int sort_column, QModelIndexList &to_update, ViewModel *model);
         QVariant data(int col) const;
         QVariant color(int col) const;
@@ -197,6 +210,8 @@ private:
     int num_visible;
     QModelIndexList update_list;
     QString filter_string;
+    QHash<QString, Item *> placeholders; // placeholders by info hash
+    bool resort_pending; // torrents were loaded, the next update sorts
 };
 
 }
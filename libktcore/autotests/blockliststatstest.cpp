@@ -0,0 +1,123 @@
+/*
+   SPDX-FileCopyrightText: 2026 The KTorrent developers
+   SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <util/blockliststats.h>
+
+#include <QThreadPool>
+#include <QtTest>
+
+namespace kt
+{
+
+class BlockListStatsTests : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void countLookups()
+    {
+        BlockListStats stats(QStringLiteral("test"));
+        for (int i = 0; i < 1000; i++) {
+            BlockListStats::Lookup lookup(&stats);
+        }
+
+        BlockListStats::Snapshot s = stats.snapshot(10);
+        QCOMPARE(s.lookups, bt::Uint64(1000));
+        QCOMPARE(s.hits, bt::Uint64(0));
+        QCOMPARE(s.latency.count(), int(BlockListStats::LATENCY_BUCKETS));
+
+        bt::Uint64 sampled = 0;
+        for (bt::Uint64 v : std::as_const(s.latency))
+            sampled += v;
+        QCOMPARE(sampled, bt::Uint64((1000 + BlockListStats::LATENCY_SAMPLE_INTERVAL - 1) / BlockListStats::LATENCY_SAMPLE_INTERVAL));
+    }
+
+    void hotRanges()
+    {
+        BlockListStats stats(QStringLiteral("test"));
+        const Uint128 a = Uint128::fromIPv4(0x01000000);
+        const Uint128 b = Uint128::fromIPv4(0x010000FF);
+        const Uint128 c = Uint128::fromIPv4(0x02000000);
+        const Uint128 d = Uint128::fromIPv4(0x020000FF);
+        stats.addHit(a, b);
+        stats.addHit(c, d);
+        stats.addHit(c, d);
+
+        BlockListStats::Snapshot s = stats.snapshot(10);
+        QCOMPARE(s.hits, bt::Uint64(3));
+        QCOMPARE(s.hot_ranges.count(), 2);
+        QVERIFY(s.hot_ranges[0].start == c);
+        QCOMPARE(s.hot_ranges[0].hits, bt::Uint64(2));
+        QVERIFY(s.hot_ranges[1].start == a);
+
+        s = stats.snapshot(1);
+        QCOMPARE(s.hot_ranges.count(), 1);
+
+        // Once the table is full, a range which keeps getting hit still gets in
+        for (int i = 0; i < BlockListStats::MAX_HOT_RANGES; i++)
+            stats.addHit(Uint128::fromIPv4(0x10000000 + i * 2), Uint128::fromIPv4(0x10000000 + i * 2 + 1));
+
+        const Uint128 e = Uint128::fromIPv4(0x20000000);
+        for (int i = 0; i < 5; i++)
+            stats.addHit(e, e);
+
+        s = stats.snapshot(1);
+        QVERIFY(s.hot_ranges[0].start == e);
+    }
+
+    void hitsFromThreads()
+    {
+        BlockListStats stats(QStringLiteral("test"));
+        const Uint128 a = Uint128::fromIPv4(0x01000000);
+        const Uint128 b = Uint128::fromIPv4(0x02000000);
+
+        // more hits than fit in the ring, none of them may get lost
+        QThreadPool pool;
+        pool.setMaxThreadCount(4);
+        for (int i = 0; i < 4; i++) {
+            pool.start([&stats, &a, &b, i]() {
+                for (int j = 0; j < 10000; j++)
+                    stats.addHit(i % 2 ? a : b, i % 2 ? a : b);
+            });
+        }
+        pool.waitForDone();
+
+        BlockListStats::Snapshot s = stats.snapshot(10);
+        QCOMPARE(s.hits, bt::Uint64(40000));
+        QCOMPARE(s.hot_ranges.count(), 2);
+        QCOMPARE(s.hot_ranges[0].hits, bt::Uint64(20000));
+        QCOMPARE(s.hot_ranges[1].hits, bt::Uint64(20000));
+    }
+
+    void registry()
+    {
+        QVERIFY(!BlockListStats::names().contains(QStringLiteral("registered")));
+        {
+            BlockListStats stats(QStringLiteral("registered"));
+            QVERIFY(BlockListStats::names().contains(QStringLiteral("registered")));
+            stats.startLookup();
+
+            BlockListStats::Snapshot s;
+            QVERIFY(BlockListStats::snapshot(QStringLiteral("registered"), 0, s));
+            QCOMPARE(s.lookups, bt::Uint64(1));
+
+            QVERIFY(BlockListStats::reset(QStringLiteral("registered")));
+            QVERIFY(BlockListStats::snapshot(QStringLiteral("registered"), 0, s));
+            QCOMPARE(s.lookups, bt::Uint64(0));
+        }
+
+        BlockListStats::Snapshot s;
+        QVERIFY(!BlockListStats::names().contains(QStringLiteral("registered")));
+        QVERIFY(!BlockListStats::snapshot(QStringLiteral("registered"), 0, s));
+        QVERIFY(!BlockListStats::reset(QStringLiteral("registered")));
+    }
+};
+
+}
+
+QTEST_GUILESS_MAIN(kt::BlockListStatsTests)
+
+#include "blockliststatstest.moc"
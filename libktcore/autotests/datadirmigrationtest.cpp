@@ -0,0 +1,158 @@
+/*
+   SPDX-FileCopyrightText: 2026 The KTorrent developers
+   SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <torrent/datadirmigration.h>
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace kt
+{
+
+static void MakeFile(const QString &path, int size = 1024)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile fptr(path);
+    QVERIFY(fptr.open(QIODevice::WriteOnly));
+    fptr.write(QByteArray(size, 'x'));
+}
+
+static void MakeTorrentDir(const QString &dir)
+{
+    MakeFile(dir + QStringLiteral("/torrent"));
+    MakeFile(dir + QStringLiteral("/stats"));
+    MakeFile(dir + QStringLiteral("/dnd/file.dnd"));
+}
+
+static bool IsTorrentDir(const QString &dir)
+{
+    return QFile::exists(dir + QStringLiteral("/torrent")) && QFile::exists(dir + QStringLiteral("/stats"))
+        && QFile::exists(dir + QStringLiteral("/dnd/file.dnd"));
+}
+
+class DataDirMigrationTests : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void moveAll()
+    {
+        QTemporaryDir tmp;
+        const QString journal = tmp.filePath(QStringLiteral("migration"));
+        const QString from = tmp.filePath(QStringLiteral("old/"));
+        const QString to = tmp.filePath(QStringLiteral("new/"));
+
+        QStringList dirs;
+        for (int i = 0; i < 20; i++) {
+            dirs.append(QStringLiteral("tor%1/").arg(i));
+            MakeTorrentDir(from + dirs.last());
+        }
+
+        {
+            DataDirMigration m(journal, 4);
+            QVERIFY(!m.isPending(to));
+            QVERIFY(m.prepare(from, to));
+        }
+
+        // next start
+        DataDirMigration m(journal, 4);
+        QVERIFY(m.isPending(to));
+        QCOMPARE(m.source(), from);
+
+        QSignalSpy finished(&m, &DataDirMigration::finished);
+        QSignalSpy progress(&m, &DataDirMigration::progress);
+        m.start(dirs);
+        QVERIFY(m.isRunning());
+        QVERIFY(finished.wait(10000));
+
+        QVERIFY(!m.isRunning());
+        QVERIFY(!m.isPending(to));
+        QVERIFY(m.failed().isEmpty());
+        QCOMPARE(progress.count(), 20);
+        QCOMPARE(progress.last().at(0).toInt(), 20);
+        for (const QString &d : std::as_const(dirs)) {
+            QVERIFY(IsTorrentDir(to + d));
+            QVERIFY(!QFile::exists(from + d));
+        }
+        QVERIFY(!QFile::exists(journal));
+    }
+
+    void resumeInterrupted()
+    {
+        QTemporaryDir tmp;
+        const QString journal = tmp.filePath(QStringLiteral("migration"));
+        const QString from = tmp.filePath(QStringLiteral("old/"));
+        const QString to = tmp.filePath(QStringLiteral("new/"));
+
+        // tor0 was not touched yet
+        MakeTorrentDir(from + QStringLiteral("tor0"));
+        // tor1 was being copied
+        MakeTorrentDir(from + QStringLiteral("tor1"));
+        MakeFile(to + QStringLiteral("tor1.part/torrent"));
+        // tor2 was copied, but removing the original did not finish
+        MakeTorrentDir(to + QStringLiteral("tor2"));
+        MakeFile(from + QStringLiteral("tor2/stats"));
+        // tor3 has a namesake in the new directory which is something else
+        MakeTorrentDir(from + QStringLiteral("tor3"));
+        MakeFile(to + QStringLiteral("tor3/torrent"), 10);
+
+        DataDirMigration m(journal, 2);
+        QVERIFY(m.prepare(from, to));
+        QSignalSpy finished(&m, &DataDirMigration::finished);
+        const QStringList dirs = {QStringLiteral("tor0/"), QStringLiteral("tor1/"), QStringLiteral("tor2/"), QStringLiteral("tor3/")};
+        m.start(dirs);
+        QVERIFY(finished.wait(10000));
+
+        for (int i = 0; i < 3; i++) {
+            QVERIFY(IsTorrentDir(to + dirs[i]));
+            QVERIFY(!QFile::exists(from + dirs[i]));
+        }
+        QVERIFY(!QFile::exists(to + QStringLiteral("tor1.part")));
+
+        // tor3 stays where it is, and the journal is kept to try again
+        QCOMPARE(m.failed(), QStringList{QStringLiteral("tor3/")});
+        QVERIFY(IsTorrentDir(from + QStringLiteral("tor3")));
+        QVERIFY(QFile::exists(journal));
+    }
+
+    void nothingToMove()
+    {
+        QTemporaryDir tmp;
+        const QString journal = tmp.filePath(QStringLiteral("migration"));
+        DataDirMigration m(journal, 2);
+        QVERIFY(m.prepare(tmp.filePath(QStringLiteral("old/")), tmp.filePath(QStringLiteral("new/"))));
+
+        QSignalSpy finished(&m, &DataDirMigration::finished);
+        m.start(QStringList());
+        QVERIFY(finished.wait(10000));
+        QVERIFY(!QFile::exists(journal));
+    }
+
+    void cancel()
+    {
+        QTemporaryDir tmp;
+        const QString journal = tmp.filePath(QStringLiteral("migration"));
+        const QString to = tmp.filePath(QStringLiteral("new/"));
+        {
+            DataDirMigration m(journal, 2);
+            QVERIFY(m.prepare(tmp.filePath(QStringLiteral("old/")), to));
+            m.cancel();
+            QVERIFY(!m.isPending(to));
+        }
+
+        DataDirMigration m(journal, 2);
+        QVERIFY(!m.isPending(to));
+    }
+};
+
+}
+
+QTEST_GUILESS_MAIN(kt::DataDirMigrationTests)
+
+#include "datadirmigrationtest.moc"
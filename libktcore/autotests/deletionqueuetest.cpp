@@ -0,0 +1,178 @@
+/*
+   SPDX-FileCopyrightText: 2026 The KTorrent developers
+   SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <torrent/deletionqueue.h>
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace kt
+{
+
+static void MakeFile(const QString &path)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile fptr(path);
+    QVERIFY(fptr.open(QIODevice::WriteOnly));
+    fptr.write(QByteArray(1024, 'x'));
+}
+
+/// A torrent with its torrent directory and a data directory with some files in subdirectories
+static DeletionQueue::Job MakeTorrent(const QString &base, const QString &name, int num_files)
+{
+    DeletionQueue::Job job;
+    job.tor_dir = base + QStringLiteral("/tor_") + name + QLatin1Char('/');
+    MakeFile(job.tor_dir + QStringLiteral("torrent"));
+    MakeFile(job.tor_dir + QStringLiteral("stats"));
+
+    job.data_dir = base + QStringLiteral("/data/") + name;
+    for (int i = 0; i < num_files; i++) {
+        const QString file = job.data_dir + QStringLiteral("/dir%1/file%2").arg(i % 3).arg(i);
+        MakeFile(file);
+        job.files.append(file);
+    }
+    return job;
+}
+
+class DeletionQueueTests : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void deleteInBackground()
+    {
+        QTemporaryDir dir;
+        const QString journal = dir.filePath(QStringLiteral("deletions"));
+        DeletionQueue queue(journal, 2);
+        QSignalSpy finished(&queue, &DeletionQueue::finished);
+        QSignalSpy progress(&queue, &DeletionQueue::progress);
+        queue.start();
+
+        QList<DeletionQueue::Job> jobs;
+        for (int i = 0; i < 5; i++) {
+            jobs.append(MakeTorrent(dir.path(), QString::number(i), 100));
+            queue.add(jobs.last());
+        }
+
+        QVERIFY(finished.wait(10000));
+        QCOMPARE(queue.pending(), 0);
+        for (const DeletionQueue::Job &job : std::as_const(jobs)) {
+            QVERIFY(!QFile::exists(job.tor_dir));
+            QVERIFY(!QFile::exists(job.data_dir));
+            for (const QString &f : job.files)
+                QVERIFY(!QFile::exists(f));
+        }
+
+        // Nothing left to resume
+        QVERIFY(!QFile::exists(journal));
+
+        // The last progress report has all files done
+        QVERIFY(progress.count() > 0);
+        QCOMPARE(progress.last().at(0).toInt(), progress.last().at(1).toInt());
+        QCOMPARE(progress.last().at(1).toInt(), 5 * 102);
+    }
+
+    void keepOtherFiles()
+    {
+        // Files which do not belong to the torrent stay, and so do the directories they are in
+        QTemporaryDir dir;
+        DeletionQueue queue(dir.filePath(QStringLiteral("deletions")), 1);
+        QSignalSpy finished(&queue, &DeletionQueue::finished);
+        queue.start();
+
+        const DeletionQueue::Job job = MakeTorrent(dir.path(), QStringLiteral("a"), 10);
+        const QString other = job.data_dir + QStringLiteral("/dir1/other");
+        MakeFile(other);
+        queue.add(job);
+
+        QVERIFY(finished.wait(10000));
+        QVERIFY(QFile::exists(other));
+        QVERIFY(!QFile::exists(job.data_dir + QStringLiteral("/dir0")));
+        QVERIFY(!QFile::exists(job.tor_dir));
+    }
+
+    void keepReaddedFiles()
+    {
+        // A torrent added again at the same location keeps its files, and the directories they are in
+        QTemporaryDir dir;
+        DeletionQueue queue(dir.filePath(QStringLiteral("deletions")), 1);
+        QSignalSpy finished(&queue, &DeletionQueue::finished);
+
+        const DeletionQueue::Job job = MakeTorrent(dir.path(), QStringLiteral("a"), 10);
+        const DeletionQueue::Job other = MakeTorrent(dir.path(), QStringLiteral("b"), 10);
+        queue.add(job);
+        queue.add(other);
+        queue.keep({job.files[0], job.files[1], job.data_dir + QStringLiteral("/dir2/new")});
+        queue.start();
+
+        QVERIFY(finished.wait(10000));
+        QVERIFY(QFile::exists(job.files[0]));
+        QVERIFY(QFile::exists(job.files[1]));
+        for (int i = 2; i < job.files.count(); i++)
+            QVERIFY(!QFile::exists(job.files[i]));
+        QVERIFY(QFile::exists(job.data_dir + QStringLiteral("/dir2")));
+        QVERIFY(!QFile::exists(job.tor_dir));
+        QVERIFY(!QFile::exists(other.data_dir));
+
+        // Removed again, now they go
+        queue.add(job);
+        QVERIFY(finished.wait(10000));
+        QVERIFY(!QFile::exists(job.data_dir));
+    }
+
+    void pendingIn()
+    {
+        QTemporaryDir dir;
+        DeletionQueue queue(dir.filePath(QStringLiteral("deletions")), 1);
+        const DeletionQueue::Job job = MakeTorrent(dir.path(), QStringLiteral("a"), 10);
+        QVERIFY(!queue.isPendingIn(job.data_dir));
+
+        queue.add(job);
+        QVERIFY(queue.isPendingIn(job.data_dir));
+        QVERIFY(queue.isPendingIn(job.data_dir + QStringLiteral("/")));
+        QVERIFY(queue.isPendingIn(job.files[0]));
+        QVERIFY(queue.isPendingIn(dir.path()));
+        QVERIFY(!queue.isPendingIn(job.data_dir + QStringLiteral("x")));
+        QVERIFY(!queue.isPendingIn(dir.filePath(QStringLiteral("b"))));
+    }
+
+    void resume()
+    {
+        QTemporaryDir dir;
+        const QString journal = dir.filePath(QStringLiteral("deletions"));
+        const DeletionQueue::Job job = MakeTorrent(dir.path(), QStringLiteral("a"), 10);
+
+        {
+            // Not started yet when we quit
+            DeletionQueue queue(journal, 2);
+            queue.add(job);
+            QVERIFY(queue.isPending(job.tor_dir));
+        }
+        QVERIFY(QFile::exists(job.tor_dir));
+        QVERIFY(QFile::exists(journal));
+
+        DeletionQueue queue(journal, 2);
+        QCOMPARE(queue.pending(), 1);
+        QVERIFY(queue.isPending(job.tor_dir));
+
+        QSignalSpy finished(&queue, &DeletionQueue::finished);
+        queue.start();
+        QVERIFY(finished.wait(10000));
+        QCOMPARE(queue.pending(), 0);
+        QVERIFY(!QFile::exists(job.tor_dir));
+        QVERIFY(!QFile::exists(job.data_dir));
+        QVERIFY(!QFile::exists(journal));
+    }
+};
+
+}
+
+QTEST_GUILESS_MAIN(kt::DeletionQueueTests)
+
+#include "deletionqueuetest.moc"
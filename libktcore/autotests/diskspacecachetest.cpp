@@ -0,0 +1,97 @@
+/*
+   SPDX-FileCopyrightText: 2026 The KTorrent developers
+   SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <util/diskspacecache.h>
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace kt
+{
+
+/// Pretends everything below the data directory is on one file system, and everything else on another
+class FakeDiskSpaceCache : public DiskSpaceCache
+{
+public:
+    FakeDiskSpaceCache(const QString &data_dir)
+        : DiskSpaceCache(1000)
+        , data_dir(data_dir)
+        , data_free(1000000)
+        , queries(0)
+    {
+    }
+
+    QString queryMountPoint(const QString &path) const override
+    {
+        return path.startsWith(data_dir) ? data_dir : QStringLiteral("/");
+    }
+
+    bool queryFreeSpace(const QString &mount_point, bt::Uint64 &bytes) const override
+    {
+        queries++;
+        bytes = mount_point == data_dir ? data_free : 5000000;
+        return true;
+    }
+
+    QString data_dir;
+    bt::Uint64 data_free;
+    mutable int queries;
+};
+
+class DiskSpaceCacheTests : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void oncePerMountPoint()
+    {
+        QTemporaryDir dir;
+        FakeDiskSpaceCache cache(dir.path());
+        bt::Uint64 bytes = 0;
+        for (int i = 0; i < 100; i++) {
+            // torrents which have not created their files yet
+            QVERIFY(cache.freeSpace(dir.filePath(QStringLiteral("torrent%1").arg(i)), bytes, 0));
+            QCOMPARE(bytes, bt::Uint64(1000000));
+        }
+        QVERIFY(cache.freeSpace(QStringLiteral("/"), bytes, 0));
+        QCOMPARE(bytes, bt::Uint64(5000000));
+        QCOMPARE(cache.queries, 2);
+        QCOMPARE(cache.mountPoints().count(), 2);
+
+        // nothing is queried again before the interval has passed
+        QVERIFY(!cache.update(500));
+        QCOMPARE(cache.queries, 2);
+        QVERIFY(cache.update(1000));
+        QCOMPARE(cache.queries, 4);
+    }
+
+    void predictFull()
+    {
+        QTemporaryDir dir;
+        FakeDiskSpaceCache cache(dir.path());
+        bt::Uint64 bytes = 0;
+        QVERIFY(cache.freeSpace(dir.filePath(QStringLiteral("torrent")), bytes, 0));
+        QCOMPARE(cache.secondsUntilFull(dir.path(), 0), -1.0);
+
+        // 10000 bytes per second
+        cache.data_free = 990000;
+        QVERIFY(cache.update(1000));
+        QCOMPARE(cache.fillRate(dir.path()), 10000.0);
+        QCOMPARE(cache.secondsUntilFull(dir.path(), 90000), 90.0);
+        QCOMPARE(cache.secondsUntilFull(QStringLiteral("/"), 0), -1.0);
+
+        // a lot of space is freed again
+        cache.data_free = 1100000;
+        QVERIFY(cache.update(2000));
+        QCOMPARE(cache.secondsUntilFull(dir.path(), 0), -1.0);
+    }
+};
+
+}
+
+QTEST_GUILESS_MAIN(kt::DiskSpaceCacheTests)
+
+#include "diskspacecachetest.moc"
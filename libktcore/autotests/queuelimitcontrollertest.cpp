@@ -0,0 +1,84 @@
+/*
+   SPDX-FileCopyrightText: 2026 The KTorrent developers
+   SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <torrent/queuelimitcontroller.h>
+
+#include <QtTest>
+
+namespace kt
+{
+
+class QueueLimitControllerTests : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void noSpeedLimit()
+    {
+        QueueLimitController c(QStringLiteral("Downloads"));
+        c.setBounds(1, 10);
+        c.reset(3);
+        QString reason;
+        for (int i = 0; i < 10; i++)
+            QCOMPARE(c.update(1000, 0, 3, 5, 100, reason), 0);
+        QCOMPARE(c.limit(), 3);
+    }
+
+    void grow()
+    {
+        QueueLimitController c(QStringLiteral("Downloads"));
+        c.setBounds(1, 5);
+        c.reset(2);
+        QString reason;
+        QCOMPARE(c.update(50, 100, 2, 3, 20, reason), 0);
+        QCOMPARE(c.update(50, 100, 2, 3, 20, reason), 0);
+        QCOMPARE(c.update(50, 100, 2, 3, 20, reason), 1);
+        QCOMPARE(c.limit(), 3);
+        QVERIFY(!reason.isEmpty());
+
+        // give the new torrent time to get up to speed
+        for (int i = 0; i < QueueLimitController::COOLDOWN_SAMPLES; i++)
+            QCOMPARE(c.update(50, 100, 3, 2, 20, reason), 0);
+
+        // nothing waiting, nothing to grow
+        for (int i = 0; i < 10; i++)
+            QCOMPARE(c.update(50, 100, 3, 0, 20, reason), 0);
+        QCOMPARE(c.limit(), 3);
+    }
+
+    void shrink()
+    {
+        QueueLimitController c(QStringLiteral("Seeds"));
+        c.setBounds(1, 10);
+        c.reset(4);
+        QString reason;
+
+        // the slowest one matters, keep it
+        for (int i = 0; i < 10; i++)
+            QCOMPARE(c.update(99, 100, 4, 0, 20, reason), 0);
+
+        // the others are fast enough without it
+        QCOMPARE(c.update(99, 100, 4, 0, 5, reason), -1);
+        QCOMPARE(c.limit(), 3);
+    }
+
+    void hysteresis()
+    {
+        QueueLimitController c(QStringLiteral("Downloads"));
+        c.setBounds(1, 10);
+        c.reset(4);
+        QString reason;
+        for (int i = 0; i < 20; i++)
+            QCOMPARE(c.update(90, 100, 4, 5, 1, reason), 0);
+        QCOMPARE(c.limit(), 4);
+    }
+};
+
+}
+
+QTEST_GUILESS_MAIN(kt::QueueLimitControllerTests)
+
+#include "queuelimitcontrollertest.moc"
@@ -0,0 +1,120 @@
+/*
+   SPDX-FileCopyrightText: 2026 The KTorrent developers
+   SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <torrent/queuemanager.h>
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <bcodec/bencoder.h>
+#include <torrent/torrentcontrol.h>
+#include <util/sha1hash.h>
+
+namespace kt
+{
+
+static const int NUM_TORRENTS = 10000;
+static const bt::Uint32 PIECE_LENGTH = 16 * 1024;
+
+/// A single file torrent of one piece, the name makes the info hash unique
+static QByteArray MakeTorrent(int i)
+{
+    QByteArray data;
+    bt::BEncoder enc(new bt::BEncoderBufferOutput(data));
+    enc.beginDict();
+    enc.write(QByteArrayLiteral("announce"));
+    enc.write(QByteArrayLiteral("http://localhost/announce"));
+    enc.write(QByteArrayLiteral("info"));
+    enc.beginDict();
+    enc.write(QByteArrayLiteral("length"));
+    enc.write((bt::Uint64)PIECE_LENGTH);
+    enc.write(QByteArrayLiteral("name"));
+    enc.write(QStringLiteral("file%1").arg(i).toUtf8());
+    enc.write(QByteArrayLiteral("piece length"));
+    enc.write(PIECE_LENGTH);
+    enc.write(QByteArrayLiteral("pieces"));
+    enc.write(QByteArray(20, '\0'));
+    enc.end();
+    enc.end();
+    return data;
+}
+
+/**
+ * Importing NUM_TORRENTS torrents into the QueueManager, the way Core does for
+ * every load: check alreadyLoaded, append, and order the queue. Then looking
+ * them all up by info hash, as D-Bus and mergeAnnounceList do. Creating the
+ * torrents themselves is not measured.
+ */
+class QueueManagerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void initTestCase()
+    {
+        QVERIFY(tmp.isValid());
+        for (int i = 0; i < NUM_TORRENTS; i++) {
+            bt::TorrentControl *tc = new bt::TorrentControl();
+            try {
+                tc->init(&qman, MakeTorrent(i), tmp.path() + QStringLiteral("/tor%1/").arg(i), tmp.path() + QStringLiteral("/data/"));
+            } catch (bt::Error &err) {
+                delete tc;
+                QFAIL(qPrintable(err.toString()));
+            }
+
+            // only the ordering is measured, nothing is started
+            tc->setAllowedToStart(false);
+            torrents.append(tc);
+            hashes.append(tc->getInfoHash());
+        }
+    }
+
+    void benchmarkImport()
+    {
+        // the queue manager owns the torrents once they are appended
+        QBENCHMARK_ONCE {
+            for (bt::TorrentControl *tc : std::as_const(torrents)) {
+                if (!qman.alreadyLoaded(tc->getInfoHash())) {
+                    qman.append(tc);
+                    qman.orderQueue();
+                }
+            }
+        }
+        QCOMPARE(qman.count(), NUM_TORRENTS);
+    }
+
+    void benchmarkOrderQueue()
+    {
+        QBENCHMARK {
+            qman.orderQueue();
+        }
+    }
+
+    void benchmarkFind()
+    {
+        int found = 0;
+        QBENCHMARK {
+            found = 0;
+            for (const bt::SHA1Hash &ih : std::as_const(hashes)) {
+                if (qman.find(ih))
+                    found++;
+            }
+        }
+        QCOMPARE(found, NUM_TORRENTS);
+    }
+
+private:
+    QTemporaryDir tmp;
+    QueueManager qman;
+    QList<bt::TorrentControl *> torrents;
+    QList<bt::SHA1Hash> hashes;
+};
+
+}
+
+QTEST_GUILESS_MAIN(kt::QueueManagerBenchmark)
+
+#include "queuemanagerbenchmark.moc"
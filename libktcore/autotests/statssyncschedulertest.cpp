@@ -0,0 +1,67 @@
+/*
+   SPDX-FileCopyrightText: 2026 The KTorrent developers
+   SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <torrent/statssyncscheduler.h>
+
+#include <QtTest>
+
+namespace kt
+{
+
+class StatsSyncSchedulerTests : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void groupWrites()
+    {
+        StatsSyncScheduler s;
+        s.setWindow(10000, 10); // flush every second
+
+        // first tick starts a flush, only torrents which are due may write
+        QVERIFY(!s.permit(100, 500));
+        QVERIFY(s.permit(100, 9500));
+        QVERIFY(s.permit(100, 20000));
+        QVERIFY(s.flushing());
+
+        // no torrent due anymore, so the flush ends at the next tick
+        QVERIFY(!s.permit(350, 0));
+        QVERIFY(!s.permit(600, 9500));
+        QVERIFY(!s.flushing());
+        QVERIFY(!s.permit(850, 9750));
+
+        // next flush
+        QVERIFY(s.permit(1100, 10000));
+        QCOMPARE(s.numFlushes(), bt::Uint64(2));
+        QCOMPARE(s.numWrites(), bt::Uint64(3));
+    }
+
+    void maxPerTick()
+    {
+        StatsSyncScheduler s;
+        s.setWindow(10000, 10);
+        s.setMaxPerTick(2);
+
+        QVERIFY(s.permit(100, 9000));
+        QVERIFY(s.permit(100, 9000));
+        QVERIFY(!s.permit(100, 9000));
+
+        // the flush goes on until everything is written
+        QVERIFY(s.permit(350, 9250));
+        QVERIFY(!s.permit(600, 0));
+        QVERIFY(s.flushing());
+        QVERIFY(!s.permit(850, 0));
+        QVERIFY(!s.flushing());
+        QCOMPARE(s.numFlushes(), bt::Uint64(1));
+        QCOMPARE(s.numWrites(), bt::Uint64(3));
+    }
+};
+
+}
+
+QTEST_GUILESS_MAIN(kt::StatsSyncSchedulerTests)
+
+#include "statssyncschedulertest.moc"
@@ -0,0 +1,108 @@
+/*
+   SPDX-FileCopyrightText: 2026 The KTorrent developers
+   SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <util/timerwheel.h>
+
+#include <QList>
+#include <QRandomGenerator>
+#include <QtTest>
+
+namespace kt
+{
+
+class TimerWheelTests : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void fireInOrder()
+    {
+        TimerWheel<int> wheel(1000);
+        wheel.reset(0);
+        wheel.schedule(1, 5000);
+        wheel.schedule(2, 70 * 1000); // level 1
+        wheel.schedule(3, 5000 * 1000); // level 2
+        wheel.schedule(4, 500); // in the past, fires at the next tick
+        QCOMPARE(wheel.count(), 4);
+
+        QList<int> fired;
+        auto fire = [&fired](int i) {
+            fired.append(i);
+        };
+
+        wheel.advance(0, fire);
+        QVERIFY(fired.isEmpty());
+        wheel.advance(1000, fire);
+        QCOMPARE(fired, QList<int>({4}));
+        wheel.advance(4999, fire);
+        QCOMPARE(fired, QList<int>({4}));
+        wheel.advance(5000, fire);
+        QCOMPARE(fired, QList<int>({4, 1}));
+        wheel.advance(69 * 1000, fire);
+        QCOMPARE(fired.count(), 2);
+        wheel.advance(70 * 1000, fire);
+        QCOMPARE(fired, QList<int>({4, 1, 2}));
+        wheel.advance(4999 * 1000, fire);
+        QCOMPARE(fired.count(), 3);
+        wheel.advance(5000 * 1000, fire);
+        QCOMPARE(fired, QList<int>({4, 1, 2, 3}));
+        QCOMPARE(wheel.count(), 0);
+    }
+
+    void cancelAndReschedule()
+    {
+        TimerWheel<int> wheel(1000);
+        wheel.reset(0);
+        wheel.schedule(1, 10 * 1000);
+        wheel.schedule(2, 10 * 1000);
+        wheel.cancel(1);
+        wheel.schedule(2, 200 * 1000);
+        QVERIFY(!wheel.contains(1));
+        QVERIFY(wheel.contains(2));
+
+        QList<int> fired;
+        auto fire = [&fired](int i) {
+            fired.append(i);
+        };
+
+        wheel.advance(199 * 1000, fire);
+        QVERIFY(fired.isEmpty());
+        wheel.advance(200 * 1000, fire);
+        QCOMPARE(fired, QList<int>({2}));
+    }
+
+    void randomDeadlines()
+    {
+        TimerWheel<int> wheel(1000);
+        wheel.reset(0);
+        QHash<int, bt::TimeStamp> deadlines;
+        QRandomGenerator rnd(42);
+        for (int i = 0; i < 10000; i++) {
+            bt::TimeStamp d = 1000 + rnd.bounded(1000000) * 100;
+            deadlines[i] = d;
+            wheel.schedule(i, d);
+        }
+
+        bt::TimeStamp now = 0;
+        int fired = 0;
+        auto fire = [&](int i) {
+            // fired in the tick of the deadline
+            QCOMPARE(deadlines[i] / 1000, now / 1000);
+            fired++;
+        };
+        while (wheel.count() > 0) {
+            now += 250;
+            wheel.advance(now, fire);
+        }
+        QCOMPARE(fired, 10000);
+    }
+};
+
+}
+
+QTEST_GUILESS_MAIN(kt::TimerWheelTests)
+
+#include "timerwheeltest.moc"
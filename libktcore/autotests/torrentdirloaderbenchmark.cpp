@@ -0,0 +1,115 @@
+/*
+   SPDX-FileCopyrightText: 2026 The KTorrent developers
+   SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <torrent/torrentdirloader.h>
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <util/fileops.h>
+
+namespace kt
+{
+
+static const int NUM_TORRENTS = 2000;
+static const int TORRENT_SIZE = 32 * 1024;
+
+/**
+ * Startup with NUM_TORRENTS torrent directories: reading all torrent files one
+ * after the other on the main thread, as Core::loadTorrents used to do,
+ * compared with TorrentDirLoader. The files will be in the page cache after
+ * the first run, so this mostly measures the overhead of the loader, with a
+ * cold cache the worker threads make a much bigger difference.
+ */
+class TorrentDirLoaderBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void initTestCase()
+    {
+        QVERIFY(tmp.isValid());
+        const QByteArray data(TORRENT_SIZE, 'x');
+        for (int i = 0; i < NUM_TORRENTS; i++) {
+            const QString dir = tmp.path() + QStringLiteral("/tor%1/").arg(i);
+            QVERIFY(QDir().mkpath(dir));
+
+            QFile f(dir + QStringLiteral("torrent"));
+            QVERIFY(f.open(QIODevice::WriteOnly));
+            f.write(data);
+
+            QFile stats(dir + QStringLiteral("stats"));
+            QVERIFY(stats.open(QIODevice::WriteOnly));
+            stats.write("UPLOADED=0\n");
+            dirs.append(dir);
+        }
+    }
+
+    void benchmarkSequential()
+    {
+        qint64 bytes = 0;
+        QBENCHMARK {
+            bytes = 0;
+            for (const QString &dir : std::as_const(dirs))
+                bytes += bt::LoadFile(dir + QStringLiteral("torrent")).size();
+        }
+        QCOMPARE(bytes, qint64(NUM_TORRENTS) * TORRENT_SIZE);
+    }
+
+    void benchmarkLoader()
+    {
+        qint64 bytes = 0;
+        QBENCHMARK {
+            bytes = 0;
+            TorrentDirLoader loader(dirs, 50);
+            connect(&loader, &TorrentDirLoader::loaded, this, [&bytes](const QList<TorrentDirLoader::Item> &batch) {
+                for (const TorrentDirLoader::Item &item : batch)
+                    bytes += item.data.size();
+            });
+            QSignalSpy finished(&loader, &TorrentDirLoader::finished);
+            loader.start();
+            QVERIFY(finished.wait(60000));
+        }
+        QCOMPARE(bytes, qint64(NUM_TORRENTS) * TORRENT_SIZE);
+    }
+
+    void loadInOrder()
+    {
+        QStringList with_missing = dirs.mid(0, 100);
+        with_missing.insert(50, tmp.path() + QStringLiteral("/missing/"));
+
+        QStringList seen;
+        int batches = 0;
+        TorrentDirLoader loader(with_missing, 10);
+        connect(&loader, &TorrentDirLoader::loaded, this, [&](const QList<TorrentDirLoader::Item> &batch) {
+            QVERIFY(batch.count() <= 10);
+            batches++;
+            for (const TorrentDirLoader::Item &item : batch) {
+                seen.append(item.dir);
+                QVERIFY(item.error.isEmpty());
+                QCOMPARE(item.data.isEmpty(), item.dir.endsWith(QStringLiteral("/missing/")));
+            }
+        });
+        QSignalSpy finished(&loader, &TorrentDirLoader::finished);
+        loader.start();
+        QVERIFY(finished.wait(60000));
+        QCOMPARE(seen, with_missing);
+        QVERIFY(batches >= 11);
+    }
+
+private:
+    QTemporaryDir tmp;
+    QStringList dirs;
+};
+
+}
+
+QTEST_GUILESS_MAIN(kt::TorrentDirLoaderBenchmark)
+
+#include "torrentdirloaderbenchmark.moc"
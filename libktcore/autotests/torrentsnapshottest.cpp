@@ -0,0 +1,130 @@
+/*
+   SPDX-FileCopyrightText: 2026 The KTorrent developers
+   SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <torrent/torrentsnapshot.h>
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace kt
+{
+
+static TorrentSnapshot::Entry MakeEntry(int i)
+{
+    TorrentSnapshot::Entry e;
+    e.info_hash = QStringLiteral("%1").arg(i, 40, 16, QLatin1Char('0'));
+    e.name = QStringLiteral("torrent %1").arg(i);
+    e.output_path = QStringLiteral("/data/torrent%1").arg(i);
+    e.total_bytes_to_download = 1000000 + i;
+    e.bytes_downloaded = 500000 + i;
+    e.bytes_uploaded = 250000 + i;
+    e.bytes_left = 500000;
+    e.status = i % 2 ? bt::SEEDING : bt::STOPPED;
+    e.completed = i % 2;
+    e.percentage = 50.0f;
+    e.share_ratio = 0.5f;
+    e.priority = 100 - i;
+    e.time_added = 1700000000 + i;
+    e.groups << QStringLiteral("/all");
+    if (i % 3 == 0)
+        e.groups << QStringLiteral("/all/custom/linux");
+    return e;
+}
+
+class TorrentSnapshotTests : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void saveAndLoad()
+    {
+        QTemporaryDir dir;
+        const QString file = dir.filePath(QStringLiteral("snapshot"));
+
+        TorrentSnapshot s;
+        for (int i = 0; i < 100; i++)
+            s.append(MakeEntry(i));
+        QVERIFY(s.save(file));
+
+        TorrentSnapshot l;
+        QVERIFY(l.load(file));
+        QCOMPARE(l.count(), 100);
+        for (int i = 0; i < 100; i++) {
+            const TorrentSnapshot::Entry expected = MakeEntry(i);
+            const TorrentSnapshot::Entry &e = l.entry(i);
+            QCOMPARE(e.info_hash, expected.info_hash);
+            QCOMPARE(e.name, expected.name);
+            QCOMPARE(e.output_path, expected.output_path);
+            QCOMPARE(e.total_bytes_to_download, expected.total_bytes_to_download);
+            QCOMPARE(e.bytes_downloaded, expected.bytes_downloaded);
+            QCOMPARE(e.bytes_uploaded, expected.bytes_uploaded);
+            QCOMPARE(e.bytes_left, expected.bytes_left);
+            QCOMPARE(e.status, expected.status);
+            QCOMPARE(e.completed, expected.completed);
+            QCOMPARE(e.percentage, expected.percentage);
+            QCOMPARE(e.share_ratio, expected.share_ratio);
+            QCOMPARE(e.priority, expected.priority);
+            QCOMPARE(e.time_added, expected.time_added);
+            QCOMPARE(e.groups, expected.groups);
+        }
+    }
+
+    void find()
+    {
+        TorrentSnapshot s;
+        for (int i = 0; i < 10; i++)
+            s.append(MakeEntry(i));
+
+        const TorrentSnapshot::Entry *e = s.find(MakeEntry(7).info_hash);
+        QVERIFY(e);
+        QCOMPARE(e->name, QStringLiteral("torrent 7"));
+        QVERIFY(!s.find(MakeEntry(10).info_hash));
+    }
+
+    void missingFile()
+    {
+        QTemporaryDir dir;
+        TorrentSnapshot s;
+        s.append(MakeEntry(0));
+        QVERIFY(!s.load(dir.filePath(QStringLiteral("snapshot"))));
+        QVERIFY(s.isEmpty());
+    }
+
+    void corruptFile()
+    {
+        QTemporaryDir dir;
+        const QString file = dir.filePath(QStringLiteral("snapshot"));
+
+        TorrentSnapshot s;
+        for (int i = 0; i < 10; i++)
+            s.append(MakeEntry(i));
+        QVERIFY(s.save(file));
+
+        // Cut off the end
+        QFile fptr(file);
+        QVERIFY(fptr.open(QIODevice::ReadWrite));
+        QVERIFY(fptr.resize(fptr.size() - 10));
+        fptr.close();
+
+        TorrentSnapshot l;
+        QVERIFY(!l.load(file));
+        QVERIFY(l.isEmpty());
+
+        // Wrong magic
+        QVERIFY(fptr.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        fptr.write(QByteArray(100, 'x'));
+        fptr.close();
+        QVERIFY(!l.load(file));
+        QVERIFY(l.isEmpty());
+    }
+};
+
+}
+
+QTEST_GUILESS_MAIN(kt::TorrentSnapshotTests)
+
+#include "torrentsnapshottest.moc"
@@ -0,0 +1,191 @@
+/*
+   SPDX-FileCopyrightText: 2026 The KTorrent developers
+   SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <util/tracer.h>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QThreadPool>
+#include <QtTest>
+
+namespace kt
+{
+
+class TracerTests : public QObject
+{
+    Q_OBJECT
+
+    /// Save the trace and get the spans with a name
+    QList<QJsonObject> spans(const QString &name, QJsonArray *all = nullptr)
+    {
+        QTemporaryDir tmp;
+        const QString file = tmp.filePath(QStringLiteral("trace.json"));
+        if (!Tracer::save(file))
+            return {};
+
+        QFile fptr(file);
+        if (!fptr.open(QIODevice::ReadOnly))
+            return {};
+
+        QJsonParseError err;
+        const QJsonDocument doc = QJsonDocument::fromJson(fptr.readAll(), &err);
+        if (err.error != QJsonParseError::NoError)
+            return {};
+
+        const QJsonArray events = doc.object().value(QStringLiteral("traceEvents")).toArray();
+        if (all)
+            *all = events;
+
+        QList<QJsonObject> ret;
+        for (const QJsonValue &v : events) {
+            const QJsonObject ev = v.toObject();
+            if (ev.value(QStringLiteral("ph")).toString() == QLatin1String("X") && ev.value(QStringLiteral("name")).toString() == name)
+                ret.append(ev);
+        }
+        return ret;
+    }
+
+private Q_SLOTS:
+
+    void initTestCase()
+    {
+#ifdef KT_NO_TRACING
+        QSKIP("Tracing is not supported by this build");
+#endif
+    }
+
+    void cleanup()
+    {
+        Tracer::setEnabled(false);
+    }
+
+    void disabled()
+    {
+        QVERIFY(!Tracer::isEnabled());
+        {
+            KT_TRACE_SCOPE("test", "disabled");
+        }
+        QVERIFY(spans(QStringLiteral("disabled")).isEmpty());
+    }
+
+    void nested()
+    {
+        Tracer::setEnabled(true);
+        {
+            KT_TRACE_SCOPE("test", "outer");
+            QTest::qWait(20);
+            {
+                KT_TRACE_SCOPE("test", "inner");
+                QTest::qWait(10);
+            }
+        }
+
+        const QList<QJsonObject> outer = spans(QStringLiteral("outer"));
+        const QList<QJsonObject> inner = spans(QStringLiteral("inner"));
+        QCOMPARE(outer.count(), 1);
+        QCOMPARE(inner.count(), 1);
+        QCOMPARE(outer[0].value(QStringLiteral("cat")).toString(), QStringLiteral("test"));
+
+        // in microseconds
+        const double outer_ts = outer[0].value(QStringLiteral("ts")).toDouble();
+        const double outer_dur = outer[0].value(QStringLiteral("dur")).toDouble();
+        const double inner_ts = inner[0].value(QStringLiteral("ts")).toDouble();
+        const double inner_dur = inner[0].value(QStringLiteral("dur")).toDouble();
+        QVERIFY(outer_dur >= 30000);
+        QVERIFY(inner_dur >= 10000);
+        QVERIFY(inner_ts >= outer_ts);
+        QVERIFY(inner_ts + inner_dur <= outer_ts + outer_dur);
+        QCOMPARE(outer[0].value(QStringLiteral("tid")).toInt(), inner[0].value(QStringLiteral("tid")).toInt());
+    }
+
+    void threads()
+    {
+        Tracer::setEnabled(true);
+        QThreadPool pool;
+        pool.setMaxThreadCount(4);
+        for (int i = 0; i < 4; i++) {
+            pool.start([]() {
+                for (int j = 0; j < 100; j++) {
+                    KT_TRACE_SCOPE("test", "worker");
+                }
+                // keep the thread busy, so every task gets its own
+                QThread::msleep(50);
+            });
+        }
+        pool.waitForDone();
+
+        QJsonArray all;
+        const QList<QJsonObject> worker = spans(QStringLiteral("worker"), &all);
+        QCOMPARE(worker.count(), 400);
+
+        QSet<int> tids;
+        for (const QJsonObject &ev : worker)
+            tids.insert(ev.value(QStringLiteral("tid")).toInt());
+        QCOMPARE(tids.count(), 4);
+
+        // every thread has a name
+        for (const QJsonValue &v : std::as_const(all)) {
+            const QJsonObject ev = v.toObject();
+            if (ev.value(QStringLiteral("ph")).toString() == QLatin1String("M"))
+                tids.remove(ev.value(QStringLiteral("tid")).toInt());
+        }
+        QVERIFY(tids.isEmpty());
+    }
+
+    void overflow()
+    {
+        // only the newest spans of a thread are kept
+        Tracer::setEnabled(true);
+        const char *name = Tracer::intern(QStringLiteral("overflow"));
+        for (int i = 0; i < Tracer::BUFFER_SIZE + 100; i++)
+            Tracer::record("test", name, i, 1);
+
+        const QList<QJsonObject> overflow = spans(QStringLiteral("overflow"));
+        QCOMPARE(overflow.count(), int(Tracer::BUFFER_SIZE));
+        QCOMPARE(overflow.last().value(QStringLiteral("ts")).toDouble(), (Tracer::BUFFER_SIZE + 99) / 1000.0);
+    }
+
+    void saveWhileRecording()
+    {
+        // spans which are overwritten while saving are skipped, the others are saved intact
+        Tracer::setEnabled(true);
+        const char *name = Tracer::intern(QStringLiteral("concurrent"));
+        std::atomic<bool> stop(false);
+        QThreadPool pool;
+        pool.start([name, &stop]() {
+            for (qint64 i = 0; !stop; i++)
+                Tracer::record("test", name, i * 1000, i * 1000);
+        });
+
+        for (int i = 0; i < 20; i++) {
+            const QList<QJsonObject> concurrent = spans(QStringLiteral("concurrent"));
+            for (const QJsonObject &ev : concurrent)
+                QCOMPARE(ev.value(QStringLiteral("dur")).toDouble(), ev.value(QStringLiteral("ts")).toDouble());
+        }
+
+        stop = true;
+        pool.waitForDone();
+    }
+
+    void intern()
+    {
+        const char *a = Tracer::intern(QStringLiteral("plugin \"a\""));
+        QVERIFY(a == Tracer::intern(QStringLiteral("plugin \"a\"")));
+
+        // names are escaped
+        Tracer::setEnabled(true);
+        Tracer::record("test", a, Tracer::now(), 1000);
+        QCOMPARE(spans(QStringLiteral("plugin \"a\"")).count(), 1);
+    }
+};
+
+}
+
+QTEST_GUILESS_MAIN(kt::TracerTests)
+
+#include "tracertest.moc"
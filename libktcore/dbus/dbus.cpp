@@ -11,6 +11,7 @@
 #include <KConfig>
 
 #include "dbus.h"
+#include "dbusblocklists.h"
 #include "dbusgroup.h"
 #include "dbussettings.h"
 #include "dbustorrent.h"
@@ -22,6 +23,7 @@
 #include <torrent/queuemanager.h>
 #include <util/log.h>
 #include <util/sha1hash.h>
+#include <util/tracer.h>
 
 using namespace bt;
 
@@ -40,6 +42,7 @@ DBus::DBus(GUIInterface *gui, CoreInterface *core, QObject *parent)
                                                  QDBusConnection::ExportScriptableSlots | QDBusConnection::ExportScriptableSignals);
 
     connect(core, &CoreInterface::torrentAdded, this, qOverload<bt::TorrentInterface *>(&DBus::torrentAdded));
+    connect(core, &CoreInterface::torrentLoaded, this, &DBus::torrentLoaded);
     connect(core, &CoreInterface::torrentRemoved, this, qOverload<bt::TorrentInterface *>(&DBus::torrentRemoved));
     connect(core, &CoreInterface::torrentStoppedByError, this, qOverload<bt::TorrentInterface *, QString>(&DBus::torrentStoppedByError));
     connect(core, &CoreInterface::finished, this, qOverload<bt::TorrentInterface *>(&DBus::finished));
@@ -48,7 +51,7 @@ DBus::DBus(GUIInterface *gui, CoreInterface *core, QObject *parent)
     // fill the map with torrents
     const kt::QueueManager *const qman = core->getQueueManager();
     for (bt::TorrentInterface *i : *qman) {
-        torrentAdded(i);
+        torrentLoaded(i);
     }
 
     connect(qman, &kt::QueueManager::suspendStateChanged, this, &DBus::suspendStateChanged);
@@ -64,6 +67,7 @@ DBus::DBus(GUIInterface *gui, CoreInterface *core, QObject *parent)
     }
 
     dbus_settings = new DBusSettings(core, this);
+    dbus_blocklists = new DBusBlockLists(this);
 }
 
 DBus::~DBus()
@@ -84,20 +88,20 @@ QStringList DBus::torrents()
 
 void DBus::start(const QString &info_hash)
 {
-    DBusTorrent *tc = torrent_map.find(info_hash);
+    bt::TorrentInterface *tc = findTorrent(info_hash);
     if (!tc)
         return;
 
-    core->getQueueManager()->start(tc->torrent());
+    core->getQueueManager()->start(tc);
 }
 
 void DBus::stop(const QString &info_hash)
 {
-    DBusTorrent *tc = torrent_map.find(info_hash);
+    bt::TorrentInterface *tc = findTorrent(info_hash);
     if (!tc)
         return;
 
-    core->getQueueManager()->stop(tc->torrent());
+    core->getQueueManager()->stop(tc);
 }
 
 void DBus::startAll()
@@ -110,11 +114,26 @@ void DBus::stopAll()
     core->stopAll();
 }
 
+bt::TorrentInterface *DBus::findTorrent(const QString &info_hash) const
+{
+    const QByteArray hash = QByteArray::fromHex(info_hash.toLatin1());
+    if (hash.size() != 20)
+        return nullptr;
+
+    return core->getQueueManager()->find(bt::SHA1Hash((const bt::Uint8 *)hash.constData()));
+}
+
 void DBus::torrentAdded(bt::TorrentInterface *tc)
 {
-    DBusTorrent *db = new DBusTorrent(tc, this);
+    torrentLoaded(tc);
+    Q_EMIT torrentAdded(tc->getInfoHash().toString());
+}
+
+void DBus::torrentLoaded(bt::TorrentInterface *tc)
+{
+    // Existing torrents are only made available, clients are not told about them like about new ones
+    DBusTorrent *db = new DBusTorrent(tc, core->getQueueManager(), this);
     torrent_map.insert(db->infoHash(), db);
-    Q_EMIT torrentAdded(db->infoHash());
 }
 
 void DBus::torrentRemoved(bt::TorrentInterface *tc)
@@ -220,11 +239,11 @@ void DBus::log(const QString &line)
 
 void DBus::remove(const QString &info_hash, bool data_to)
 {
-    DBusTorrent *tc = torrent_map.find(info_hash);
+    bt::TorrentInterface *tc = findTorrent(info_hash);
     if (!tc)
         return;
 
-    core->remove(tc->torrent(), data_to);
+    core->remove(tc, data_to);
 }
 
 void DBus::removeDelayed(const QString &info_hash, bool data_to)
@@ -266,6 +285,16 @@ QString DBus::dataDir() const
     return kt::DataDir();
 }
 
+void DBus::setTracing(bool on)
+{
+    Tracer::setEnabled(on);
+}
+
+bool DBus::saveTrace(const QString &file)
+{
+    return Tracer::save(file);
+}
+
 void DBus::orderQueue()
 {
     core->getQueueManager()->orderQueue();
@@ -27,6 +27,7 @@ class GUIInterface;
 class CoreInterface;
 class Group;
 class DBusSettings;
+class DBusBlockLists;
 
 /**
  * Class which handles DBus calls
@@ -109,8 +110,15 @@ public Q_SLOTS:
     ///  Get the number of torrents not running.
     Q_SCRIPTABLE QString dataDir() const;
 
+    /// Switch tracing on or off
+    Q_SCRIPTABLE void setTracing(bool on);
+
+    /// Save the trace in Chrome trace format
+    Q_SCRIPTABLE bool saveTrace(const QString &file);
+
 private Q_SLOTS:
     void torrentAdded(bt::TorrentInterface *tc);
+    void torrentLoaded(bt::TorrentInterface *tc);
     void torrentRemoved(bt::TorrentInterface *tc);
     void finished(bt::TorrentInterface *tc);
     void torrentStoppedByError(bt::TorrentInterface *tc, QString msg);
@@ -137,6 +145,10 @@ Q_SIGNALS:
     /// Emitted when suspended state changes
     Q_SCRIPTABLE void suspendStateChanged(bool suspended);
 
+private:
+    /// Look up a torrent by the hex string of its info hash
+    bt::TorrentInterface *findTorrent(const QString &info_hash) const;
+
 private:
     GUIInterface *gui;
     CoreInterface *core;
@@ -144,6 +156,7 @@ private:
     bt::PtrMap<Group *, DBusGroup> group_map;
     QMap<QString, bool> delayed_removal_map;
     DBusSettings *dbus_settings;
+    DBusBlockLists *dbus_blocklists;
 
     typedef bt::PtrMap<QString, DBusTorrent>::iterator DBusTorrentItr;
     typedef bt::PtrMap<Group *, DBusGroup>::iterator DBusGroupItr;
@@ -0,0 +1,94 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "dbusblocklists.h"
+
+#include <QDBusConnection>
+#include <QHostAddress>
+
+#include <util/blockliststats.h>
+
+using namespace bt;
+
+namespace kt
+{
+DBusBlockLists::DBusBlockLists(QObject *parent)
+    : QObject(parent)
+{
+    QDBusConnection::sessionBus().registerObject(QStringLiteral("/blocklists"),
+                                                 this,
+                                                 QDBusConnection::ExportScriptableSlots | QDBusConnection::ExportScriptableSignals);
+}
+
+DBusBlockLists::~DBusBlockLists()
+{
+}
+
+QStringList DBusBlockLists::blockLists() const
+{
+    return BlockListStats::names();
+}
+
+qulonglong DBusBlockLists::lookups(const QString &name) const
+{
+    BlockListStats::Snapshot s;
+    return BlockListStats::snapshot(name, 0, s) ? s.lookups : 0;
+}
+
+qulonglong DBusBlockLists::hits(const QString &name) const
+{
+    BlockListStats::Snapshot s;
+    return BlockListStats::snapshot(name, 0, s) ? s.hits : 0;
+}
+
+QList<qulonglong> DBusBlockLists::latencyHistogram(const QString &name) const
+{
+    QList<qulonglong> ret;
+    BlockListStats::Snapshot s;
+    if (BlockListStats::snapshot(name, 0, s)) {
+        for (Uint64 v : std::as_const(s.latency))
+            ret.append(v);
+    }
+    return ret;
+}
+
+uint DBusBlockLists::latencySampleInterval() const
+{
+    return BlockListStats::LATENCY_SAMPLE_INTERVAL;
+}
+
+static QString AddressString(const Uint128 &addr)
+{
+    if (addr.isIPv4Mapped())
+        return QHostAddress(Uint32(addr.lo)).toString();
+
+    Q_IPV6ADDR ip;
+    for (int i = 0; i < 8; i++) {
+        ip.c[i] = Uint8(addr.hi >> (56 - 8 * i));
+        ip.c[i + 8] = Uint8(addr.lo >> (56 - 8 * i));
+    }
+    return QHostAddress(ip).toString();
+}
+
+QStringList DBusBlockLists::hotRanges(const QString &name, int max) const
+{
+    QStringList ret;
+    BlockListStats::Snapshot s;
+    if (!BlockListStats::snapshot(name, max, s))
+        return ret;
+
+    for (const BlockListStats::HotRange &r : std::as_const(s.hot_ranges))
+        ret.append(QStringLiteral("%1-%2 %3").arg(AddressString(r.start), AddressString(r.end)).arg(r.hits));
+    return ret;
+}
+
+bool DBusBlockLists::reset(const QString &name)
+{
+    return BlockListStats::reset(name);
+}
+
+}
+
+#include "moc_dbusblocklists.cpp"
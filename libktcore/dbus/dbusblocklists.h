@@ -0,0 +1,52 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_DBUSBLOCKLISTS_H
+#define KT_DBUSBLOCKLISTS_H
+
+#include <QList>
+#include <QObject>
+#include <QStringList>
+#include <ktcore_export.h>
+
+namespace kt
+{
+/**
+ * Exports the counters of the block lists (see BlockListStats) over DBus
+ */
+class KTCORE_EXPORT DBusBlockLists : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.ktorrent.blocklists")
+public:
+    explicit DBusBlockLists(QObject *parent);
+    ~DBusBlockLists() override;
+
+public Q_SLOTS:
+    /// Get the names of all block lists
+    Q_SCRIPTABLE QStringList blockLists() const;
+
+    /// Get the number of lookups done on a block list
+    Q_SCRIPTABLE qulonglong lookups(const QString &name) const;
+
+    /// Get the number of lookups on a block list which found a blocked address
+    Q_SCRIPTABLE qulonglong hits(const QString &name) const;
+
+    /// Get the latency histogram of the sampled lookups, entry i counts lookups which took less then 2^i nanoseconds
+    Q_SCRIPTABLE QList<qulonglong> latencyHistogram(const QString &name) const;
+
+    /// Get the number of lookups sampled for the latency histogram
+    Q_SCRIPTABLE uint latencySampleInterval() const;
+
+    /// Get the ranges with the most hits, as "start-end hits"
+    Q_SCRIPTABLE QStringList hotRanges(const QString &name, int max) const;
+
+    /// Reset the counters of a block list
+    Q_SCRIPTABLE bool reset(const QString &name);
+};
+
+}
+
+#endif
@@ -17,6 +17,7 @@
 #include <interfaces/trackerinterface.h>
 #include <interfaces/trackerslist.h>
 #include <interfaces/webseedinterface.h>
+#include <torrent/queuemanager.h>
 #include <util/bitset.h>
 #include <util/log.h>
 #include <util/sha1hash.h>
@@ -25,9 +26,10 @@ using namespace bt;
 
 namespace kt
 {
-DBusTorrent::DBusTorrent(bt::TorrentInterface *ti, QObject *parent)
+DBusTorrent::DBusTorrent(bt::TorrentInterface *ti, QueueManager *qman, QObject *parent)
     : QObject(parent)
     , ti(ti)
+    , qman(qman)
     , stream(nullptr)
 {
     QDBusConnection sb = QDBusConnection::sessionBus();
@@ -415,7 +417,8 @@ int DBusTorrent::priority() const
 
 void DBusTorrent::setPriority(int p)
 {
-    ti->setPriority(p);
+    qman->setPriority(ti, p);
+    qman->orderQueue();
 }
 
 void DBusTorrent::setAllowedToStart(bool on)
@@ -15,6 +15,7 @@
 
 namespace kt
 {
+class QueueManager;
 class DBusTorrentFileStream;
 
 /**
@@ -25,7 +26,7 @@ class DBusTorrent : public QObject
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "org.ktorrent.torrent")
 public:
-    DBusTorrent(bt::TorrentInterface *ti, QObject *parent);
+    DBusTorrent(bt::TorrentInterface *ti, QueueManager *qman, QObject *parent);
     ~DBusTorrent() override;
 
     /// Get a pointer to the actual torrent
@@ -130,6 +131,7 @@ private Q_SLOTS:
 
 private:
     bt::TorrentInterface *ti;
+    QueueManager *qman;
     DBusTorrentFileStream *stream;
 };
 
@@ -266,6 +266,28 @@ void GroupManager::torrentRemoved(TorrentInterface *ti)
     }
 }
 
+void GroupManager::torrentUnloaded(TorrentInterface *ti)
+{
+    for (CItr i = groups.begin(); i != groups.end(); i++) {
+        if (i->second->groupFlags() & Group::CUSTOM_GROUP) {
+            TorrentGroup *tg = dynamic_cast<TorrentGroup *>(i->second);
+            if (tg)
+                tg->torrentUnloaded(ti);
+        }
+    }
+}
+
+void GroupManager::torrentReloaded(TorrentInterface *ti)
+{
+    for (CItr i = groups.begin(); i != groups.end(); i++) {
+        if (i->second->groupFlags() & Group::CUSTOM_GROUP) {
+            TorrentGroup *tg = dynamic_cast<TorrentGroup *>(i->second);
+            if (tg)
+                tg->torrentReloaded(ti);
+        }
+    }
+}
+
 void GroupManager::renameGroup(const QString &old_name, const QString &new_name)
 {
     Group *g = find(old_name);
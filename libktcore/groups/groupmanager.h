@@ -128,6 +128,21 @@ public:
      */
     void torrentRemoved(bt::TorrentInterface *ti);
 
+    /**
+     * A torrent is unloaded to be loaded again later, for example when
+     * the data directory is changed. It stays in its custom groups until
+     * torrentReloaded or torrentsLoaded is called.
+     * @param ti The torrent
+     */
+    void torrentUnloaded(bt::TorrentInterface *ti);
+
+    /**
+     * A torrent which was unloaded with torrentUnloaded has been loaded
+     * again. It goes back into the custom groups it was a member of.
+     * @param ti The torrent
+     */
+    void torrentReloaded(bt::TorrentInterface *ti);
+
     /**
      * Rename a group.
      * @param old_name The old name
@@ -188,6 +188,18 @@ void TorrentGroup::loadTorrents(QueueManager *qman)
     hashes.clear();
 }
 
+void TorrentGroup::torrentUnloaded(TorrentInterface *tor)
+{
+    if (torrents.erase(tor) > 0)
+        hashes.insert(tor->getInfoHash());
+}
+
+void TorrentGroup::torrentReloaded(TorrentInterface *tor)
+{
+    if (hashes.erase(tor->getInfoHash()) > 0)
+        torrents.insert(tor);
+}
+
 }
 
 #include "moc_torrentgroup.cpp"
@@ -36,6 +36,12 @@ public:
     void remove(TorrentInterface *tor);
     void loadTorrents(QueueManager *qman);
 
+    /// A torrent is unloaded for a while, it stays a member until torrentReloaded or loadTorrents finds it again
+    void torrentUnloaded(TorrentInterface *tor);
+
+    /// An unloaded torrent is loaded again, it is a member again if it was one before
+    void torrentReloaded(TorrentInterface *tor);
+
 Q_SIGNALS:
     /// Emitted when a torrent has been added
     void torrentAdded(Group *g);
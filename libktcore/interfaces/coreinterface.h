@@ -160,7 +160,8 @@ public:
      * @param url URL of the torrent
      * @param group Group to use
      * @param savedir Directory to save to
-     * @return The loaded TorrentInterface or 0 on failure
+     * @return The loaded TorrentInterface, or 0 on failure or when it is loaded later,
+     * because the existing torrents are still being loaded
      */
     virtual bt::TorrentInterface *load(const QByteArray &data, const QUrl &url, const QString &group, const QString &savedir) = 0;
 
@@ -170,10 +171,20 @@ public:
      * @param url URL of the torrent
      * @param group Group to use
      * @param savedir Directory to save to
-     * @return The loaded TorrentInterface or 0 on failure
+     * @return The loaded TorrentInterface, or 0 on failure or when it is loaded later,
+     * because the existing torrents are still being loaded
      */
     virtual bt::TorrentInterface *loadSilently(const QByteArray &data, const QUrl &url, const QString &group, const QString &savedir) = 0;
 
+    /**
+     * Load a torrent using a byte array, with options which are applied to it once it has been
+     * loaded, also when that happens later, because the existing torrents are still being loaded.
+     * @param data Data of the torrent
+     * @param url URL of the torrent
+     * @param options The options, location is the directory to save to
+     */
+    virtual void load(const QByteArray &data, const QUrl &url, const MagnetLinkLoadOptions &options) = 0;
+
     /**
      * Remove a download.This will delete all temp
      * data from this TorrentControl And delete the
@@ -240,6 +251,15 @@ Q_SIGNALS:
      */
     void torrentAdded(bt::TorrentInterface *tc);
 
+    /**
+     * An existing torrent was loaded at startup. Torrents are loaded in the
+     * background, after the plugins, so anything which keeps track of all
+     * torrents needs to handle this like torrentAdded. The torrent is not a
+     * new one though.
+     * @param tc
+     */
+    void torrentLoaded(bt::TorrentInterface *tc);
+
     /**
      * A TorrentInterface was removed
      * @param tc
@@ -20,6 +20,7 @@
 #include <util/error.h>
 #include <util/fileops.h>
 #include <util/log.h>
+#include <util/tracer.h>
 #include <util/waitjob.h>
 
 using namespace bt;
@@ -55,6 +56,7 @@ void PluginManager::loadPluginList()
 
 void PluginManager::loadPlugins()
 {
+    KT_TRACE_SCOPE("plugins", "PluginManager::loadPlugins");
     const KConfigGroup cfg = KSharedConfig::openConfig()->group(QStringLiteral("Plugins"));
     int idx = 0;
     for (const KPluginMetaData &data : std::as_const(pluginsMetaData)) {
@@ -71,6 +73,8 @@ void PluginManager::loadPlugins()
 
 void PluginManager::load(const KPluginMetaData &data, int idx)
 {
+    // interning takes a lock, so only when the span is recorded
+    KT_TRACE_SCOPE("plugins", Tracer::isEnabled() ? Tracer::intern(data.pluginId()) : "plugin");
     auto plugin = KPluginFactory::instantiatePlugin<kt::Plugin>(data).plugin;
     if (!plugin) {
         Out(SYS_GEN | LOG_NOTICE) << QStringLiteral("Creating instance of plugin %1 failed !").arg(pluginsMetaData.at(idx).fileName()) << endl;
@@ -0,0 +1,233 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "datadirmigration.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <util/log.h>
+
+using namespace bt;
+
+namespace kt
+{
+// Suffix of a directory which is still being copied
+static const QLatin1String PART_SUFFIX(".part");
+
+static bool CopyDir(const QString &src, const QString &dst)
+{
+    if (!QDir().mkpath(dst))
+        return false;
+
+    QDirIterator it(src, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo fi = it.fileInfo();
+        const QString target = dst + QLatin1Char('/') + fi.fileName();
+        // Links (like the cache link to the data of a torrent) are copied as links
+        if (fi.isSymLink()) {
+            if (!QFile::link(fi.symLinkTarget(), target))
+                return false;
+        } else if (fi.isDir()) {
+            if (!CopyDir(fi.filePath(), target))
+                return false;
+        } else if (!QFile::copy(fi.filePath(), target)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Are all files in src also in dst, with the same size
+static bool IsCopyOf(const QString &src, const QString &dst)
+{
+    const QDir src_dir(src);
+    QDirIterator it(src, QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo fi = it.fileInfo();
+        if (fi.isSymLink())
+            continue;
+
+        const QFileInfo copy(dst + QLatin1Char('/') + src_dir.relativeFilePath(fi.filePath()));
+        if (!copy.exists() || copy.size() != fi.size())
+            return false;
+    }
+    return true;
+}
+
+/// Move a torrent directory, picking up where an interrupted move stopped
+static bool MoveDir(const QString &src, const QString &dst)
+{
+    const QString part = dst + PART_SUFFIX;
+    if (QFileInfo::exists(part) && !QDir(part).removeRecursively())
+        return false;
+
+    if (QFileInfo::exists(dst)) {
+        if (!QFileInfo::exists(src))
+            return true;
+
+        // Copied, but the original was not (completely) removed yet,
+        // unless dst is something else which happens to have the same name
+        return IsCopyOf(src, dst) && QDir(src).removeRecursively();
+    }
+
+    if (!QFileInfo::exists(src))
+        return false;
+
+    // Same file system
+    if (QDir().rename(src, dst))
+        return true;
+
+    if (!CopyDir(src, part) || !QDir().rename(part, dst)) {
+        QDir(part).removeRecursively();
+        return false;
+    }
+
+    return QDir(src).removeRecursively();
+}
+
+DataDirMigration::DataDirMigration(const QString &journal, int max_concurrent, QObject *parent)
+    : QObject(parent)
+    , journal(journal)
+    , done(false)
+    , running(false)
+    , next(0)
+    , abort(false)
+    , num_moved(0)
+{
+    pool.setMaxThreadCount(qMax(1, max_concurrent));
+
+    QFile fptr(journal);
+    if (fptr.open(QIODevice::ReadOnly)) {
+        const QStringList lines = QString::fromUtf8(fptr.readAll()).split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+        if (lines.count() == 2) {
+            from = lines[0];
+            to = lines[1];
+        } else {
+            Out(SYS_GEN | LOG_NOTICE) << "Ignoring invalid migration journal " << journal << endl;
+        }
+    }
+}
+
+DataDirMigration::~DataDirMigration()
+{
+    abort = true;
+    pool.waitForDone();
+}
+
+bool DataDirMigration::prepare(const QString &from, const QString &to)
+{
+    this->from = from;
+    this->to = to;
+    done = false;
+    return saveJournal();
+}
+
+void DataDirMigration::cancel()
+{
+    from.clear();
+    to.clear();
+    QFile::remove(journal);
+}
+
+bool DataDirMigration::isPending(const QString &to) const
+{
+    return !done && !this->to.isEmpty() && QDir::cleanPath(this->to) == QDir::cleanPath(to);
+}
+
+void DataDirMigration::start(const QStringList &dirs)
+{
+    Out(SYS_GEN | LOG_NOTICE) << "Moving " << dirs.count() << " torrents from " << from << " to " << to << endl;
+    this->dirs = dirs;
+    running = true;
+    failed_dirs.clear();
+    next = 0;
+    num_moved = 0;
+    QDir().mkpath(to);
+
+    if (dirs.isEmpty()) {
+        QMetaObject::invokeMethod(
+            this,
+            [this]() {
+                moved(-1, true);
+            },
+            Qt::QueuedConnection);
+        return;
+    }
+
+    const QString src_dir = QDir(from).absolutePath() + QLatin1Char('/');
+    const QString dst_dir = QDir(to).absolutePath() + QLatin1Char('/');
+    const int num_workers = qMin(pool.maxThreadCount(), int(dirs.count()));
+    for (int i = 0; i < num_workers; i++)
+        pool.start([this, src_dir, dst_dir]() {
+            work(src_dir, dst_dir);
+        });
+}
+
+void DataDirMigration::work(const QString &src_dir, const QString &dst_dir)
+{
+    while (!abort) {
+        const int i = next.fetch_add(1);
+        if (i >= dirs.count())
+            return;
+
+        const QString name = QDir::cleanPath(dirs[i]);
+        const bool ok = MoveDir(src_dir + name, dst_dir + name);
+        QMetaObject::invokeMethod(
+            this,
+            [this, i, ok]() {
+                moved(i, ok);
+            },
+            Qt::QueuedConnection);
+    }
+}
+
+void DataDirMigration::moved(int idx, bool ok)
+{
+    if (idx >= 0) {
+        num_moved++;
+        if (!ok) {
+            Out(SYS_GEN | LOG_IMPORTANT) << "Failed to move " << from << dirs[idx] << " to " << to << endl;
+            failed_dirs.append(dirs[idx]);
+        }
+        Q_EMIT progress(num_moved, dirs.count());
+    }
+
+    if (num_moved < dirs.count())
+        return;
+
+    done = true;
+    running = false;
+    // Keep the journal if something failed, so it is tried again at the next start
+    if (failed_dirs.isEmpty())
+        QFile::remove(journal);
+
+    Q_EMIT finished();
+}
+
+bool DataDirMigration::saveJournal() const
+{
+    QSaveFile fptr(journal);
+    if (!fptr.open(QIODevice::WriteOnly)) {
+        Out(SYS_GEN | LOG_IMPORTANT) << "Failed to open " << journal << " : " << fptr.errorString() << endl;
+        return false;
+    }
+
+    fptr.write((from + QLatin1Char('\n') + to + QLatin1Char('\n')).toUtf8());
+    if (!fptr.commit()) {
+        Out(SYS_GEN | LOG_IMPORTANT) << "Failed to write " << journal << " : " << fptr.errorString() << endl;
+        return false;
+    }
+    return true;
+}
+
+}
+
+#include "moc_datadirmigration.cpp"
@@ -0,0 +1,123 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_DATADIRMIGRATION_H
+#define KT_DATADIRMIGRATION_H
+
+#include <atomic>
+
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <ktcore_export.h>
+
+namespace kt
+{
+/**
+ * @brief Moves the torrent directories to a new data directory
+ *
+ * The torrents cannot be moved while they are loaded, so they are unloaded
+ * first, and loaded again from the new data directory once they have been
+ * moved. A change of the data directory is recorded in a journal with
+ * prepare, a migration which did not finish before KTorrent quit (or crashed)
+ * is carried out at the next startup, before the torrents are loaded.
+ *
+ * A pool of worker threads moves the directories. A directory is renamed if
+ * the old and new data directory are on the same file system, otherwise it
+ * is copied to a temporary name in the new data directory, renamed when the
+ * copy is complete, and then removed from the old data directory. So the state
+ * on disk always shows how far a directory got, and a migration which was
+ * interrupted is simply started again. The journal is removed once all
+ * directories have been moved.
+ */
+class KTCORE_EXPORT DataDirMigration : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * Constructor, loads the journal.
+     * @param journal The journal file
+     * @param max_concurrent Maximum number of directories being moved at the same time
+     * @param parent The parent
+     */
+    DataDirMigration(const QString &journal, int max_concurrent, QObject *parent = nullptr);
+
+    /// Destructor, stops the workers, the migration continues at the next start
+    ~DataDirMigration() override;
+
+    /**
+     * Record that the torrent directories have to be moved, before start is called.
+     * @param from The current data directory
+     * @param to The new data directory
+     * @return true if the journal was written
+     */
+    bool prepare(const QString &from, const QString &to);
+
+    /// Forget about the migration
+    void cancel();
+
+    /// Is there a migration to a data directory, which has not been done in this session
+    bool isPending(const QString &to) const;
+
+    /// Is the migration going on
+    bool isRunning() const
+    {
+        return running;
+    }
+
+    /// The data directory the torrents are moved from
+    const QString &source() const
+    {
+        return from;
+    }
+
+    /// The data directory the torrents are moved to
+    const QString &target() const
+    {
+        return to;
+    }
+
+    /**
+     * Move the torrent directories
+     * @param dirs Names of the torrent directories in the source directory
+     */
+    void start(const QStringList &dirs);
+
+    /// Torrent directories in the source directory which could not be moved
+    QStringList failed() const
+    {
+        return failed_dirs;
+    }
+
+Q_SIGNALS:
+    /// Progress, emitted after every directory
+    void progress(int done, int total);
+
+    /// All directories have been moved, or have failed
+    void finished();
+
+private:
+    void work(const QString &src_dir, const QString &dst_dir);
+    void moved(int idx, bool ok);
+    bool saveJournal() const;
+
+private:
+    QString journal;
+    QString from;
+    QString to;
+    bool done;
+    bool running;
+    QStringList dirs;
+    QStringList failed_dirs;
+    std::atomic<int> next;
+    std::atomic<bool> abort;
+    int num_moved;
+    QThreadPool pool;
+};
+
+}
+
+#endif
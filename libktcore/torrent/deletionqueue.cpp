@@ -0,0 +1,322 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "deletionqueue.h"
+
+#include <algorithm>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+#include <KLocalizedString>
+
+#include <util/log.h>
+
+using namespace bt;
+
+namespace kt
+{
+static const quint32 JOURNAL_VERSION = 1;
+
+// Workers report progress after this many files
+static const int REPORT_INTERVAL = 64;
+
+static int NumFiles(const DeletionQueue::Job &job)
+{
+    return job.files.count() + (job.data_dir.isEmpty() ? 0 : 1) + (job.tor_dir.isEmpty() ? 0 : 1);
+}
+
+static void RemoveEmptyDirs(const QString &dir)
+{
+    QDir d(dir);
+    const QStringList subdirs = d.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::NoSymLinks);
+    for (const QString &s : subdirs)
+        RemoveEmptyDirs(d.filePath(s));
+
+    // fails if there is still something in it
+    d.rmdir(d.absolutePath());
+}
+
+DeletionQueue::DeletionQueue(const QString &journal, int max_concurrent, QObject *parent)
+    : QObject(parent)
+    , journal(journal)
+    , next_id(0)
+    , started(false)
+    , abort(false)
+    , files_done(0)
+    , files_total(0)
+{
+    pool.setMaxThreadCount(qMax(1, max_concurrent));
+    loadJournal();
+}
+
+DeletionQueue::~DeletionQueue()
+{
+    stop();
+}
+
+void DeletionQueue::add(const Job &job)
+{
+    const Uint32 id = next_id++;
+    jobs.insert(id, job);
+    {
+        // Removed again, so whatever was kept for it goes now
+        QMutexLocker lock(&kept_mutex);
+        for (const QString &file : job.files)
+            kept.remove(file);
+        kept.remove(job.data_dir);
+    }
+    // Journal first, so the deletion is not forgotten if we crash in the middle of it
+    saveJournal();
+    if (started)
+        schedule(id);
+}
+
+void DeletionQueue::start()
+{
+    if (started)
+        return;
+
+    started = true;
+    abort = false;
+    if (!jobs.isEmpty())
+        Out(SYS_GEN | LOG_NOTICE) << "Resuming " << jobs.count() << " pending deletions" << endl;
+
+    for (auto i = jobs.cbegin(); i != jobs.cend(); i++)
+        schedule(i.key());
+}
+
+void DeletionQueue::stop()
+{
+    if (!started)
+        return;
+
+    abort = true;
+    pool.clear();
+    pool.waitForDone();
+    started = false;
+    files_done = files_total = 0;
+}
+
+bool DeletionQueue::isPending(const QString &tor_dir) const
+{
+    // with or without a separator at the end
+    const QString dir = QDir::cleanPath(tor_dir);
+    for (const Job &job : jobs) {
+        if (QDir::cleanPath(job.tor_dir) == dir)
+            return true;
+    }
+    return false;
+}
+
+bool DeletionQueue::isPendingIn(const QString &path) const
+{
+    if (jobs.isEmpty() || path.isEmpty())
+        return false;
+
+    const QString dir = QDir::cleanPath(path);
+    const QString prefix = dir + QLatin1Char('/');
+    const auto overlaps = [&dir, &prefix](const QString &p) {
+        const QString cp = QDir::cleanPath(p);
+        return cp == dir || cp.startsWith(prefix) || prefix.startsWith(cp + QLatin1Char('/'));
+    };
+
+    for (const Job &job : jobs) {
+        if (!job.data_dir.isEmpty() && overlaps(job.data_dir))
+            return true;
+        if (std::any_of(job.files.cbegin(), job.files.cend(), overlaps))
+            return true;
+    }
+    return false;
+}
+
+void DeletionQueue::keep(const QStringList &files)
+{
+    if (jobs.isEmpty() || files.isEmpty())
+        return;
+
+    const QSet<QString> keep_files(files.cbegin(), files.cend());
+    QSet<QString> keep_dirs;
+    bool changed = false;
+    for (Job &job : jobs) {
+        const int num = job.files.count();
+        job.files.erase(std::remove_if(job.files.begin(),
+                                       job.files.end(),
+                                       [&keep_files](const QString &file) {
+                                           return keep_files.contains(file);
+                                       }),
+                        job.files.end());
+        changed = changed || job.files.count() != num;
+        if (job.data_dir.isEmpty())
+            continue;
+
+        // The directories may be needed for the files, even if they are not there yet
+        bool in_data_dir = job.files.count() != num;
+        const QString prefix = QDir::cleanPath(job.data_dir) + QLatin1Char('/');
+        for (auto i = keep_files.cbegin(); i != keep_files.cend() && !in_data_dir; i++)
+            in_data_dir = i->startsWith(prefix);
+
+        if (in_data_dir) {
+            keep_dirs.insert(job.data_dir);
+            job.data_dir.clear();
+            changed = true;
+        }
+    }
+
+    // A job being deleted right now never has more files of ours than the pending one
+    if (!changed)
+        return;
+
+    QMutexLocker lock(&kept_mutex);
+    kept.unite(keep_files);
+    kept.unite(keep_dirs);
+    lock.unlock();
+    saveJournal();
+}
+
+bool DeletionQueue::isKept(const QString &path) const
+{
+    QMutexLocker lock(&kept_mutex);
+    return kept.contains(path);
+}
+
+void DeletionQueue::schedule(Uint32 id)
+{
+    const Job job = jobs.value(id);
+    files_total += NumFiles(job);
+    Q_EMIT progress(files_done, files_total);
+    pool.start([this, id, job]() {
+        run(id, job);
+    });
+}
+
+void DeletionQueue::run(Uint32 id, const Job &job)
+{
+    // Runs in a worker thread, the results are handed to the main thread
+    int num = 0;
+    QStringList failed;
+    const auto done = [this, &num]() {
+        if (++num % REPORT_INTERVAL == 0) {
+            QMetaObject::invokeMethod(
+                this,
+                [this]() {
+                    filesDone(REPORT_INTERVAL);
+                },
+                Qt::QueuedConnection);
+        }
+    };
+
+    for (const QString &file : job.files) {
+        if (abort)
+            return;
+
+        if (!isKept(file) && !QFile::remove(file) && QFile::exists(file))
+            failed.append(file);
+        done();
+    }
+
+    if (!job.data_dir.isEmpty()) {
+        if (abort)
+            return;
+
+        if (!isKept(job.data_dir))
+            RemoveEmptyDirs(job.data_dir);
+        done();
+    }
+
+    if (!job.tor_dir.isEmpty()) {
+        if (abort)
+            return;
+
+        if (!QDir(job.tor_dir).removeRecursively())
+            failed.append(job.tor_dir);
+        done();
+    }
+
+    QMetaObject::invokeMethod(
+        this,
+        [this, id, num, failed]() {
+            jobDone(id, num % REPORT_INTERVAL, failed);
+        },
+        Qt::QueuedConnection);
+}
+
+void DeletionQueue::filesDone(int num)
+{
+    files_done += num;
+    Q_EMIT progress(files_done, files_total);
+}
+
+void DeletionQueue::jobDone(Uint32 id, int num, const QStringList &failed)
+{
+    jobs.remove(id);
+    saveJournal();
+
+    if (!failed.isEmpty()) {
+        for (const QString &f : failed)
+            Out(SYS_GEN | LOG_IMPORTANT) << "Failed to delete " << f << endl;
+        Q_EMIT error(i18n("Failed to delete %1", failed.join(QStringLiteral(", "))));
+    }
+
+    filesDone(num);
+    if (jobs.isEmpty()) {
+        QMutexLocker lock(&kept_mutex);
+        kept.clear();
+        lock.unlock();
+        files_done = files_total = 0;
+        Q_EMIT finished();
+    }
+}
+
+void DeletionQueue::loadJournal()
+{
+    QFile fptr(journal);
+    if (!fptr.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&fptr);
+    quint32 version = 0, num = 0;
+    in >> version >> num;
+    if (version != JOURNAL_VERSION)
+        return;
+
+    for (quint32 i = 0; i < num && in.status() == QDataStream::Ok; i++) {
+        Job job;
+        in >> job.files >> job.data_dir >> job.tor_dir;
+        if (in.status() == QDataStream::Ok)
+            jobs.insert(next_id++, job);
+    }
+
+    if (in.status() != QDataStream::Ok)
+        Out(SYS_GEN | LOG_NOTICE) << "Deletion journal " << journal << " is incomplete" << endl;
+}
+
+void DeletionQueue::saveJournal() const
+{
+    if (jobs.isEmpty()) {
+        QFile::remove(journal);
+        return;
+    }
+
+    QSaveFile fptr(journal);
+    if (!fptr.open(QIODevice::WriteOnly)) {
+        Out(SYS_GEN | LOG_IMPORTANT) << "Failed to open " << journal << " : " << fptr.errorString() << endl;
+        return;
+    }
+
+    QDataStream out(&fptr);
+    out << JOURNAL_VERSION << (quint32)jobs.count();
+    for (const Job &job : jobs)
+        out << job.files << job.data_dir << job.tor_dir;
+
+    if (!fptr.commit())
+        Out(SYS_GEN | LOG_IMPORTANT) << "Failed to write " << journal << " : " << fptr.errorString() << endl;
+}
+
+}
+
+#include "moc_deletionqueue.cpp"
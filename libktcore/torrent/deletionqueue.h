@@ -0,0 +1,122 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_DELETIONQUEUE_H
+#define KT_DELETIONQUEUE_H
+
+#include <atomic>
+
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <ktcore_export.h>
+#include <util/constants.h>
+
+namespace kt
+{
+/**
+ * @brief Deletes the files of removed torrents in the background
+ *
+ * Deleting the data of a big torrent can take a long time, so when a torrent
+ * is removed, only the torrent itself is removed right away, and its files are
+ * deleted by a small pool of worker threads.
+ *
+ * The queue is kept in a journal file, which is written before a deletion is
+ * started and after it has finished. Deletions which were still pending when
+ * KTorrent quit (or crashed) are picked up again by start at the next startup.
+ */
+class KTCORE_EXPORT DeletionQueue : public QObject
+{
+    Q_OBJECT
+public:
+    struct Job {
+        QStringList files; // data files
+        QString data_dir; // data directory, removed with its subdirectories as far as they are empty
+        QString tor_dir; // torrent directory, removed with everything in it
+    };
+
+    /**
+     * Constructor, loads the pending deletions from the journal, but does not start them.
+     * @param journal The journal file
+     * @param max_concurrent Maximum number of deletions going on at the same time
+     * @param parent The parent
+     */
+    DeletionQueue(const QString &journal, int max_concurrent, QObject *parent = nullptr);
+
+    /// Destructor, stops the deletions, unfinished ones remain in the journal
+    ~DeletionQueue() override;
+
+    /// Add a deletion, it is started right away if the queue has been started
+    void add(const Job &job);
+
+    /// Start all pending deletions, and the ones added from now on
+    void start();
+
+    /// Stop after the files being deleted right now, the rest remains in the journal
+    void stop();
+
+    /// Get the number of pending deletions
+    int pending() const
+    {
+        return jobs.count();
+    }
+
+    /// Is there a pending deletion of a torrent directory
+    bool isPending(const QString &tor_dir) const;
+
+    /**
+     * Is there a pending deletion of a file or data directory at path, in it, or containing it.
+     * This is a cheap check before building the file list of a torrent for keep.
+     * @param path The data file or directory of a torrent
+     */
+    bool isPendingIn(const QString &path) const;
+
+    /**
+     * Files which belong to a torrent again, for example one which was removed and added
+     * again at the same location. They are taken out of the pending deletions, also the
+     * ones which are being deleted right now, and so are the data directories they are in.
+     * @param files The files
+     */
+    void keep(const QStringList &files);
+
+Q_SIGNALS:
+    /// Progress in files of all deletions since the queue was last empty
+    void progress(int done, int total);
+
+    /// Files could not be deleted
+    void error(const QString &msg);
+
+    /// All deletions are done
+    void finished();
+
+private:
+    void schedule(bt::Uint32 id);
+    void run(bt::Uint32 id, const Job &job);
+    void filesDone(int num);
+    void jobDone(bt::Uint32 id, int num, const QStringList &failed);
+    bool isKept(const QString &path) const;
+    void loadJournal();
+    void saveJournal() const;
+
+private:
+    QString journal;
+    QMap<bt::Uint32, Job> jobs;
+    bt::Uint32 next_id;
+    bool started;
+    std::atomic<bool> abort;
+    int files_done;
+    int files_total;
+    QThreadPool pool;
+    mutable QMutex kept_mutex;
+    QSet<QString> kept; // checked by the workers, a job they are running is a copy
+};
+
+}
+
+#endif
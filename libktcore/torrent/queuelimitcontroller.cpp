@@ -0,0 +1,89 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "queuelimitcontroller.h"
+
+#include <algorithm>
+
+using namespace bt;
+
+namespace kt
+{
+// Weight of a new sample in the utilization
+static const double UTILIZATION_WEIGHT = 0.5;
+
+QueueLimitController::QueueLimitController(const QString &name)
+    : name(name)
+    , min_limit(1)
+    , max_limit(1)
+    , current(1)
+    , utilization(0.0)
+    , has_utilization(false)
+    , below(0)
+    , above(0)
+    , cooldown(0)
+{
+}
+
+void QueueLimitController::setBounds(int min, int max)
+{
+    min_limit = min;
+    max_limit = std::max(min, max);
+    current = std::clamp(current, min_limit, max_limit);
+}
+
+void QueueLimitController::reset(int limit)
+{
+    current = std::clamp(limit, min_limit, max_limit);
+    has_utilization = false;
+    below = above = cooldown = 0;
+}
+
+int QueueLimitController::update(Uint64 rate, Uint64 cap, int running, int waiting, Uint64 slowest, QString &reason)
+{
+    if (cap == 0) {
+        has_utilization = false;
+        below = above = 0;
+        return 0;
+    }
+
+    const double sample = double(rate) / double(cap);
+    utilization = has_utilization ? (1.0 - UTILIZATION_WEIGHT) * utilization + UTILIZATION_WEIGHT * sample : sample;
+    has_utilization = true;
+
+    if (cooldown > 0) {
+        cooldown--;
+        return 0;
+    }
+
+    if (utilization < GROW_BELOW) {
+        below++;
+        above = 0;
+    } else if (utilization > SHRINK_ABOVE) {
+        above++;
+        below = 0;
+    } else {
+        below = above = 0;
+    }
+
+    const int percent = int(utilization * 100.0 + 0.5);
+    if (below >= HOLD_SAMPLES && running >= current && waiting > 0 && current < max_limit) {
+        current++;
+        reason = QStringLiteral("%1 use %2% of the speed limit and %3 are waiting, allowing %4").arg(name).arg(percent).arg(waiting).arg(current);
+    } else if (above >= HOLD_SAMPLES && running > min_limit && rate - std::min(rate, slowest) >= GROW_BELOW * cap) {
+        // the limit might be above the number of torrents which can run, so go below what is running
+        current = std::max(min_limit, std::min(current, running) - 1);
+        reason = QStringLiteral("%1 use %2% of the speed limit, and still would without the slowest one, allowing %3").arg(name).arg(percent).arg(current);
+    } else {
+        return 0;
+    }
+
+    const int change = below >= HOLD_SAMPLES ? 1 : -1;
+    below = above = 0;
+    cooldown = COOLDOWN_SAMPLES;
+    return change;
+}
+
+}
@@ -0,0 +1,90 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_QUEUELIMITCONTROLLER_H
+#define KT_QUEUELIMITCONTROLLER_H
+
+#include <QString>
+
+#include <ktcore_export.h>
+#include <util/constants.h>
+
+namespace kt
+{
+/**
+ * @brief Adapts the number of running torrents to the speed limit
+ *
+ * Feedback controller for one queue limit (downloads or seeds). It is fed
+ * the total rate of the running torrents every few seconds, and compares it
+ * with the speed limit:
+ * - When the rate stays below GROW_BELOW of the limit, while the queue limit
+ *   is reached and torrents are waiting, one more torrent is allowed to run.
+ * - When the rate stays above SHRINK_ABOVE of the limit, and it would still
+ *   be above GROW_BELOW without the slowest torrent, one torrent less runs.
+ *
+ * The gap between the two thresholds, the number of samples a condition must
+ * hold, and the pause after every change, keep it from going up and down all
+ * the time. Without a speed limit the controller does nothing.
+ */
+class KTCORE_EXPORT QueueLimitController
+{
+public:
+    /// Grow when the rate is below this fraction of the speed limit
+    static constexpr double GROW_BELOW = 0.85;
+
+    /// Shrink when the rate is above this fraction of the speed limit
+    static constexpr double SHRINK_ABOVE = 0.95;
+
+    /// Number of samples in a row a condition must hold
+    static const int HOLD_SAMPLES = 3;
+
+    /// Number of samples to wait after a change, so swarms have time to get up to speed
+    static const int COOLDOWN_SAMPLES = 6;
+
+    explicit QueueLimitController(const QString &name);
+
+    /**
+     * Set the bounds of the limit.
+     * @param min Minimum limit
+     * @param max Maximum limit
+     */
+    void setBounds(int min, int max);
+
+    /// Set the current limit, within the bounds, and start over
+    void reset(int limit);
+
+    /// Get the current limit
+    int limit() const
+    {
+        return current;
+    }
+
+    /**
+     * Feed a sample, and adjust the limit.
+     * @param rate Total rate of the running torrents in bytes per second
+     * @param cap The speed limit in bytes per second, 0 if there is none
+     * @param running Number of running torrents
+     * @param waiting Number of torrents waiting to be started
+     * @param slowest Rate of the slowest running torrent
+     * @param reason Set to the reason when the limit changes
+     * @return The change of the limit, 0 if it did not change
+     */
+    int update(bt::Uint64 rate, bt::Uint64 cap, int running, int waiting, bt::Uint64 slowest, QString &reason);
+
+private:
+    QString name;
+    int min_limit;
+    int max_limit;
+    int current;
+    double utilization;
+    bool has_utilization;
+    int below;
+    int above;
+    int cooldown;
+};
+
+}
+
+#endif
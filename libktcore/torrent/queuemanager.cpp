@@ -12,7 +12,9 @@
 
 #include <algorithm>
 #include <climits>
+#include <interfaces/coreinterface.h>
 #include <interfaces/torrentinterface.h>
+#include <interfaces/trackerinterface.h>
 #include <interfaces/trackerslist.h>
 #include <settings.h>
 #include <torrent/globals.h>
@@ -30,18 +32,39 @@ using namespace bt;
 
 namespace kt
 {
+// Number of times per durability window the stats of torrents are written
+static const bt::Uint32 STATS_SYNC_FLUSHES = 10;
+
+// If stalled torrents have not been checked for this long, the stall wheel is rebuilt
+static const bt::TimeStamp STALL_CHECK_GAP = 10 * 1000;
+
 QueueManager::QueueManager()
     : QObject()
+    , download_limit(QStringLiteral("Downloads"))
+    , seed_limit(QStringLiteral("Seeds"))
 {
     max_downloads = 0;
     max_seeds = 0; // for testing. Needs to be added to Settings::
+    adaptive_limits = false;
+    last_limits_update = 0;
 
     keep_seeding = true; // test. Will be passed from Core
     suspended_state = false;
     exiting = false;
     ordering = false;
 
-    last_stats_sync_permitted = 0;
+    queue_seq = 0;
+    queue_changed = false;
+
+    startup_active = false;
+    startup_begin = 0;
+    startup_started = 0;
+    startup_timer.setSingleShot(true);
+    connect(&startup_timer, &QTimer::timeout, this, &QueueManager::startupStep);
+
+    stall_watching = false;
+    stall_time = 0;
+    last_stall_check = 0;
 
     if (QNetworkInformation::loadBackendByFeatures(QNetworkInformation::Feature::Reachability)) {
         connect(QNetworkInformation::instance(), &QNetworkInformation::reachabilityChanged, this, [this](QNetworkInformation::Reachability newReachability) {
@@ -58,25 +81,135 @@ QueueManager::~QueueManager()
 void QueueManager::append(bt::TorrentInterface *tc)
 {
     downloads.append(tc);
+    info_hash_index.insert(tc->getInfoHash(), tc);
+    insertIntoQueue(tc);
+    indexFiles(tc);
     connect(tc, &TorrentInterface::diskSpaceLow, this, &QueueManager::onLowDiskSpace);
     connect(tc, &TorrentInterface::torrentStopped, this, &QueueManager::torrentStopped);
-    connect(tc, &TorrentInterface::updateQueue, this, &QueueManager::orderQueue);
+    connect(tc, &TorrentInterface::updateQueue, this, [this, tc]() {
+        // the priority may have been set on the torrent itself
+        setPriority(tc, tc->getPriority());
+        orderQueue();
+    });
+    connect(tc, &TorrentInterface::statusChanged, this, &QueueManager::torrentStatusChanged);
 }
 
 void QueueManager::remove(bt::TorrentInterface *tc)
 {
     suspended_torrents.erase(tc);
-    int index = downloads.indexOf(tc);
-    if (index != -1)
+    startup_queued.remove(tc);
+    startup_in_flight.remove(tc);
+    stall_wheel.cancel(tc);
+    stalled.remove(tc);
+    moving_files.remove(tc);
+    const qsizetype index = downloadIndex(tc);
+    if (index != -1) {
+        auto i = info_hash_index.find(tc->getInfoHash());
+        if (i != info_hash_index.end() && i.value() == tc)
+            info_hash_index.erase(i);
+        // Taking a torrent out keeps the rest of downloads in queue order
+        const bool changed = queue_changed;
+        removeFromQueue(tc);
+        queue_changed = changed;
+        unindexFiles(tc);
         downloads.takeAt(index)->deleteLater();
+    }
+}
+
+qsizetype QueueManager::downloadIndex(bt::TorrentInterface *tc) const
+{
+    if (queue_changed)
+        return downloads.indexOf(tc);
+
+    // downloads is in queue order, so it can be searched on the queue key
+    auto k = queue_keys.constFind(tc);
+    if (k == queue_keys.cend())
+        return -1;
+
+    auto i = std::lower_bound(downloads.cbegin(), downloads.cend(), k.value(), [this](bt::TorrentInterface *t, const QueueKey &key) {
+        return queue_keys.value(t) < key;
+    });
+    return i != downloads.cend() && *i == tc ? i - downloads.cbegin() : -1;
 }
 
 void QueueManager::clear()
 {
     exiting = true;
+    endStartup();
     suspended_torrents.clear();
     qDeleteAll(downloads);
     downloads.clear();
+    info_hash_index.clear();
+    queue.clear();
+    queue_keys.clear();
+    file_index.clear();
+    indexed_files.clear();
+    stale_files.clear();
+    moving_files.clear();
+    stalled.clear();
+    stall_watching = false;
+}
+
+void QueueManager::insertIntoQueue(bt::TorrentInterface *tc)
+{
+    QueueKey key = {tc->getPriority(), queue_seq++};
+    queue.emplace(key, tc);
+    queue_keys.insert(tc, key);
+    queue_changed = true;
+}
+
+void QueueManager::removeFromQueue(bt::TorrentInterface *tc)
+{
+    auto i = queue_keys.find(tc);
+    if (i == queue_keys.end())
+        return;
+
+    queue.erase(i.value());
+    queue_keys.erase(i);
+    queue_changed = true;
+}
+
+void QueueManager::setPriority(bt::TorrentInterface *tc, int priority)
+{
+    auto i = queue_keys.find(tc);
+    if (i != queue_keys.end() && i.value().priority != priority) {
+        queue.erase(i.value());
+        i.value().priority = priority;
+        queue.emplace(i.value(), tc);
+        queue_changed = true;
+    }
+
+    if (tc->getPriority() != priority)
+        tc->setPriority(priority);
+}
+
+void QueueManager::syncQueue()
+{
+    if (queue_changed) {
+        downloads.clear();
+        downloads.reserve(queue.size());
+        for (const auto &i : queue)
+            downloads.append(i.second);
+        queue_changed = false;
+    }
+}
+
+int QueueManager::highestPriority() const
+{
+    return queue.empty() ? 0 : queue.begin()->first.priority;
+}
+
+void QueueManager::renormalizePriorities()
+{
+    // New and stalled torrents go below the lowest priority, so priorities keep drifting down.
+    // Once they are spread out a lot more than there are torrents, number them again,
+    // this happens once in many additions, so the cost of it stays small.
+    if (queue.empty())
+        return;
+
+    const qint64 spread = qint64(queue.begin()->first.priority) - queue.rbegin()->first.priority;
+    if (spread > 4 * qint64(queue.size()) + 1024)
+        reindexQueue();
 }
 
 TorrentStartResponse QueueManager::startInternal(bt::TorrentInterface *tc)
@@ -127,9 +260,21 @@ bool QueueManager::checkLimits(TorrentInterface *tc, bool interactive)
     return false;
 }
 
+bool QueueManager::enoughDiskSpace(TorrentInterface *tc)
+{
+    // the free space is cached per file system, if everything which is left fits, we are done
+    const TorrentStats &s = tc->getStats();
+    Uint64 bytes_free = 0;
+    if (disk_space.freeSpace(s.output_path, bytes_free, bt::CurrentTime()) && bytes_free >= s.bytes_left_to_download)
+        return true;
+
+    // it might still fit when (some of) the files have already been allocated
+    return tc->checkDiskSpace(false);
+}
+
 bool QueueManager::checkDiskSpace(TorrentInterface *tc, bool interactive)
 {
-    if (tc->checkDiskSpace(false))
+    if (enoughDiskSpace(tc))
         return true;
 
     // we're short!
@@ -213,7 +358,7 @@ void QueueManager::checkDiskSpace(QList<bt::TorrentInterface *> &todo)
         QList<bt::TorrentInterface *> tmp;
         for (bt::TorrentInterface *tc : std::as_const(todo)) {
             const TorrentStats &s = tc->getStats();
-            if (!s.completed && !tc->checkDiskSpace(false)) {
+            if (!s.completed && !enoughDiskSpace(tc)) {
                 names.append(s.torrent_name);
                 tmp.append(tc);
             }
@@ -238,7 +383,7 @@ void QueueManager::checkDiskSpace(QList<bt::TorrentInterface *> &todo)
         while (i != todo.end()) {
             bt::TorrentInterface *tc = *i;
             const TorrentStats &s = tc->getStats();
-            if (!s.completed && !tc->checkDiskSpace(false))
+            if (!s.completed && !enoughDiskSpace(tc))
                 i = todo.erase(i);
             else
                 i++;
@@ -333,6 +478,8 @@ void QueueManager::start(QList<bt::TorrentInterface *> &todo)
 
         if (enabled())
             tc->setAllowedToStart(true);
+        else if (startup_active)
+            enqueueStartup(tc);
         else
             startSafely(tc);
     }
@@ -392,6 +539,7 @@ void QueueManager::startAutoStartTorrents()
 void QueueManager::onExit(WaitJob *wjob)
 {
     exiting = true;
+    endStartup();
     QList<bt::TorrentInterface *>::iterator i = downloads.begin();
     while (i != downloads.end()) {
         bt::TorrentInterface *tc = *i;
@@ -489,11 +637,145 @@ void QueueManager::onLowDiskSpace(bt::TorrentInterface *tc, bool toStop)
     Q_EMIT lowDiskSpace(tc, toStop);
 }
 
+void QueueManager::checkLowDiskSpace(bt::TimeStamp now)
+{
+    // When downloads are forced to start on low disk space, they should not be stopped either
+    const int horizon = Settings::diskFullPredictionTime();
+    if (horizon == 0 || exiting || suspended_state || Settings::startDownloadsOnLowDiskSpace() == 2)
+        return;
+
+    if (!disk_space.update(now))
+        return; // nothing new
+
+    const Uint64 reserve = Uint64(Settings::minDiskSpace()) * 1024 * 1024;
+    QSet<QString> filling_up;
+    const QStringList mount_points = disk_space.mountPoints();
+    for (const QString &mp : mount_points) {
+        const double seconds = disk_space.secondsUntilFull(mp, reserve);
+        if (seconds >= 0.0 && seconds < horizon)
+            filling_up.insert(mp);
+    }
+
+    if (filling_up.isEmpty())
+        return;
+
+    // only now look at the torrents, stop the ones on those file systems which will not fit anymore
+    bool stopped = false;
+    const QueuePtrList todo = downloads;
+    for (bt::TorrentInterface *tc : todo) {
+        const TorrentStats &s = tc->getStats();
+        if (!s.running || s.completed)
+            continue;
+
+        const QString mp = disk_space.mountPoint(s.output_path);
+        if (!filling_up.contains(mp) || enoughDiskSpace(tc))
+            continue;
+
+        // Unlike a torrent which ran out of disk space, it stays allowed to start, the
+        // disk space check in startInternal keeps it stopped until there is enough room
+        Out(SYS_GEN | LOG_NOTICE) << "The disk " << mp << " will be full within " << horizon << " seconds, stopping " << s.torrent_name << endl;
+        stopSafely(tc);
+        stopped = true;
+        Q_EMIT lowDiskSpace(tc, true);
+    }
+
+    if (stopped && enabled())
+        orderQueue();
+}
+
 void QueueManager::setMaxSeeds(int m)
 {
     max_seeds = m;
 }
 
+void QueueManager::setAdaptiveLimits(bool on)
+{
+    if (adaptive_limits == on)
+        return;
+
+    adaptive_limits = on;
+    if (on) {
+        // start from the configured limits, or from what is running now if there are none
+        const int num_torrents = std::max(1, int(downloads.count()));
+        download_limit.setBounds(1, max_downloads > 0 ? max_downloads : num_torrents);
+        download_limit.reset(max_downloads > 0 ? max_downloads : getNumRunning(DOWNLOADS));
+        seed_limit.setBounds(1, max_seeds > 0 ? max_seeds : num_torrents);
+        seed_limit.reset(max_seeds > 0 ? max_seeds : getNumRunning(SEEDS));
+        last_limits_update = bt::CurrentTime();
+    }
+    orderQueue();
+}
+
+void QueueManager::adaptLimits(const CurrentStats &stats, bt::TimeStamp now)
+{
+    if (!adaptive_limits)
+        return;
+
+    last_limits_update = now;
+    if (!enabled() || suspended_state)
+        return;
+
+    int downloads_running = 0;
+    int downloads_waiting = 0;
+    int seeds_running = 0;
+    int seeds_waiting = 0;
+    Uint64 slowest_download = 0;
+    Uint64 slowest_seed = 0;
+    for (bt::TorrentInterface *tc : std::as_const(downloads)) {
+        const TorrentStats &s = tc->getStats();
+        if (s.running) {
+            if (s.completed) {
+                slowest_seed = seeds_running++ == 0 ? s.upload_rate : std::min<Uint64>(slowest_seed, s.upload_rate);
+            } else {
+                slowest_download = downloads_running++ == 0 ? s.download_rate : std::min<Uint64>(slowest_download, s.download_rate);
+            }
+        } else if (s.queued) {
+            if (s.completed)
+                seeds_waiting++;
+            else
+                downloads_waiting++;
+        }
+    }
+
+    const int num_torrents = std::max(1, int(downloads.count()));
+    download_limit.setBounds(1, max_downloads > 0 ? max_downloads : num_torrents);
+    seed_limit.setBounds(1, max_seeds > 0 ? max_seeds : num_torrents);
+
+    // seeds share the upload limit with the downloads, so look at the total upload speed
+    bool changed = false;
+    QString reason;
+    // Without a speed limit there is nothing to adapt to, the configured maximum applies then (see downloadLimit),
+    // keep up with what is running, so the controller starts from there once a speed limit is set
+    const Uint64 download_cap = Uint64(Settings::maxDownloadRate()) * 1024;
+    if (download_cap == 0)
+        download_limit.reset(max_downloads > 0 ? max_downloads : downloads_running);
+    else if (download_limit.update(stats.download_speed, download_cap, downloads_running, downloads_waiting, slowest_download, reason) != 0) {
+        Out(SYS_GEN | LOG_NOTICE) << "QM: " << reason << endl;
+        changed = true;
+    }
+
+    const Uint64 upload_cap = Uint64(Settings::maxUploadRate()) * 1024;
+    if (upload_cap == 0)
+        seed_limit.reset(max_seeds > 0 ? max_seeds : seeds_running);
+    else if (seed_limit.update(stats.upload_speed, upload_cap, seeds_running, seeds_waiting, slowest_seed, reason) != 0) {
+        Out(SYS_GEN | LOG_NOTICE) << "QM: " << reason << endl;
+        changed = true;
+    }
+
+    if (changed)
+        orderQueue();
+}
+
+int QueueManager::downloadLimit() const
+{
+    return adaptive_limits && Settings::maxDownloadRate() > 0 ? download_limit.limit() : max_downloads;
+}
+
+int QueueManager::seedLimit() const
+{
+    return adaptive_limits && Settings::maxUploadRate() > 0 ? seed_limit.limit() : max_seeds;
+}
+
 void QueueManager::setKeepSeeding(bool ks)
 {
     keep_seeding = ks;
@@ -501,50 +783,43 @@ void QueueManager::setKeepSeeding(bool ks)
 
 bool QueueManager::alreadyLoaded(const bt::SHA1Hash &ih) const
 {
-    for (const bt::TorrentInterface *tor : std::as_const(downloads)) {
-        if (tor->getInfoHash() == ih)
-            return true;
-    }
-    return false;
+    return info_hash_index.contains(ih);
+}
+
+bt::TorrentInterface *QueueManager::find(const bt::SHA1Hash &ih) const
+{
+    return info_hash_index.value(ih, nullptr);
 }
 
 void QueueManager::mergeAnnounceList(const bt::SHA1Hash &ih, const TrackerTier *trk)
 {
-    for (bt::TorrentInterface *tor : std::as_const(downloads)) {
-        if (tor->getInfoHash() == ih) {
-            TrackersList *ta = tor->getTrackersList();
-            const int cnt = ta->getTrackers().count();
-            ta->merge(trk);
-            if (cnt < ta->getTrackers().count()) {
-                // new trackers were added
-                // do "Manual Announce" for this torrent
-                if (tor->getStats().running) {
-                    tor->updateTracker();
-                }
-            }
-            return;
+    bt::TorrentInterface *tor = find(ih);
+    if (!tor)
+        return;
+
+    TrackersList *ta = tor->getTrackersList();
+    const int cnt = ta->getTrackers().count();
+    ta->merge(trk);
+    if (cnt < ta->getTrackers().count()) {
+        // new trackers were added
+        // do "Manual Announce" for this torrent
+        if (tor->getStats().running) {
+            tor->updateTracker();
         }
     }
 }
 
 bool QueueManager::permitStatsSync(TorrentControl *tc)
 {
-    // we want to assure that minimum time interval delay is happen
-    // before next TorrentControl dumps its State to the file
-
-    // if you have more than 500 running torrents it's feasible to
-    // increase the period to avoid too small interval value
-    const TimeStamp max_period = (50 * 60 * 1000) * (downloads.size() / 500 + 1);
+    // group the writes of all torrents which are due, so the disk is
+    // only woken up once every flush period instead of all the time
+    return stats_sync.permit(bt::CurrentTime(), tc->getStatsSyncElapsedTime());
+}
 
-    if (tc->getStatsSyncElapsedTime() >= max_period) {
-        const bt::TimeStamp now = Now();
-        const bt::TimeStamp interval = max_period / downloads.size();
-        if (now - last_stats_sync_permitted > interval) {
-            last_stats_sync_permitted = now;
-            return true;
-        }
-    }
-    return false;
+void QueueManager::setStatsSyncWindow(int minutes, int max_per_tick)
+{
+    stats_sync.setWindow(bt::TimeStamp(minutes) * 60 * 1000, STATS_SYNC_FLUSHES);
+    stats_sync.setMaxPerTick(max_per_tick);
 }
 
 void QueueManager::orderQueue()
@@ -554,7 +829,7 @@ void QueueManager::orderQueue()
 
     Q_EMIT orderingQueue();
 
-    downloads.sort(); // sort downloads, even when suspended so that the QM widget is updated
+    syncQueue(); // put downloads in order, even when suspended so that the QM widget is updated
     if (Settings::manuallyControlTorrents() || suspended_state) {
         Q_EMIT queueOrdered();
         return;
@@ -562,56 +837,50 @@ void QueueManager::orderQueue()
 
     RecursiveEntryGuard guard(&ordering); // make sure that recursive entering of this function is not possible
 
-    QueuePtrList download_queue;
-    QueuePtrList seed_queue;
+    // During startup the walk decides again which torrents should run
+    startup_pending.clear();
+    startup_queued.clear();
 
-    for (TorrentInterface *tc : std::as_const(downloads)) {
+    // Walk the queue once, and only start, stop or queue torrents whose state has to change.
+    // Starting or stopping may call back into the QueueManager, so walk a copy of it.
+    const QueuePtrList order = downloads;
+    int num_downloading = 0;
+    int num_seeding = 0;
+    for (TorrentInterface *tc : order) {
         const TorrentStats &s = tc->getStats();
-        if (s.running || (tc->isAllowedToStart() && !s.stopped_by_error && !tc->getJobQueue()->runningJobs())) {
-            if (s.completed) {
-                if (s.running || (!tc->overMaxRatio() && !tc->overMaxSeedTime()))
-                    seed_queue.append(tc);
-            } else
-                download_queue.append(tc);
-        }
-    }
+        if (!s.running && (!tc->isAllowedToStart() || s.stopped_by_error || tc->getJobQueue()->runningJobs()))
+            continue;
 
-    int num_running = 0;
-    for (bt::TorrentInterface *tc : std::as_const(download_queue)) {
-        const TorrentStats &s = tc->getStats();
+        int *num_running = &num_downloading;
+        int max_running = downloadLimit();
+        if (s.completed) {
+            if (!s.running && (tc->overMaxRatio() || tc->overMaxSeedTime()))
+                continue;
 
-        if (num_running < max_downloads || max_downloads == 0) {
-            if (!s.running) {
-                Out(SYS_GEN | LOG_DEBUG) << "QM Starting: " << s.torrent_name << endl;
-                if (startInternal(tc) == bt::START_OK)
-                    num_running++;
-            } else
-                num_running++;
-        } else {
-            if (s.running) {
-                Out(SYS_GEN | LOG_DEBUG) << "QM Stopping: " << s.torrent_name << endl;
-                stopSafely(tc);
-            }
-            tc->setQueued(true);
+            num_running = &num_seeding;
+            max_running = seedLimit();
         }
-    }
 
-    num_running = 0;
-    for (bt::TorrentInterface *tc : std::as_const(seed_queue)) {
-        const TorrentStats &s = tc->getStats();
-        if (num_running < max_seeds || max_seeds == 0) {
-            if (!s.running) {
+        if (*num_running < max_running || max_running == 0) {
+            if (!s.running && startup_active) {
+                // Count it as running, startupStep will start it when it gets its turn
+                if (!startup_in_flight.contains(tc))
+                    enqueueStartup(tc);
+                (*num_running)++;
+            } else if (!s.running) {
                 Out(SYS_GEN | LOG_DEBUG) << "QM Starting: " << s.torrent_name << endl;
                 if (startInternal(tc) == bt::START_OK)
-                    num_running++;
+                    (*num_running)++;
             } else
-                num_running++;
+                (*num_running)++;
         } else {
             if (s.running) {
                 Out(SYS_GEN | LOG_DEBUG) << "QM Stopping: " << s.torrent_name << endl;
                 stopSafely(tc);
             }
-            tc->setQueued(true);
+
+            if (!s.queued)
+                tc->setQueued(true);
         }
     }
 
@@ -633,15 +902,19 @@ void QueueManager::torrentFinished(bt::TorrentInterface *tc)
 void QueueManager::torrentAdded(bt::TorrentInterface *tc, bool start_torrent)
 {
     if (enabled()) {
-        // new torrents have the lowest priority
-        // so everybody else gets a higher priority
-        for (TorrentInterface *otc : std::as_const(downloads)) {
-            int p = otc->getPriority();
-            otc->setPriority(p + 1);
-        }
+        // new torrents have the lowest priority, going below the others
+        // means nobody else needs a new priority
         tc->setAllowedToStart(start_torrent);
-        tc->setPriority(0);
-        rearrangeQueue();
+        syncQueue();
+        int lowest = tc->getPriority();
+        for (auto i = queue.rbegin(); i != queue.rend(); i++) {
+            if (i->second != tc) {
+                lowest = i->first.priority;
+                break;
+            }
+        }
+        setPriority(tc, queue.size() > 1 ? lowest - 1 : 0);
+        renormalizePriorities();
         orderQueue();
     } else {
         if (start_torrent)
@@ -652,7 +925,6 @@ void QueueManager::torrentAdded(bt::TorrentInterface *tc, bool start_torrent)
 void QueueManager::torrentRemoved(bt::TorrentInterface *tc)
 {
     remove(tc);
-    rearrangeQueue();
     orderQueue();
 }
 
@@ -660,7 +932,6 @@ void QueueManager::torrentsRemoved(QList<bt::TorrentInterface *> &tors)
 {
     for (bt::TorrentInterface *tc : std::as_const(tors))
         remove(tc);
-    rearrangeQueue();
     orderQueue();
 }
 
@@ -682,6 +953,7 @@ void QueueManager::setSuspendedState(bool suspend)
         suspended_torrents.clear();
         orderQueue();
     } else {
+        endStartup();
         for (TorrentInterface *tc : std::as_const(downloads)) {
             const TorrentStats &s = tc->getStats();
             if (s.running) {
@@ -693,10 +965,127 @@ void QueueManager::setSuspendedState(bool suspend)
     Q_EMIT suspendStateChanged(suspended_state);
 }
 
-void QueueManager::rearrangeQueue()
+void QueueManager::beginStartup()
+{
+    if (startup_active || exiting)
+        return;
+
+    startup_active = true;
+    startup_begin = bt::Now();
+    startup_started = 0;
+    // Start the first batch once orderQueue or startAutoStartTorrents has filled the list
+    startup_timer.start(0);
+}
+
+void QueueManager::enqueueStartup(bt::TorrentInterface *tc)
+{
+    if (!startup_queued.contains(tc)) {
+        startup_queued.insert(tc);
+        startup_pending.append(tc);
+    }
+}
+
+void QueueManager::endStartup()
 {
-    downloads.sort();
-    reindexQueue();
+    startup_timer.stop();
+    startup_pending.clear();
+    startup_queued.clear();
+    startup_in_flight.clear();
+    startup_active = false;
+}
+
+static bool IsStartupBusy(bt::TorrentInterface *tc, bool *announcing, bool *checking)
+{
+    const TorrentStats &s = tc->getStats();
+    *checking = s.status == bt::CHECKING_DATA || s.status == bt::ALLOCATING_DISKSPACE || tc->getJobQueue()->runningJobs();
+
+    bt::TrackerInterface *trk = tc->getTrackersList()->getCurrentTracker();
+    *announcing = trk && trk->trackerStatus() == bt::TRACKER_ANNOUNCING;
+    return *announcing || *checking;
+}
+
+void QueueManager::startupStep()
+{
+    if (!startup_active)
+        return;
+
+    // Torrents have to be running for a little while before they have started announcing or checking data
+    const bt::Uint32 MIN_SETTLE_TIME = 250;
+    const bt::TimeStamp step_start = bt::Now();
+
+    int num_announcing = 0;
+    int num_checking = 0;
+    for (auto i = startup_in_flight.begin(); i != startup_in_flight.end();) {
+        bt::TorrentInterface *tc = i.key();
+        bool announcing = false;
+        bool checking = false;
+        if (!tc->getStats().running && !tc->getJobQueue()->runningJobs()) {
+            i = startup_in_flight.erase(i);
+        } else if (IsStartupBusy(tc, &announcing, &checking) || step_start - i.value() < MIN_SETTLE_TIME) {
+            if (announcing)
+                num_announcing++;
+            if (checking)
+                num_checking++;
+            i++;
+        } else {
+            i = startup_in_flight.erase(i);
+        }
+    }
+
+    const int batch_size = Settings::startupBatchSize();
+    const int max_announces = Settings::startupMaxAnnounces();
+    const int max_checks = Settings::startupMaxDataChecks();
+    int started = 0;
+    while (!startup_queued.isEmpty() && !exiting && !suspended_state) {
+        if (batch_size > 0 && started >= batch_size)
+            break;
+        if (max_announces > 0 && num_announcing + started >= max_announces)
+            break;
+        if (max_checks > 0 && num_checking >= max_checks)
+            break;
+
+        // Removed torrents are only taken out of startup_queued, skip them
+        bt::TorrentInterface *tc = startup_pending.takeFirst();
+        if (!startup_queued.remove(tc))
+            continue;
+
+        const TorrentStats &s = tc->getStats();
+        if (s.running || tc->getJobQueue()->runningJobs())
+            continue;
+
+        if (enabled()) {
+            if (!tc->isAllowedToStart())
+                continue;
+            Out(SYS_GEN | LOG_DEBUG) << "QM Starting: " << s.torrent_name << endl;
+            if (startInternal(tc) != bt::START_OK)
+                continue;
+        } else {
+            startSafely(tc);
+        }
+
+        startup_in_flight.insert(tc, bt::Now());
+        startup_started++;
+        started++;
+
+        // A torrent which has to check its data, does so right away
+        bool announcing = false;
+        bool checking = false;
+        IsStartupBusy(tc, &announcing, &checking);
+        if (checking)
+            num_checking++;
+    }
+
+    if ((startup_queued.isEmpty() && startup_in_flight.isEmpty()) || exiting || suspended_state) {
+        Out(SYS_GEN | LOG_NOTICE) << "Started " << startup_started << " torrents in " << (bt::Now() - startup_begin) << " ms" << endl;
+        endStartup();
+        if (enabled())
+            orderQueue();
+        return;
+    }
+
+    // Give the event loop as much time as the batch took, so the GUI stays responsive
+    const bt::TimeStamp elapsed = bt::Now() - step_start;
+    startup_timer.start(int(qBound<bt::TimeStamp>(50, elapsed, 5000)));
 }
 
 void QueueManager::startSafely(bt::TorrentInterface *tc)
@@ -726,52 +1115,112 @@ void QueueManager::torrentStopped(bt::TorrentInterface *)
     orderQueue();
 }
 
-static bool IsStalled(bt::TorrentInterface *tc, bt::TimeStamp now, bt::Uint32 min_stall_time)
+static bt::TimeStamp LastActivity(bt::TorrentInterface *tc)
 {
-    bt::Int64 stalled_time = 0;
-    if (tc->getStats().completed)
-        stalled_time = (now - tc->getStats().last_upload_activity_time) / 1000;
-    else
-        stalled_time = (now - tc->getStats().last_download_activity_time) / 1000;
+    const TorrentStats &s = tc->getStats();
+    return s.completed ? s.last_upload_activity_time : s.last_download_activity_time;
+}
 
+static bool IsStalled(bt::TorrentInterface *tc, bt::TimeStamp now, bt::Uint32 min_stall_time)
+{
+    bt::Int64 stalled_time = (now - LastActivity(tc)) / 1000;
     return stalled_time > min_stall_time * 60 && tc->getStats().running;
 }
 
+void QueueManager::watchStall(bt::TorrentInterface *tc, bt::TimeStamp deadline)
+{
+    // one second extra, IsStalled counts whole seconds
+    stall_wheel.schedule(tc, deadline + 1000);
+}
+
+void QueueManager::torrentStatusChanged(bt::TorrentInterface *tc)
+{
+    // make sure checkLowDiskSpace keeps an eye on the file system
+    const TorrentStats &s = tc->getStats();
+    if (s.running && !s.completed)
+        disk_space.mountPoint(s.output_path);
+
+    if (!stall_watching)
+        return;
+
+    if (!s.running) {
+        stall_wheel.cancel(tc);
+        stalled.remove(tc);
+    } else if (!stall_wheel.contains(tc) && !stalled.contains(tc)) {
+        watchStall(tc, LastActivity(tc) + bt::TimeStamp(stall_time) * 60 * 1000);
+    }
+}
+
 void QueueManager::checkStalledTorrents(bt::TimeStamp now, bt::Uint32 min_stall_time)
 {
     if (!enabled())
         return;
 
-    QueuePtrList newlist;
-    QueuePtrList stalled;
-    bool can_decrease = false;
+    const bt::TimeStamp stall_ms = bt::TimeStamp(min_stall_time) * 60 * 1000;
 
-    // find all stalled ones
-    for (bt::TorrentInterface *tc : std::as_const(downloads)) {
-        if (IsStalled(tc, now, min_stall_time)) {
-            stalled.append(tc);
+    // Start over when the stall time changed, or when we have not been checking for a while
+    // (option turned off, QM disabled), running torrents may have been missed in the meantime
+    if (!stall_watching || stall_time != min_stall_time || now - last_stall_check > STALL_CHECK_GAP) {
+        stall_watching = true;
+        stall_time = min_stall_time;
+        stall_wheel.reset(now);
+        stalled.clear();
+        for (bt::TorrentInterface *tc : std::as_const(downloads)) {
+            if (tc->getStats().running)
+                watchStall(tc, LastActivity(tc) + stall_ms);
+        }
+    }
+    last_stall_check = now;
+
+    // check the torrents whose time has come, the ones which had some activity
+    // in the meantime go back into the wheel, the stalled ones are checked again later
+    QueuePtrList fired_stalled;
+    stall_wheel.advance(now, [&](bt::TorrentInterface *tc) {
+        if (!tc->getStats().running) {
+            stalled.remove(tc);
+        } else if (IsStalled(tc, now, min_stall_time)) {
+            stalled.insert(tc);
+            fired_stalled.append(tc);
+            watchStall(tc, now + stall_ms);
         } else {
-            // decreasing makes only sense if there are QM torrents after the stalled ones
-            can_decrease = stalled.count() > 0;
-            newlist.append(tc);
+            stalled.remove(tc);
+            watchStall(tc, LastActivity(tc) + stall_ms);
         }
+    });
+
+    if (fired_stalled.isEmpty())
+        return;
+
+    syncQueue();
+
+    // find the last torrent which is not stalled, decreasing only makes sense for stalled torrents before it
+    auto last = queue.rbegin();
+    while (last != queue.rend() && stalled.contains(last->second))
+        last++;
+    if (last == queue.rend())
+        return;
+
+    const QueueKey last_key = last->first;
+    std::map<QueueKey, bt::TorrentInterface *> to_move;
+    for (bt::TorrentInterface *tc : std::as_const(fired_stalled)) {
+        const QueueKey key = queue_keys.value(tc);
+        if (key < last_key)
+            to_move.insert(std::make_pair(key, tc));
     }
 
-    if (stalled.count() == 0 || stalled.count() == downloads.count() || !can_decrease)
+    if (to_move.empty())
         return;
 
-    for (bt::TorrentInterface *tc : std::as_const(stalled))
-        Out(SYS_GEN | LOG_NOTICE) << "The torrent " << tc->getStats().torrent_name << " has stalled longer than " << min_stall_time
+    for (const auto &i : to_move)
+        Out(SYS_GEN | LOG_NOTICE) << "The torrent " << i.second->getStats().torrent_name << " has stalled longer than " << min_stall_time
                                   << " minutes, decreasing its priority" << endl;
 
-    downloads.clear();
-    downloads += newlist;
-    downloads += stalled;
-    // redo priorities and then order the queue
-    int prio = downloads.count();
-    for (bt::TorrentInterface *tc : std::as_const(downloads)) {
-        tc->setPriority(prio--);
-    }
+    // move the stalled torrents below the others, keeping their order, nobody else changes
+    int lowest = queue.rbegin()->first.priority;
+    for (const auto &i : to_move)
+        setPriority(i.second, --lowest);
+
+    renormalizePriorities();
     orderQueue();
 }
 
@@ -798,10 +1247,11 @@ void QueueManager::onOnlineStateChanged(bool isOnline)
 
 void QueueManager::reindexQueue()
 {
+    syncQueue();
     int prio = downloads.count();
     // make sure everybody has a unique priority
     for (bt::TorrentInterface *tc : std::as_const(downloads)) {
-        tc->setPriority(prio--);
+        setPriority(tc, prio--);
     }
 }
 
@@ -833,32 +1283,110 @@ void QueueManager::saveState(KSharedConfigPtr cfg)
     }
 }
 
-bool QueueManager::checkFileConflicts(TorrentInterface *tc, QStringList &conflicting) const
+static QStringList FilesOnDisk(bt::TorrentInterface *tc)
 {
-    conflicting.clear();
-
-    // First get a set off all files of tc
-    QSet<QString> files;
+    QStringList files;
     if (tc->getStats().multi_file_torrent) {
+        files.reserve(tc->getNumFiles());
         for (bt::Uint32 i = 0; i < tc->getNumFiles(); i++)
-            files.insert(tc->getTorrentFile(i).getPathOnDisk());
+            files.append(tc->getTorrentFile(i).getPathOnDisk());
     } else
-        files.insert(tc->getStats().output_path);
+        files.append(tc->getStats().output_path);
 
-    for (bt::TorrentInterface *t : std::as_const(downloads)) {
-        if (t == tc)
-            continue;
+    return files;
+}
 
-        if (t->getStats().multi_file_torrent) {
-            for (bt::Uint32 i = 0; i < t->getNumFiles(); i++) {
-                if (files.contains(t->getTorrentFile(i).getPathOnDisk())) {
-                    conflicting.append(t->getDisplayName());
-                    break;
-                }
-            }
-        } else {
-            if (files.contains(t->getStats().output_path))
-                conflicting.append(t->getDisplayName());
+static QString FileOnDisk(bt::TorrentInterface *tc, bt::Uint32 file)
+{
+    return tc->getStats().multi_file_torrent ? tc->getTorrentFile(file).getPathOnDisk() : tc->getStats().output_path;
+}
+
+void QueueManager::indexFiles(bt::TorrentInterface *tc) const
+{
+    unindexFiles(tc);
+
+    IndexedFiles &indexed = indexed_files[tc];
+    indexed.output_path = tc->getStats().output_path;
+    const QStringList files = FilesOnDisk(tc);
+    indexed.hashes.reserve(files.size());
+    for (const QString &path : files) {
+        const size_t h = qHash(path);
+        file_index.insert(h, {tc, bt::Uint32(indexed.hashes.size())});
+        indexed.hashes.append(h);
+    }
+}
+
+void QueueManager::unindexFiles(bt::TorrentInterface *tc) const
+{
+    stale_files.remove(tc);
+    auto i = indexed_files.find(tc);
+    if (i == indexed_files.end())
+        return;
+
+    const QList<size_t> &hashes = i.value().hashes;
+    for (qsizetype file = 0; file < hashes.size(); file++)
+        file_index.remove(hashes[file], {tc, bt::Uint32(file)});
+    indexed_files.erase(i);
+}
+
+void QueueManager::filesChanged(bt::TorrentInterface *tc)
+{
+    // Only reindex the next time the index is used
+    if (!indexed_files.contains(tc))
+        return;
+
+    stale_files.insert(tc);
+    if (!tc->getJobQueue()->runningJobs() || moving_files.contains(tc))
+        return;
+
+    // Moves happen in a job, until it is done the files keep their old paths
+    moving_files.insert(tc);
+    connect(
+        tc,
+        &bt::TorrentInterface::runningJobsDone,
+        this,
+        [this](bt::TorrentInterface *moved) {
+            if (moving_files.remove(moved))
+                stale_files.insert(moved);
+        },
+        Qt::SingleShotConnection);
+}
+
+void QueueManager::updateFileIndex() const
+{
+    // Moving the data of a torrent changes its output path, that is cheap to check for every
+    // torrent, unlike their files. Renames and moves of single files are flagged by filesChanged.
+    for (auto i = indexed_files.cbegin(); i != indexed_files.cend(); i++) {
+        if (i.value().output_path != i.key()->getStats().output_path)
+            stale_files.insert(i.key());
+    }
+
+    // Torrents whose files are being moved are reindexed once the move job is done
+    const QSet<bt::TorrentInterface *> stale = stale_files;
+    for (bt::TorrentInterface *tc : stale) {
+        if (!moving_files.contains(tc))
+            indexFiles(tc);
+    }
+}
+
+bool QueueManager::checkFileConflicts(TorrentInterface *tc, QStringList &conflicting) const
+{
+    conflicting.clear();
+    updateFileIndex();
+
+    // Look up all files of tc, this does not depend on the number of files of the other torrents.
+    // The index only has hashes, so a hit is checked against the path of the file it points to.
+    QSet<bt::TorrentInterface *> found;
+    const QStringList files = FilesOnDisk(tc);
+    for (const QString &path : files) {
+        const size_t h = qHash(path);
+        for (auto i = file_index.constFind(h); i != file_index.cend() && i.key() == h; i++) {
+            bt::TorrentInterface *other = i.value().tc;
+            if (other == tc || found.contains(other) || FileOnDisk(other, i.value().file) != path)
+                continue;
+
+            found.insert(other);
+            conflicting.append(other->getDisplayName());
         }
     }
 
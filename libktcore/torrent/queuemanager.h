@@ -6,24 +6,35 @@
 #ifndef KTQUEUEMANAGER_H
 #define KTQUEUEMANAGER_H
 
+#include <map>
 #include <set>
 
 #include <KSharedConfig>
+#include <QHash>
+#include <QMultiHash>
 #include <QObject>
+#include <QSet>
+#include <QTimer>
 
 #include <interfaces/queuemanagerinterface.h>
 #include <interfaces/torrentinterface.h>
 #include <ktcore_export.h>
+#include <torrent/queuelimitcontroller.h>
+#include <torrent/statssyncscheduler.h>
+#include <util/diskspacecache.h>
+#include <util/sha1hash.h>
+#include <util/timerwheel.h>
 
 namespace bt
 {
-class SHA1Hash;
 struct TrackerTier;
 class WaitJob;
 }
 
 namespace kt
 {
+struct CurrentStats;
+
 class KTCORE_EXPORT QueuePtrList : public QList<bt::TorrentInterface *>
 {
 public:
@@ -68,12 +79,23 @@ public:
     void loadState(KSharedConfigPtr cfg);
 
     /**
-     * Check if we need to decrease the priority of stalled torrents
+     * Check if we need to decrease the priority of stalled torrents.
+     * Running torrents are kept in a timer wheel with the time at which they
+     * would have stalled, so only the torrents whose time has come are checked.
      * @param min_stall_time Stall time in minutes
      * @param now The current time
      */
     void checkStalledTorrents(bt::TimeStamp now, bt::Uint32 min_stall_time);
 
+    /**
+     * Stop downloads on file systems which are predicted to run out of space
+     * within the configured time, before they actually do. The free space is
+     * only queried once per file system every few seconds. Nothing is stopped
+     * when downloads are forced to start on low disk space.
+     * @param now The current time
+     */
+    void checkLowDiskSpace(bt::TimeStamp now);
+
     /**
      * Start a torrent
      * @param tc The torrent
@@ -146,6 +168,23 @@ public:
     */
     void startAutoStartTorrents();
 
+    /**
+     * Start ramping up torrents instead of starting them all at once. Until
+     * every torrent which needs to run has been started, torrents are started
+     * in batches, highest priority first. A new batch is only started when
+     * the number of torrents which are still announcing or checking their
+     * data is below the configured limits, and the time between batches
+     * follows the time the previous batch took to start. Used when KTorrent
+     * starts.
+     */
+    void beginStartup();
+
+    /// Are torrents still being ramped up after beginStartup
+    bool startingUp() const
+    {
+        return startup_active;
+    }
+
     typedef QList<bt::TorrentInterface *>::iterator iterator;
     typedef QList<bt::TorrentInterface *>::const_iterator const_iterator;
 
@@ -176,6 +215,13 @@ public:
      */
     bool alreadyLoaded(const bt::SHA1Hash &ih) const override;
 
+    /**
+     * Find a torrent by info hash.
+     * @param ih The info hash of a torrent
+     * @return The torrent or nullptr if it isn't loaded
+     */
+    bt::TorrentInterface *find(const bt::SHA1Hash &ih) const;
+
     /**
      * Merge announce lists to a torrent
      * @param ih The info_hash of the torrent to merge to
@@ -193,6 +239,13 @@ public:
 
     bool permitStatsSync(bt::TorrentControl *tc) override;
 
+    /**
+     * Set how long the stats of a torrent may stay unsaved
+     * @param minutes The durability window in minutes
+     * @param max_per_tick Maximum number of stats files written in one update, 0 means no limit
+     */
+    void setStatsSyncWindow(int minutes, int max_per_tick);
+
     /**
      * Set the maximum number of downloads
      * @param m Max downloads
@@ -205,6 +258,29 @@ public:
      */
     void setMaxSeeds(int m);
 
+    /**
+     * Enable or disable adaptive queue limits. When enabled, the maximum number
+     * of downloads and seeds are adjusted to the speed limits by adaptLimits,
+     * the configured maximums are the upper bounds. Without a download or
+     * upload speed limit, the configured maximum of downloads or seeds applies.
+     * @param on true to enable
+     */
+    void setAdaptiveLimits(bool on);
+
+    /// Is it time to call adaptLimits again
+    bool adaptLimitsDue(bt::TimeStamp now) const
+    {
+        return adaptive_limits && now - last_limits_update >= ADAPT_LIMITS_INTERVAL;
+    }
+
+    /**
+     * Adjust the maximum number of downloads and seeds to the total download
+     * and upload speed, when adaptive queue limits are enabled.
+     * @param stats The current stats of all torrents
+     * @param now The current time
+     */
+    void adaptLimits(const CurrentStats &stats, bt::TimeStamp now);
+
     /**
      * Enable or disable keep seeding (after a torrent has finished)
      * @param ks Keep seeding
@@ -228,6 +304,18 @@ public:
      */
     void reindexQueue();
 
+    /**
+     * Change the priority of a torrent. The queue is kept in order, without
+     * sorting it again. Priorities must be changed through this, a priority
+     * set directly on a torrent is only picked up when it emits updateQueue.
+     * @param tc The torrent
+     * @param priority The new priority
+     */
+    void setPriority(bt::TorrentInterface *tc, int priority);
+
+    /// Get the highest priority of all torrents, 0 if there are none
+    int highestPriority() const;
+
     /**
      * Check if a torrent has file conflicts with other torrents.
      * If conflicting are found, a list of names of the conflicting torrents is filled in.
@@ -236,6 +324,16 @@ public:
      */
     bool checkFileConflicts(bt::TorrentInterface *tc, QStringList &conflicting) const;
 
+    /**
+     * The files of a torrent have been renamed or moved, so its entries in the
+     * index used by checkFileConflicts need to be updated. Files are moved by
+     * a job, so the torrent is reindexed when its running jobs are done,
+     * whether the move succeeded or not. Moving all data of a torrent
+     * (changing its output path) is detected automatically.
+     * @param tc The torrent
+     */
+    void filesChanged(bt::TorrentInterface *tc);
+
     /**
      * Places all torrents from downloads in the right order in queue.
      * Use this when torrent priorities get changed
@@ -280,28 +378,107 @@ public Q_SLOTS:
     void onLowDiskSpace(bt::TorrentInterface *tc, bool toStop);
     void onOnlineStateChanged(bool);
 
+private Q_SLOTS:
+    void torrentStatusChanged(bt::TorrentInterface *tc);
+
 private:
     void startSafely(bt::TorrentInterface *tc);
     void stopSafely(bt::TorrentInterface *tc, bt::WaitJob *wjob = nullptr);
     void checkDiskSpace(QList<bt::TorrentInterface *> &todo);
     void checkMaxSeedTime(QList<bt::TorrentInterface *> &todo);
     void checkMaxRatio(QList<bt::TorrentInterface *> &todo);
-    void rearrangeQueue();
+    void insertIntoQueue(bt::TorrentInterface *tc);
+    void removeFromQueue(bt::TorrentInterface *tc);
+    void syncQueue();
+    void renormalizePriorities();
+    qsizetype downloadIndex(bt::TorrentInterface *tc) const;
+    void indexFiles(bt::TorrentInterface *tc) const;
+    void unindexFiles(bt::TorrentInterface *tc) const;
+    void updateFileIndex() const;
+    void enqueueStartup(bt::TorrentInterface *tc);
+    void startupStep();
+    void endStartup();
+    void watchStall(bt::TorrentInterface *tc, bt::TimeStamp deadline);
+    bool enoughDiskSpace(bt::TorrentInterface *tc);
     bt::TorrentStartResponse startInternal(bt::TorrentInterface *tc);
     bool checkLimits(bt::TorrentInterface *tc, bool interactive);
     bool checkDiskSpace(bt::TorrentInterface *tc, bool interactive);
 
+    int downloadLimit() const;
+    int seedLimit() const;
+
 private:
-    QueuePtrList downloads;
+    static const bt::TimeStamp ADAPT_LIMITS_INTERVAL = 5000;
+
+    /// Position in the queue, highest priority first, ties are broken by the order torrents were added in
+    struct QueueKey {
+        int priority;
+        bt::Uint64 seq;
+
+        bool operator<(const QueueKey &k) const
+        {
+            return priority > k.priority || (priority == k.priority && seq < k.seq);
+        }
+    };
+
+    QueuePtrList downloads; // in queue order after syncQueue
+    std::map<QueueKey, bt::TorrentInterface *> queue;
+    QHash<bt::TorrentInterface *, QueueKey> queue_keys;
+    bt::Uint64 queue_seq;
+    bool queue_changed; // downloads is not in queue order anymore
+
+    /// Hashes of the paths on disk of the files of a torrent, as they were put in the file index
+    struct IndexedFiles {
+        QString output_path;
+        QList<size_t> hashes;
+    };
+
+    /// A file of a torrent in the file index
+    struct IndexedFile {
+        bt::TorrentInterface *tc;
+        bt::Uint32 file; // index of the file in the torrent
+
+        bool operator==(const IndexedFile &f) const
+        {
+            return tc == f.tc && file == f.file;
+        }
+    };
+
+    // index of the files of all torrents for checkFileConflicts, brought up to date when it is used,
+    // only the hashes of the paths are kept, a hit is checked against the one file it points to
+    mutable QMultiHash<size_t, IndexedFile> file_index;
+    mutable QHash<bt::TorrentInterface *, IndexedFiles> indexed_files;
+    mutable QSet<bt::TorrentInterface *> stale_files;
+    mutable QSet<bt::TorrentInterface *> moving_files; // flagged by filesChanged, reindexed once their move job is done
+
+    bool startup_active;
+    QueuePtrList startup_pending; // torrents waiting to be started, highest priority first
+    QSet<bt::TorrentInterface *> startup_queued; // the torrents in startup_pending which are still waiting, removed ones are skipped
+    QHash<bt::TorrentInterface *, bt::TimeStamp> startup_in_flight; // started, but still busy, with the time they were started
+    QTimer startup_timer;
+    bt::TimeStamp startup_begin;
+    int startup_started;
+
+    TimerWheel<bt::TorrentInterface *> stall_wheel; // running torrents, at the time they would have stalled
+    QSet<bt::TorrentInterface *> stalled; // running torrents which were stalled when they were last checked
+    bool stall_watching; // stall_wheel is up to date
+    bt::Uint32 stall_time;
+    bt::TimeStamp last_stall_check;
+    QHash<bt::SHA1Hash, bt::TorrentInterface *> info_hash_index; // all torrents in downloads, by info hash
     std::set<bt::TorrentInterface *> suspended_torrents;
     int max_downloads;
     int max_seeds;
+    bool adaptive_limits;
+    QueueLimitController download_limit;
+    QueueLimitController seed_limit;
+    bt::TimeStamp last_limits_update;
     bool suspended_state;
     bool keep_seeding;
     bool exiting;
     bool ordering;
     QDateTime network_down_time;
-    bt::TimeStamp last_stats_sync_permitted;
+    StatsSyncScheduler stats_sync;
+    DiskSpaceCache disk_space; // free space of the file systems torrents are downloading to
 };
 }
 #endif
@@ -0,0 +1,78 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "statssyncscheduler.h"
+
+#include <util/log.h>
+
+using namespace bt;
+
+namespace kt
+{
+StatsSyncScheduler::StatsSyncScheduler()
+    : window(50 * 60 * 1000)
+    , period(5 * 60 * 1000)
+    , max_per_tick(0)
+    , tick(0)
+    , next_flush(0)
+    , in_flush(false)
+    , tick_had_due(false)
+    , tick_writes(0)
+    , flush_writes(0)
+    , num_flushes(0)
+    , num_writes(0)
+{
+}
+
+void StatsSyncScheduler::setWindow(TimeStamp window, Uint32 flushes)
+{
+    if (flushes == 0)
+        flushes = 1;
+
+    this->window = window;
+    period = window / flushes;
+    if (next_flush > tick + period)
+        next_flush = tick + period;
+}
+
+void StatsSyncScheduler::nextTick(TimeStamp now)
+{
+    if (in_flush && !tick_had_due) {
+        Out(SYS_GEN | LOG_DEBUG) << "Saved the stats of " << flush_writes << " torrents" << endl;
+        in_flush = false;
+    }
+
+    if (!in_flush && now >= next_flush) {
+        in_flush = true;
+        flush_writes = 0;
+        num_flushes++;
+        next_flush = now + period;
+    }
+
+    tick = now;
+    tick_had_due = false;
+    tick_writes = 0;
+}
+
+bool StatsSyncScheduler::permit(TimeStamp now, TimeStamp since_last_sync)
+{
+    if (now != tick)
+        nextTick(now);
+
+    // Write it in this flush if it would be older than the window at the next one
+    if (since_last_sync + period < window)
+        return false;
+
+    tick_had_due = true;
+    if (!in_flush || (max_per_tick > 0 && tick_writes >= max_per_tick))
+        return false;
+
+    tick_writes++;
+    flush_writes++;
+    num_writes++;
+    return true;
+}
+
+}
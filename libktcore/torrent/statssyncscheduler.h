@@ -0,0 +1,95 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_STATSSYNCSCHEDULER_H
+#define KT_STATSSYNCSCHEDULER_H
+
+#include <ktcore_export.h>
+#include <util/constants.h>
+
+namespace kt
+{
+/**
+ * @brief Decides when torrents may write their stats file
+ *
+ * Every torrent asks for permission to save its stats during its update.
+ * Instead of letting them write one at a time, spread out over the whole
+ * period, the writes are grouped: every flush period a flush is started,
+ * and during a flush all torrents which are due get permission, up to a
+ * maximum number per update tick. The flush ends at the first tick in which
+ * no torrent was due anymore.
+ *
+ * A torrent is due when its stats would otherwise become older than the
+ * durability window before the next flush. So no stats file on disk is
+ * older than the window (unless the per tick limit keeps them waiting),
+ * and the disk only gets woken up once per flush period.
+ *
+ * Update ticks are recognized by the time passed to permit, which is the
+ * time of the current tick (bt::CurrentTime).
+ */
+class KTCORE_EXPORT StatsSyncScheduler
+{
+public:
+    StatsSyncScheduler();
+
+    /**
+     * Set the durability window.
+     * @param window Maximum age of the stats on disk in ms
+     * @param flushes Number of flushes per window
+     */
+    void setWindow(bt::TimeStamp window, bt::Uint32 flushes);
+
+    /// Set the maximum number of writes in one update tick, 0 means no limit
+    void setMaxPerTick(bt::Uint32 max)
+    {
+        max_per_tick = max;
+    }
+
+    /**
+     * Ask for permission to write the stats of a torrent.
+     * @param now The time of the current update tick
+     * @param since_last_sync Time since the stats of the torrent were written
+     * @return true if the torrent may write its stats now
+     */
+    bool permit(bt::TimeStamp now, bt::TimeStamp since_last_sync);
+
+    /// Is a flush going on
+    bool flushing() const
+    {
+        return in_flush;
+    }
+
+    /// Number of flushes done so far
+    bt::Uint64 numFlushes() const
+    {
+        return num_flushes;
+    }
+
+    /// Number of writes permitted so far
+    bt::Uint64 numWrites() const
+    {
+        return num_writes;
+    }
+
+private:
+    void nextTick(bt::TimeStamp now);
+
+private:
+    bt::TimeStamp window;
+    bt::TimeStamp period;
+    bt::Uint32 max_per_tick;
+    bt::TimeStamp tick;
+    bt::TimeStamp next_flush;
+    bool in_flush;
+    bool tick_had_due;
+    bt::Uint32 tick_writes;
+    bt::Uint32 flush_writes;
+    bt::Uint64 num_flushes;
+    bt::Uint64 num_writes;
+};
+
+}
+
+#endif
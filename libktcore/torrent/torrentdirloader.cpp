@@ -0,0 +1,118 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "torrentdirloader.h"
+
+#include <algorithm>
+
+#include <QFile>
+#include <QThread>
+
+#include <util/error.h>
+#include <util/fileops.h>
+#include <util/tracer.h>
+
+using namespace bt;
+
+namespace kt
+{
+// Time between two checks for finished items when the next one is not ready yet
+static const int POLL_INTERVAL = 10;
+
+// Reading files is mostly waiting for the disk, a few threads are enough
+static const int MAX_THREADS = 8;
+
+// Files TorrentControl::init reads besides the torrent file
+static const char *const PREFETCH_FILES[] = {"stats"};
+
+TorrentDirLoader::TorrentDirLoader(const QStringList &dirs, int batch_size, QObject *parent)
+    : QObject(parent)
+    , items(dirs.count())
+    , ready(new std::atomic<bool>[dirs.count()])
+    , next(0)
+    , abort(false)
+    , batch_size(std::max(1, batch_size))
+    , delivered(0)
+{
+    for (int i = 0; i < dirs.count(); i++) {
+        items[i].dir = dirs[i];
+        ready[i] = false;
+    }
+
+    pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), MAX_THREADS));
+    timer.setSingleShot(true);
+    connect(&timer, &QTimer::timeout, this, &TorrentDirLoader::deliver);
+}
+
+TorrentDirLoader::~TorrentDirLoader()
+{
+    abort = true;
+    pool.waitForDone();
+}
+
+void TorrentDirLoader::start()
+{
+    const int num_workers = std::min(pool.maxThreadCount(), total());
+    for (int i = 0; i < num_workers; i++)
+        pool.start([this]() {
+            work();
+        });
+
+    timer.start(0);
+}
+
+void TorrentDirLoader::work()
+{
+    while (!abort) {
+        const int i = next.fetch_add(1);
+        if (i >= total())
+            return;
+
+        KT_TRACE_SCOPE("loader", "TorrentDirLoader::read");
+        Item &item = items[i];
+        const QString file = item.dir + QLatin1String("torrent");
+        if (bt::Exists(file)) {
+            try {
+                item.data = bt::LoadFile(file);
+            } catch (bt::Error &err) {
+                item.error = err.toString();
+            }
+
+            for (const char *name : PREFETCH_FILES) {
+                QFile f(item.dir + QLatin1String(name));
+                if (f.open(QIODevice::ReadOnly))
+                    f.readAll();
+            }
+        }
+
+        ready[i].store(true, std::memory_order_release);
+    }
+}
+
+void TorrentDirLoader::deliver()
+{
+    QList<Item> batch;
+    while (delivered < total() && batch.count() < batch_size && ready[delivered].load(std::memory_order_acquire)) {
+        batch.append(std::move(items[delivered]));
+        delivered++;
+    }
+
+    if (!batch.isEmpty()) {
+        Q_EMIT loaded(batch);
+        Q_EMIT progress(delivered, total());
+    }
+
+    if (delivered == total()) {
+        Q_EMIT finished();
+        return;
+    }
+
+    // a full batch means more is probably waiting, so go on right away
+    timer.start(batch.count() == batch_size ? 0 : POLL_INTERVAL);
+}
+
+}
+
+#include "moc_torrentdirloader.cpp"
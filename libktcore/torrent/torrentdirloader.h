@@ -0,0 +1,90 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_TORRENTDIRLOADER_H
+#define KT_TORRENTDIRLOADER_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <ktcore_export.h>
+
+namespace kt
+{
+/**
+ * @brief Reads the torrent directories of the existing torrents at startup
+ *
+ * The torrent files are read by a pool of worker threads, which also read
+ * the other small files of a torrent directory, so they are in the cache
+ * when TorrentControl::init needs them. The results are handed to the main
+ * thread in batches, in the order of the directories, so the event loop
+ * gets to run between two batches.
+ */
+class KTCORE_EXPORT TorrentDirLoader : public QObject
+{
+    Q_OBJECT
+public:
+    struct Item {
+        QString dir;
+        QByteArray data; // contents of the torrent file, empty if there is none
+        QString error; // set if the torrent file could not be read
+    };
+
+    /**
+     * Constructor
+     * @param dirs The torrent directories, ending with a directory separator
+     * @param batch_size Maximum number of items in one batch
+     * @param parent The parent
+     */
+    TorrentDirLoader(const QStringList &dirs, int batch_size, QObject *parent = nullptr);
+
+    /// Destructor, stops the workers if they are still busy
+    ~TorrentDirLoader() override;
+
+    /// Start reading
+    void start();
+
+    /// Get the number of directories
+    int total() const
+    {
+        return int(items.size());
+    }
+
+Q_SIGNALS:
+    /// A batch of directories has been read
+    void loaded(const QList<kt::TorrentDirLoader::Item> &batch);
+
+    /// Progress, emitted after every batch
+    void progress(int done, int total);
+
+    /// All directories have been read and handed over
+    void finished();
+
+private:
+    void work();
+    void deliver();
+
+private:
+    std::vector<Item> items;
+    std::unique_ptr<std::atomic<bool>[]> ready;
+    std::atomic<int> next;
+    std::atomic<bool> abort;
+    int batch_size;
+    int delivered;
+    QThreadPool pool;
+    QTimer timer;
+};
+
+}
+
+#endif
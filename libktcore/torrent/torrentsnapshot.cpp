@@ -0,0 +1,213 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "torrentsnapshot.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+#include <util/log.h>
+
+using namespace bt;
+
+namespace kt
+{
+static const int HASH_SIZE = 20;
+
+TorrentSnapshot::TorrentSnapshot()
+{
+}
+
+void TorrentSnapshot::clear()
+{
+    entries.clear();
+    index.clear();
+}
+
+void TorrentSnapshot::append(const Entry &e)
+{
+    index.insert(e.info_hash, entries.count());
+    entries.append(e);
+}
+
+const TorrentSnapshot::Entry *TorrentSnapshot::find(const QString &info_hash) const
+{
+    auto i = index.constFind(info_hash);
+    return i != index.cend() ? &entries.at(i.value()) : nullptr;
+}
+
+bool TorrentSnapshot::save(const QString &file) const
+{
+    QSaveFile fptr(file);
+    if (!fptr.open(QIODevice::WriteOnly)) {
+        Out(SYS_GEN | LOG_IMPORTANT) << "Failed to open " << file << " : " << fptr.errorString() << endl;
+        return false;
+    }
+
+    QDataStream out(&fptr);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    out << MAGIC << VERSION << (quint32)entries.count();
+
+    for (const Entry &e : entries) {
+        QByteArray hash = QByteArray::fromHex(e.info_hash.toLatin1());
+        hash.resize(HASH_SIZE, 0);
+        out.writeRawData(hash.constData(), HASH_SIZE);
+    }
+    for (const Entry &e : entries)
+        out << e.name;
+    for (const Entry &e : entries)
+        out << e.output_path;
+    for (const Entry &e : entries)
+        out << (quint64)e.total_bytes_to_download;
+    for (const Entry &e : entries)
+        out << (quint64)e.bytes_downloaded;
+    for (const Entry &e : entries)
+        out << (quint64)e.bytes_uploaded;
+    for (const Entry &e : entries)
+        out << (quint64)e.bytes_left;
+    for (const Entry &e : entries)
+        out << (quint8)e.status;
+    for (const Entry &e : entries)
+        out << (quint8)(e.completed ? 1 : 0);
+    for (const Entry &e : entries)
+        out << e.percentage;
+    for (const Entry &e : entries)
+        out << e.share_ratio;
+    for (const Entry &e : entries)
+        out << (qint32)e.priority;
+    for (const Entry &e : entries)
+        out << (qint64)e.time_added;
+
+    // Most torrents are in the same few groups, so store the paths only once
+    QStringList group_table;
+    QHash<QString, quint32> group_ids;
+    for (const Entry &e : entries) {
+        for (const QString &g : e.groups) {
+            if (!group_ids.contains(g)) {
+                group_ids.insert(g, group_table.count());
+                group_table.append(g);
+            }
+        }
+    }
+
+    out << group_table;
+    for (const Entry &e : entries) {
+        out << (quint32)e.groups.count();
+        for (const QString &g : e.groups)
+            out << group_ids.value(g);
+    }
+
+    if (out.status() != QDataStream::Ok || !fptr.commit()) {
+        Out(SYS_GEN | LOG_IMPORTANT) << "Failed to write " << file << " : " << fptr.errorString() << endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool TorrentSnapshot::load(const QString &file)
+{
+    clear();
+
+    QFile fptr(file);
+    if (!fptr.open(QIODevice::ReadOnly))
+        return false;
+
+    const QByteArray data = fptr.readAll();
+    QDataStream in(data);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 magic = 0, version = 0, num = 0;
+    in >> magic >> version >> num;
+    // Every row has at least its info hash, so the count can be checked against the size
+    if (in.status() != QDataStream::Ok || magic != MAGIC || version != VERSION || (qint64)num * HASH_SIZE > data.size()) {
+        Out(SYS_GEN | LOG_NOTICE) << "Ignoring invalid torrent snapshot " << file << endl;
+        return false;
+    }
+
+    QList<Entry> rows(num);
+    char hash[HASH_SIZE];
+    for (Entry &e : rows) {
+        if (in.readRawData(hash, HASH_SIZE) != HASH_SIZE)
+            break;
+        e.info_hash = QString::fromLatin1(QByteArray(hash, HASH_SIZE).toHex());
+    }
+    for (Entry &e : rows)
+        in >> e.name;
+    for (Entry &e : rows)
+        in >> e.output_path;
+
+    quint64 v = 0;
+    for (Entry &e : rows) {
+        in >> v;
+        e.total_bytes_to_download = v;
+    }
+    for (Entry &e : rows) {
+        in >> v;
+        e.bytes_downloaded = v;
+    }
+    for (Entry &e : rows) {
+        in >> v;
+        e.bytes_uploaded = v;
+    }
+    for (Entry &e : rows) {
+        in >> v;
+        e.bytes_left = v;
+    }
+
+    quint8 b = 0;
+    for (Entry &e : rows) {
+        in >> b;
+        e.status = (bt::TorrentStatus)b;
+    }
+    for (Entry &e : rows) {
+        in >> b;
+        e.completed = b != 0;
+    }
+    for (Entry &e : rows)
+        in >> e.percentage;
+    for (Entry &e : rows)
+        in >> e.share_ratio;
+
+    qint32 priority = 0;
+    for (Entry &e : rows) {
+        in >> priority;
+        e.priority = priority;
+    }
+
+    qint64 time_added = 0;
+    for (Entry &e : rows) {
+        in >> time_added;
+        e.time_added = time_added;
+    }
+
+    QStringList group_table;
+    in >> group_table;
+    for (Entry &e : rows) {
+        quint32 num_groups = 0;
+        in >> num_groups;
+        for (quint32 i = 0; i < num_groups && in.status() == QDataStream::Ok; i++) {
+            quint32 id = 0;
+            in >> id;
+            if (id >= (quint32)group_table.count()) {
+                in.setStatus(QDataStream::ReadCorruptData);
+                break;
+            }
+            e.groups.append(group_table.at(id));
+        }
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        Out(SYS_GEN | LOG_NOTICE) << "Ignoring corrupt torrent snapshot " << file << endl;
+        return false;
+    }
+
+    for (const Entry &e : std::as_const(rows))
+        append(e);
+    return true;
+}
+
+}
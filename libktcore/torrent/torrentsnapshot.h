@@ -0,0 +1,103 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_TORRENTSNAPSHOT_H
+#define KT_TORRENTSNAPSHOT_H
+
+#include <QHash>
+#include <QList>
+#include <QStringList>
+
+#include <ktcore_export.h>
+#include <torrent/torrentstats.h>
+#include <util/constants.h>
+
+namespace kt
+{
+/**
+ * @brief Summary of all torrents, used to fill the view at startup
+ *
+ * Contains the fields shown in the torrent view for every torrent, so the
+ * view can be filled before the torrents themselves have been loaded.
+ *
+ * On disk the table is stored by column: a header with the number of rows,
+ * followed by all values of the first column, then all values of the second
+ * column, and so on. Info hashes are stored as raw bytes, group paths as
+ * indexes in a table of the distinct paths.
+ */
+class KTCORE_EXPORT TorrentSnapshot
+{
+public:
+    static const bt::Uint32 MAGIC = 0x4B54534E; // KTSN
+    static const bt::Uint32 VERSION = 1;
+
+    struct Entry {
+        QString info_hash; // in hex, as returned by SHA1Hash::toString
+        QString name;
+        QString output_path;
+        bt::Uint64 total_bytes_to_download = 0;
+        bt::Uint64 bytes_downloaded = 0;
+        bt::Uint64 bytes_uploaded = 0;
+        bt::Uint64 bytes_left = 0;
+        bt::TorrentStatus status = bt::NOT_STARTED;
+        bool completed = false;
+        float percentage = 0.0f;
+        float share_ratio = 0.0f;
+        int priority = 0;
+        qint64 time_added = 0; // seconds since the epoch
+        QStringList groups; // paths of the groups the torrent is a member of
+    };
+
+    TorrentSnapshot();
+
+    /// Remove all entries
+    void clear();
+
+    /// Add an entry
+    void append(const Entry &e);
+
+    /// Get the number of entries
+    int count() const
+    {
+        return entries.count();
+    }
+
+    /// Is the snapshot empty
+    bool isEmpty() const
+    {
+        return entries.isEmpty();
+    }
+
+    /// Get an entry
+    const Entry &entry(int i) const
+    {
+        return entries.at(i);
+    }
+
+    /// Find the entry of a torrent, returns nullptr if there is none
+    const Entry *find(const QString &info_hash) const;
+
+    /**
+     * Write the snapshot to a file, the file is replaced atomically.
+     * @param file The file
+     * @return true upon success
+     */
+    bool save(const QString &file) const;
+
+    /**
+     * Load the snapshot from a file, replacing the current entries.
+     * @param file The file
+     * @return true upon success, false if the file is missing or corrupt (the snapshot will then be empty)
+     */
+    bool load(const QString &file);
+
+private:
+    QList<Entry> entries;
+    QHash<QString, int> index;
+};
+
+}
+
+#endif
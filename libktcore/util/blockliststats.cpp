@@ -0,0 +1,199 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "blockliststats.h"
+
+#include <algorithm>
+
+#include <QMutexLocker>
+
+using namespace bt;
+
+namespace kt
+{
+// All registered stats, the registry mutex is held while using them, so they cannot be deleted in the meantime
+static QMutex registry_mutex;
+static QList<BlockListStats *> registry;
+
+BlockListStats::BlockListStats(const QString &name)
+    : stats_name(name)
+    , lookups(0)
+    , hits(0)
+    , ring_head(0)
+    , ring_tail(0)
+{
+    for (Uint32 i = 0; i < LATENCY_BUCKETS; i++)
+        latency[i] = 0;
+    for (Uint32 i = 0; i < HIT_RING_SIZE; i++)
+        ring[i].seq = i;
+
+    QMutexLocker lock(&registry_mutex);
+    registry.append(this);
+}
+
+BlockListStats::~BlockListStats()
+{
+    QMutexLocker lock(&registry_mutex);
+    registry.removeAll(this);
+}
+
+void BlockListStats::addLatency(Uint64 nsecs)
+{
+    Uint32 bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && (Uint64(1) << bucket) <= nsecs)
+        bucket++;
+
+    latency[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void BlockListStats::addHit(const Uint128 &start, const Uint128 &end)
+{
+    hits.fetch_add(1, std::memory_order_relaxed);
+
+    // The ring only fills up if nobody reads the stats, fold it then, this is once in HIT_RING_SIZE hits
+    while (!pushHit(start, end)) {
+        QMutexLocker lock(&mutex);
+        foldHits();
+    }
+}
+
+bool BlockListStats::pushHit(const Uint128 &start, const Uint128 &end)
+{
+    Uint64 pos = ring_head.load(std::memory_order_relaxed);
+    HitSlot *slot;
+    while (true) {
+        slot = &ring[pos & (HIT_RING_SIZE - 1)];
+        const Uint64 seq = slot->seq.load(std::memory_order_acquire);
+        if (seq == pos) {
+            if (ring_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (seq < pos) {
+            return false; // full
+        } else {
+            pos = ring_head.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->start = start;
+    slot->end = end;
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+void BlockListStats::foldHits() const
+{
+    // Collect the hits first, the same ranges tend to be hit over and over,
+    // so the table only needs to be searched once for every distinct range
+    std::vector<HotRange> batch;
+    while (true) {
+        HitSlot &slot = ring[ring_tail & (HIT_RING_SIZE - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != ring_tail + 1)
+            break; // empty, or the hit is still being written, it will be folded next time
+
+        batch.push_back({slot.start, slot.end, 1});
+        slot.seq.store(ring_tail + HIT_RING_SIZE, std::memory_order_release);
+        ring_tail++;
+    }
+
+    std::sort(batch.begin(), batch.end(), [](const HotRange &a, const HotRange &b) {
+        return a.start < b.start || (a.start == b.start && a.end < b.end);
+    });
+
+    for (size_t i = 0; i < batch.size();) {
+        HotRange h = batch[i];
+        for (i++; i < batch.size() && batch[i].start == h.start && batch[i].end == h.end; i++)
+            h.hits++;
+
+        auto it = std::find_if(hot_ranges.begin(), hot_ranges.end(), [&h](const HotRange &r) {
+            return r.start == h.start && r.end == h.end;
+        });
+        if (it != hot_ranges.end()) {
+            it->hits += h.hits;
+        } else if (hot_ranges.size() < size_t(MAX_HOT_RANGES)) {
+            hot_ranges.push_back(h);
+        } else {
+            // Full, replace the range with the fewest hits and assume the new one had at most as many
+            // (space saving), so ranges which keep getting hit always work their way up
+            auto least = std::min_element(hot_ranges.begin(), hot_ranges.end(), [](const HotRange &a, const HotRange &b) {
+                return a.hits < b.hits;
+            });
+            least->start = h.start;
+            least->end = h.end;
+            least->hits += h.hits;
+        }
+    }
+}
+
+BlockListStats::Snapshot BlockListStats::snapshot(int max_hot_ranges) const
+{
+    Snapshot s;
+    s.name = stats_name;
+    s.lookups = lookups.load(std::memory_order_relaxed);
+    s.hits = hits.load(std::memory_order_relaxed);
+    for (Uint32 i = 0; i < LATENCY_BUCKETS; i++)
+        s.latency.append(latency[i].load(std::memory_order_relaxed));
+
+    std::vector<HotRange> ranges;
+    {
+        QMutexLocker lock(&mutex);
+        foldHits();
+        ranges = hot_ranges;
+    }
+
+    std::sort(ranges.begin(), ranges.end(), [](const HotRange &a, const HotRange &b) {
+        return a.hits > b.hits;
+    });
+    for (int i = 0; i < (int)ranges.size() && i < max_hot_ranges; i++)
+        s.hot_ranges.append(ranges[i]);
+
+    return s;
+}
+
+void BlockListStats::reset()
+{
+    lookups = 0;
+    hits = 0;
+    for (Uint32 i = 0; i < LATENCY_BUCKETS; i++)
+        latency[i] = 0;
+
+    QMutexLocker lock(&mutex);
+    foldHits();
+    hot_ranges.clear();
+}
+
+QStringList BlockListStats::names()
+{
+    QMutexLocker lock(&registry_mutex);
+    QStringList ret;
+    for (const BlockListStats *s : std::as_const(registry))
+        ret.append(s->name());
+    return ret;
+}
+
+bool BlockListStats::snapshot(const QString &name, int max_hot_ranges, Snapshot &snapshot)
+{
+    QMutexLocker lock(&registry_mutex);
+    for (const BlockListStats *s : std::as_const(registry)) {
+        if (s->name() == name) {
+            snapshot = s->snapshot(max_hot_ranges);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BlockListStats::reset(const QString &name)
+{
+    QMutexLocker lock(&registry_mutex);
+    for (BlockListStats *s : std::as_const(registry)) {
+        if (s->name() == name) {
+            s->reset();
+            return true;
+        }
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,162 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_BLOCKLISTSTATS_H
+#define KT_BLOCKLISTSTATS_H
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+#include <ktcore_export.h>
+#include <util/constants.h>
+#include <util/rangeindex.h>
+
+namespace kt
+{
+/**
+ * @brief Counters of a block list
+ *
+ * Counts the lookups and hits of a block list, measures the latency of one in
+ * every LATENCY_SAMPLE_INTERVAL lookups, and keeps track of the ranges with
+ * the most hits. Lookups only touch relaxed atomics. Hits are pushed on a
+ * lock free ring, which is folded into the hot range table when the counters
+ * are read, or when it is full, so only then the mutex is taken.
+ *
+ * Every instance registers itself under a name, so the counters of all block
+ * lists can be retrieved with snapshot (this is what DBusBlockLists does).
+ */
+class KTCORE_EXPORT BlockListStats
+{
+public:
+    /// One in this many lookups is timed, must be a power of two
+    static const bt::Uint32 LATENCY_SAMPLE_INTERVAL = 64;
+
+    /// Number of latency buckets, bucket i counts lookups which took less then 2^i nanoseconds
+    static const bt::Uint32 LATENCY_BUCKETS = 24;
+
+    /// Maximum number of ranges tracked for the hot range list
+    static const int MAX_HOT_RANGES = 256;
+
+    /// Number of hits buffered before they are folded into the hot range table, must be a power of two
+    static const bt::Uint32 HIT_RING_SIZE = 1024;
+
+    struct HotRange {
+        Uint128 start; // IPv4 ranges are stored as IPv4 mapped addresses
+        Uint128 end;
+        bt::Uint64 hits;
+    };
+
+    struct Snapshot {
+        QString name;
+        bt::Uint64 lookups;
+        bt::Uint64 hits;
+        QList<bt::Uint64> latency; // LATENCY_BUCKETS buckets
+        QList<HotRange> hot_ranges; // sorted on hits, most hits first
+    };
+
+    /**
+     * Times a lookup, if it is sampled.
+     * Usage: BlockListStats::Lookup lookup(stats); where stats may be nullptr.
+     */
+    class Lookup
+    {
+    public:
+        explicit Lookup(BlockListStats *stats)
+            : stats(stats && stats->startLookup() ? stats : nullptr)
+        {
+            if (this->stats)
+                start = std::chrono::steady_clock::now();
+        }
+
+        ~Lookup()
+        {
+            if (stats)
+                stats->addLatency(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        Lookup(const Lookup &) = delete;
+        Lookup &operator=(const Lookup &) = delete;
+
+    private:
+        BlockListStats *stats;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    explicit BlockListStats(const QString &name);
+    ~BlockListStats();
+
+    BlockListStats(const BlockListStats &) = delete;
+    BlockListStats &operator=(const BlockListStats &) = delete;
+
+    /// Get the name the stats are registered under
+    QString name() const
+    {
+        return stats_name;
+    }
+
+    /// Count a lookup, returns true if the latency of it should be measured
+    bool startLookup()
+    {
+        return (lookups.fetch_add(1, std::memory_order_relaxed) & (LATENCY_SAMPLE_INTERVAL - 1)) == 0;
+    }
+
+    /// Add the latency of a sampled lookup
+    void addLatency(bt::Uint64 nsecs);
+
+    /// Count a hit on a range
+    void addHit(const Uint128 &start, const Uint128 &end);
+
+    /// Get the current values of the counters
+    Snapshot snapshot(int max_hot_ranges) const;
+
+    /// Reset all counters
+    void reset();
+
+    /// Get the names of all registered block lists
+    static QStringList names();
+
+    /**
+     * Get the counters of a registered block list
+     * @param name The name of the block list
+     * @param max_hot_ranges Maximum number of hot ranges to return
+     * @param snapshot Filled in with the counters
+     * @return false if there is no block list with that name
+     */
+    static bool snapshot(const QString &name, int max_hot_ranges, Snapshot &snapshot);
+
+    /// Reset the counters of a registered block list, returns false if there is none with that name
+    static bool reset(const QString &name);
+
+private:
+    bool pushHit(const Uint128 &start, const Uint128 &end);
+    void foldHits() const;
+
+    /// Slot of the hit ring, seq tells whether it can be written or read (see Vyukov's bounded queue)
+    struct HitSlot {
+        std::atomic<bt::Uint64> seq;
+        Uint128 start;
+        Uint128 end;
+    };
+
+    QString stats_name;
+    alignas(64) std::atomic<bt::Uint64> lookups;
+    std::atomic<bt::Uint64> hits;
+    std::atomic<bt::Uint64> latency[LATENCY_BUCKETS];
+    alignas(64) std::atomic<bt::Uint64> ring_head;
+    mutable HitSlot ring[HIT_RING_SIZE];
+    mutable QMutex mutex;
+    mutable bt::Uint64 ring_tail; // protected by mutex
+    mutable std::vector<HotRange> hot_ranges; // protected by mutex
+};
+
+}
+
+#endif
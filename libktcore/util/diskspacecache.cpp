@@ -0,0 +1,132 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "diskspacecache.h"
+
+#include <QFileInfo>
+#include <QStorageInfo>
+
+using namespace bt;
+
+namespace kt
+{
+// Weight of a new sample in the fill rate
+static const double FILL_RATE_WEIGHT = 0.3;
+
+DiskSpaceCache::DiskSpaceCache(TimeStamp interval)
+    : interval(interval)
+{
+}
+
+DiskSpaceCache::~DiskSpaceCache()
+{
+}
+
+QString DiskSpaceCache::mountPoint(const QString &path)
+{
+    auto i = path_mounts.constFind(path);
+    if (i != path_mounts.constEnd())
+        return i.value();
+
+    // files and directories of torrents might not have been created yet, use the first parent which exists
+    QString p = path;
+    while (!QFileInfo::exists(p)) {
+        const QString parent = QFileInfo(p).path();
+        if (parent == p)
+            break;
+        p = parent;
+    }
+
+    const QString mount_point = queryMountPoint(p);
+    path_mounts.insert(path, mount_point);
+    if (!mount_point.isEmpty() && !mounts.contains(mount_point)) {
+        Mount m = {false, false, 0, 0, 0.0};
+        mounts.insert(mount_point, m);
+    }
+    return mount_point;
+}
+
+bool DiskSpaceCache::freeSpace(const QString &path, Uint64 &bytes, TimeStamp now)
+{
+    const QString mount_point = mountPoint(path);
+    auto i = mounts.find(mount_point);
+    if (i == mounts.end())
+        return false;
+
+    if (!i->valid || now - i->updated >= interval)
+        refresh(mount_point, *i, now);
+
+    bytes = i->free;
+    return i->valid;
+}
+
+bool DiskSpaceCache::update(TimeStamp now)
+{
+    bool refreshed = false;
+    for (auto i = mounts.begin(); i != mounts.end(); i++) {
+        if (!i->valid || now - i->updated >= interval) {
+            refresh(i.key(), *i, now);
+            refreshed = true;
+        }
+    }
+    return refreshed;
+}
+
+void DiskSpaceCache::refresh(const QString &mount_point, Mount &m, TimeStamp now)
+{
+    Uint64 free = 0;
+    if (!queryFreeSpace(mount_point, free)) {
+        m.valid = false;
+        m.has_rate = false;
+        m.updated = now;
+        return;
+    }
+
+    if (m.valid && now > m.updated) {
+        const double sample = (double(m.free) - double(free)) * 1000.0 / double(now - m.updated);
+        m.rate = m.has_rate ? (1.0 - FILL_RATE_WEIGHT) * m.rate + FILL_RATE_WEIGHT * sample : sample;
+        m.has_rate = true;
+    }
+
+    m.valid = true;
+    m.free = free;
+    m.updated = now;
+}
+
+double DiskSpaceCache::fillRate(const QString &mount_point) const
+{
+    auto i = mounts.constFind(mount_point);
+    return i != mounts.constEnd() && i->has_rate ? i->rate : 0.0;
+}
+
+double DiskSpaceCache::secondsUntilFull(const QString &mount_point, Uint64 reserve) const
+{
+    auto i = mounts.constFind(mount_point);
+    if (i == mounts.constEnd() || !i->valid || !i->has_rate || i->rate <= 0.0)
+        return -1.0;
+
+    if (i->free <= reserve)
+        return 0.0;
+
+    return double(i->free - reserve) / i->rate;
+}
+
+QString DiskSpaceCache::queryMountPoint(const QString &path) const
+{
+    QStorageInfo info(path);
+    return info.isValid() ? info.rootPath() : QString();
+}
+
+bool DiskSpaceCache::queryFreeSpace(const QString &mount_point, Uint64 &bytes) const
+{
+    QStorageInfo info(mount_point);
+    if (!info.isValid() || !info.isReady())
+        return false;
+
+    bytes = info.bytesAvailable();
+    return true;
+}
+
+}
@@ -0,0 +1,102 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_DISKSPACECACHE_H
+#define KT_DISKSPACECACHE_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include <ktcore_export.h>
+#include <util/constants.h>
+
+namespace kt
+{
+/**
+ * @brief Free disk space per file system
+ *
+ * Maps paths to the mount point of the file system they are on, and keeps
+ * the free space of every mount point, which is only queried again once the
+ * refresh interval has passed. So checking the free space for many torrents
+ * on the same disk costs one query per interval, instead of one per torrent.
+ *
+ * From the changes in free space between two refreshes, the rate at which a
+ * file system is filling up is estimated, so it can be predicted when it
+ * will be full.
+ */
+class KTCORE_EXPORT DiskSpaceCache
+{
+public:
+    /**
+     * Constructor
+     * @param interval Time in ms between two queries of the same mount point
+     */
+    explicit DiskSpaceCache(bt::TimeStamp interval = 5000);
+    virtual ~DiskSpaceCache();
+
+    /// Get the mount point of a path, the path does not need to exist yet
+    QString mountPoint(const QString &path);
+
+    /**
+     * Get the free space of the file system a path is on.
+     * @param path The path
+     * @param bytes Set to the number of bytes available
+     * @param now The current time
+     * @return false if the free space could not be determined
+     */
+    bool freeSpace(const QString &path, bt::Uint64 &bytes, bt::TimeStamp now);
+
+    /**
+     * Refresh the free space of all mount points whose interval has passed.
+     * @param now The current time
+     * @return true if at least one mount point was refreshed
+     */
+    bool update(bt::TimeStamp now);
+
+    /// Get all known mount points
+    QStringList mountPoints() const
+    {
+        return mounts.keys();
+    }
+
+    /// Get the rate at which a file system is filling up in bytes per second, negative if space is freed
+    double fillRate(const QString &mount_point) const;
+
+    /**
+     * Predict when a file system will be full.
+     * @param mount_point The mount point
+     * @param reserve Consider it full when less than this number of bytes is available
+     * @return The number of seconds until it is full, or -1 if it is not filling up
+     */
+    double secondsUntilFull(const QString &mount_point, bt::Uint64 reserve) const;
+
+protected:
+    /// Determine the mount point of an existing path
+    virtual QString queryMountPoint(const QString &path) const;
+
+    /// Query the number of bytes available on a file system
+    virtual bool queryFreeSpace(const QString &mount_point, bt::Uint64 &bytes) const;
+
+private:
+    struct Mount {
+        bool valid;
+        bool has_rate;
+        bt::Uint64 free;
+        bt::TimeStamp updated;
+        double rate;
+    };
+
+    void refresh(const QString &mount_point, Mount &m, bt::TimeStamp now);
+
+private:
+    bt::TimeStamp interval;
+    QHash<QString, QString> path_mounts;
+    QHash<QString, Mount> mounts;
+};
+
+}
+
+#endif
@@ -0,0 +1,327 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_RANGEINDEX_H
+#define KT_RANGEINDEX_H
+
+#include <vector>
+
+#include <QtAlgorithms>
+
+#include <util/constants.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KT_RANGEINDEX_SSE2
+#endif
+
+namespace kt
+{
+/**
+ * 128 bit unsigned number, used for IPv6 addresses.
+ */
+struct Uint128 {
+    bt::Uint64 hi;
+    bt::Uint64 lo;
+
+    /// Create from 16 bytes in network byte order (e.g. Q_IPV6ADDR)
+    static Uint128 fromBytes(const bt::Uint8 *bytes)
+    {
+        Uint128 r = {0, 0};
+        for (int i = 0; i < 8; i++) {
+            r.hi = (r.hi << 8) | bytes[i];
+            r.lo = (r.lo << 8) | bytes[i + 8];
+        }
+        return r;
+    }
+
+    /// Create the IPv4 mapped IPv6 address (::ffff:a.b.c.d) of an IPv4 address
+    static Uint128 fromIPv4(bt::Uint32 ip)
+    {
+        Uint128 r = {0, 0x0000FFFF00000000ULL | ip};
+        return r;
+    }
+
+    /// Is this an IPv4 mapped IPv6 address
+    bool isIPv4Mapped() const
+    {
+        return hi == 0 && (lo >> 32) == 0x0000FFFF;
+    }
+
+    bool operator<(const Uint128 &o) const
+    {
+        return hi < o.hi || (hi == o.hi && lo < o.lo);
+    }
+
+    bool operator<=(const Uint128 &o) const
+    {
+        return !(o < *this);
+    }
+
+    bool operator==(const Uint128 &o) const
+    {
+        return hi == o.hi && lo == o.lo;
+    }
+};
+
+/**
+ * Node of a RangeIndex, one cache line of range ends followed by one cache
+ * line of range starts. Nodes can be stored as is in a file.
+ */
+template<class Key, bt::Uint32 N>
+struct alignas(64) RangeIndexNodeT {
+    typedef Key KeyType;
+    static const bt::Uint32 KEYS = N;
+
+    Key ends[N];
+    Key starts[N];
+};
+
+/// Node for ranges of IPv4 addresses, 16 keys per node
+typedef RangeIndexNodeT<bt::Uint32, 16> RangeIndexNode;
+
+/// Node for ranges of IPv6 addresses, 4 keys per node
+typedef RangeIndexNodeT<Uint128, 4> RangeIndex6Node;
+
+static_assert(sizeof(RangeIndexNode) == 128, "RangeIndexNode must be two cache lines");
+static_assert(sizeof(RangeIndex6Node) == 128, "RangeIndex6Node must be two cache lines");
+
+/// Largest possible key, used for padding
+inline void RangeIndexMaxKey(bt::Uint32 &key)
+{
+    key = 0xFFFFFFFF;
+}
+
+inline void RangeIndexMaxKey(Uint128 &key)
+{
+    key.hi = key.lo = 0xFFFFFFFFFFFFFFFFULL;
+}
+
+/// Count the number of keys in a node which are smaller then v
+inline bt::Uint32 RangeIndexCountLess(const RangeIndexNode &node, bt::Uint32 v)
+{
+#ifdef KT_RANGEINDEX_SSE2
+    // SSE2 only has signed comparisons, so flip the sign bit of both sides
+    const __m128i bias = _mm_set1_epi32(0x80000000);
+    const __m128i x = _mm_xor_si128(_mm_set1_epi32(v), bias);
+    const __m128i *k = reinterpret_cast<const __m128i *>(node.ends);
+    __m128i a = _mm_cmplt_epi32(_mm_xor_si128(_mm_load_si128(k), bias), x);
+    __m128i b = _mm_cmplt_epi32(_mm_xor_si128(_mm_load_si128(k + 1), bias), x);
+    __m128i c = _mm_cmplt_epi32(_mm_xor_si128(_mm_load_si128(k + 2), bias), x);
+    __m128i d = _mm_cmplt_epi32(_mm_xor_si128(_mm_load_si128(k + 3), bias), x);
+    // Pack the 16 comparison results into 16 bytes, and count the set bits
+    __m128i packed = _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+    return qPopulationCount(static_cast<quint32>(_mm_movemask_epi8(packed)));
+#else
+    bt::Uint32 n = 0;
+    for (bt::Uint32 i = 0; i < RangeIndexNode::KEYS; i++)
+        n += node.ends[i] < v ? 1 : 0;
+    return n;
+#endif
+}
+
+inline bt::Uint32 RangeIndexCountLess(const RangeIndex6Node &node, const Uint128 &v)
+{
+    bt::Uint32 n = 0;
+    for (bt::Uint32 i = 0; i < RangeIndex6Node::KEYS; i++)
+        n += node.ends[i] < v ? 1 : 0;
+    return n;
+}
+
+/**
+ * @brief Search index for a sorted list of disjoint ranges
+ *
+ * The ranges are stored in an implicit B-tree (an S-tree): every node holds
+ * KEYS range ends, and the children of node k are nodes k * (KEYS + 1) + 1 up
+ * to k * (KEYS + 1) + KEYS + 1. A lookup touches one cache line per level
+ * instead of one per comparison, and the 16 keys of an IPv4 node are compared
+ * with SIMD instructions where available.
+ *
+ * The nodes can either be owned by the index, or live somewhere else, for
+ * example in a memory mapped file.
+ */
+template<class Node>
+class RangeIndexT
+{
+public:
+    typedef typename Node::KeyType Key;
+
+    RangeIndexT()
+        : nodes(nullptr)
+        , num_nodes(0)
+        , num_ranges(0)
+        , max_end()
+    {
+    }
+
+    RangeIndexT(const RangeIndexT &) = delete;
+    RangeIndexT &operator=(const RangeIndexT &) = delete;
+
+    /// Value returned by find when no range contains the value
+    static const bt::Uint32 NOT_FOUND = 0xFFFFFFFF;
+
+    /// Get the number of nodes needed to index num_ranges ranges
+    static bt::Uint32 numNodes(bt::Uint32 num_ranges)
+    {
+        return (num_ranges + Node::KEYS - 1) / Node::KEYS;
+    }
+
+    /**
+     * Build the nodes of an index.
+     * @param nodes Array of numNodes(num_ranges) nodes to fill in
+     * @param num_ranges The number of ranges
+     * @param get Functor get(i, start, end) returning range i, ranges must be sorted and disjoint
+     * @return The end of the last range
+     */
+    template<class GetRange>
+    static Key build(Node *nodes, bt::Uint32 num_ranges, GetRange get)
+    {
+        return build(nodes, num_ranges, get, [](bt::Uint32, bt::Uint32) {});
+    }
+
+    /**
+     * Build the nodes of an index, and report where each range ends up.
+     * @param nodes Array of numNodes(num_ranges) nodes to fill in
+     * @param num_ranges The number of ranges
+     * @param get Functor get(i, start, end) returning range i, ranges must be sorted and disjoint
+     * @param placed Functor placed(i, slot) called with the slot find will return for range i
+     * @return The end of the last range
+     */
+    template<class GetRange, class Placed>
+    static Key build(Node *nodes, bt::Uint32 num_ranges, GetRange get, Placed placed)
+    {
+        bt::Uint32 next = 0;
+        Key max_end = Key();
+        fill(nodes, numNodes(num_ranges), 0, num_ranges, next, max_end, get, placed);
+        return max_end;
+    }
+
+    /**
+     * Build an index which owns its nodes.
+     * @param num_ranges The number of ranges
+     * @param get Functor get(i, start, end) returning range i, ranges must be sorted and disjoint
+     */
+    template<class GetRange>
+    void build(bt::Uint32 num_ranges, GetRange get)
+    {
+        std::vector<Node> tmp(numNodes(num_ranges));
+        Key end = build(tmp.data(), num_ranges, get);
+        owned_nodes.swap(tmp);
+        setNodes(owned_nodes.data(), num_ranges, end);
+    }
+
+    /**
+     * Use nodes which are stored somewhere else, they must stay valid as long as
+     * the index is used.
+     * @param nodes The nodes, numNodes(num_ranges) of them
+     * @param num_ranges The number of ranges
+     * @param max_end The end of the last range
+     */
+    void setNodes(const Node *nodes, bt::Uint32 num_ranges, const Key &max_end)
+    {
+        if (nodes != owned_nodes.data())
+            owned_nodes.clear();
+
+        this->nodes = nodes;
+        this->num_nodes = numNodes(num_ranges);
+        this->num_ranges = num_ranges;
+        this->max_end = max_end;
+    }
+
+    /// Remove all ranges
+    void clear()
+    {
+        owned_nodes.clear();
+        nodes = nullptr;
+        num_nodes = num_ranges = 0;
+        max_end = Key();
+    }
+
+    /// Get the number of ranges
+    bt::Uint32 count() const
+    {
+        return num_ranges;
+    }
+
+    /**
+     * Find the range containing a value.
+     * @param v The value
+     * @return The slot of the range (node * KEYS + key), or NOT_FOUND
+     */
+    bt::Uint32 find(const Key &v) const
+    {
+        if (num_ranges == 0 || max_end < v)
+            return NOT_FOUND;
+
+        // Look for the first range which ends at or after v, the keys within a node are
+        // sorted, so the number of keys smaller then v is the position of that range
+        bt::Uint32 result = NOT_FOUND;
+        bt::Uint64 k = 0;
+        while (k < num_nodes) {
+            bt::Uint32 i = RangeIndexCountLess(nodes[k], v);
+            if (i < Node::KEYS)
+                result = k * Node::KEYS + i;
+            k = k * (Node::KEYS + 1) + i + 1;
+        }
+
+        // v <= max_end, so there always is a result
+        const Node &node = nodes[result / Node::KEYS];
+        return node.starts[result % Node::KEYS] <= v ? result : NOT_FOUND;
+    }
+
+    /// Check if a value is in one of the ranges
+    bool contains(const Key &v) const
+    {
+        return find(v) != NOT_FOUND;
+    }
+
+    /// Get the range in a slot returned by find
+    void range(bt::Uint32 slot, Key &start, Key &end) const
+    {
+        const Node &node = nodes[slot / Node::KEYS];
+        start = node.starts[slot % Node::KEYS];
+        end = node.ends[slot % Node::KEYS];
+    }
+
+private:
+    template<class GetRange, class Placed>
+    static void fill(Node *nodes, bt::Uint64 num_nodes, bt::Uint64 k, bt::Uint32 num_ranges, bt::Uint32 &next, Key &max_end, GetRange &get, Placed &placed)
+    {
+        if (k >= num_nodes)
+            return;
+
+        for (bt::Uint32 i = 0; i < Node::KEYS; i++) {
+            fill(nodes, num_nodes, k * (Node::KEYS + 1) + i + 1, num_ranges, next, max_end, get, placed);
+            if (next < num_ranges) {
+                get(next, nodes[k].starts[i], nodes[k].ends[i]);
+                placed(next, bt::Uint32(k * Node::KEYS + i));
+                max_end = nodes[k].ends[i];
+                next++;
+            } else {
+                // Padding, must compare greater or equal to everything
+                RangeIndexMaxKey(nodes[k].starts[i]);
+                RangeIndexMaxKey(nodes[k].ends[i]);
+            }
+        }
+        fill(nodes, num_nodes, k * (Node::KEYS + 1) + Node::KEYS + 1, num_ranges, next, max_end, get, placed);
+    }
+
+private:
+    const Node *nodes;
+    bt::Uint32 num_nodes;
+    bt::Uint32 num_ranges;
+    Key max_end;
+    std::vector<Node> owned_nodes;
+};
+
+/// Index of IPv4 ranges
+typedef RangeIndexT<RangeIndexNode> RangeIndex;
+
+/// Index of IPv6 ranges
+typedef RangeIndexT<RangeIndex6Node> RangeIndex6;
+
+}
+
+#endif
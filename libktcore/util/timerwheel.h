@@ -0,0 +1,185 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_TIMERWHEEL_H
+#define KT_TIMERWHEEL_H
+
+#include <utility>
+#include <vector>
+
+#include <QHash>
+
+#include <util/constants.h>
+
+namespace kt
+{
+/**
+ * @brief Hierarchical timer wheel
+ *
+ * Keeps track of a deadline per item, and calls a function for the items
+ * whose deadline has passed. Time is divided in ticks of a fixed resolution,
+ * level 0 has a slot for each of the next SLOTS ticks, level 1 a slot for
+ * each SLOTS ticks after that, and so on. Items in a higher level move down
+ * a level when the wheel below them has turned around. Scheduling,
+ * cancelling and firing are all constant time, and advancing the wheel only
+ * touches the slots which have expired, no matter how many items there are.
+ *
+ * Cancelling or rescheduling leaves the old entry in its slot, it is skipped
+ * when that slot is processed.
+ *
+ * The wheel has to be set to the current time with reset before anything
+ * is scheduled.
+ */
+template<class T>
+class TimerWheel
+{
+public:
+    static const bt::Uint32 SLOT_BITS = 6;
+    static const bt::Uint32 SLOTS = 1 << SLOT_BITS;
+    static const bt::Uint32 LEVELS = 4;
+
+    /**
+     * Constructor
+     * @param resolution Length of a tick in ms
+     */
+    explicit TimerWheel(bt::TimeStamp resolution = 1000)
+        : resolution(resolution)
+        , now_tick(0)
+        , next_seq(0)
+        , wheel(SLOTS * LEVELS)
+    {
+    }
+
+    /// Get the number of items with a deadline
+    int count() const
+    {
+        return entries.count();
+    }
+
+    /// Does an item have a deadline
+    bool contains(const T &item) const
+    {
+        return entries.contains(item);
+    }
+
+    /// Remove all items, and set the wheel to a time in ms
+    void reset(bt::TimeStamp now)
+    {
+        entries.clear();
+        for (Slot &s : wheel)
+            s.clear();
+        now_tick = now / resolution;
+    }
+
+    /**
+     * Set the deadline of an item, replacing the previous one.
+     * A deadline in the past fires at the next call to advance.
+     * @param item The item
+     * @param deadline The deadline in ms
+     */
+    void schedule(const T &item, bt::TimeStamp deadline)
+    {
+        bt::TimeStamp tick = deadline / resolution;
+        if (tick <= now_tick)
+            tick = now_tick + 1;
+
+        Entry &e = entries[item];
+        e.tick = tick;
+        e.seq = next_seq++;
+        place(item, e);
+    }
+
+    /// Remove the deadline of an item
+    void cancel(const T &item)
+    {
+        entries.remove(item);
+    }
+
+    /**
+     * Advance the wheel to a time, and fire all items whose deadline is at or before it.
+     * Fired items no longer have a deadline, fire may schedule them (or others) again.
+     * @param now The current time in ms
+     * @param fire Function called as fire(item)
+     */
+    template<class Fire>
+    void advance(bt::TimeStamp now, Fire fire)
+    {
+        const bt::TimeStamp target = now / resolution;
+        if (entries.isEmpty() && target > now_tick) {
+            // Nothing to do, jump straight there
+            now_tick = target;
+            return;
+        }
+
+        while (now_tick < target) {
+            now_tick++;
+
+            // Move the items of the higher levels down when the level below has turned around
+            bt::Uint32 levels = 1;
+            while (levels < LEVELS && (now_tick & ((bt::TimeStamp(1) << (levels * SLOT_BITS)) - 1)) == 0)
+                levels++;
+            for (bt::Uint32 l = levels - 1; l > 0; l--)
+                cascade(l);
+
+            Slot expired;
+            expired.swap(wheel[now_tick & (SLOTS - 1)]);
+            for (const auto &i : expired) {
+                auto e = entries.find(i.first);
+                if (e == entries.end() || e->seq != i.second)
+                    continue; // cancelled or rescheduled
+
+                entries.erase(e);
+                fire(i.first);
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        bt::TimeStamp tick;
+        bt::Uint64 seq;
+    };
+
+    typedef std::vector<std::pair<T, bt::Uint64>> Slot;
+
+    void place(const T &item, const Entry &e)
+    {
+        bt::TimeStamp delta = e.tick > now_tick ? e.tick - now_tick : 0;
+        bt::TimeStamp tick = e.tick;
+        bt::Uint32 level = 0;
+        while (level < LEVELS - 1 && delta >= (bt::TimeStamp(1) << ((level + 1) * SLOT_BITS)))
+            level++;
+
+        // Too far away, park it in the last slot, it will be placed again when it gets there
+        const bt::TimeStamp max_delta = (bt::TimeStamp(1) << (LEVELS * SLOT_BITS)) - 1;
+        if (delta > max_delta)
+            tick = now_tick + max_delta;
+
+        const bt::Uint32 slot = (tick >> (level * SLOT_BITS)) & (SLOTS - 1);
+        wheel[level * SLOTS + slot].push_back(std::make_pair(item, e.seq));
+    }
+
+    void cascade(bt::Uint32 level)
+    {
+        Slot items;
+        items.swap(wheel[level * SLOTS + ((now_tick >> (level * SLOT_BITS)) & (SLOTS - 1))]);
+        for (const auto &i : items) {
+            auto e = entries.find(i.first);
+            if (e != entries.end() && e->seq == i.second)
+                place(i.first, *e);
+        }
+    }
+
+private:
+    bt::TimeStamp resolution;
+    bt::TimeStamp now_tick;
+    bt::Uint64 next_seq;
+    std::vector<Slot> wheel; // LEVELS * SLOTS slots
+    QHash<T, Entry> entries;
+};
+
+}
+
+#endif
@@ -0,0 +1,217 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "tracer.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+
+#include <util/log.h>
+
+using namespace bt;
+
+namespace kt
+{
+std::atomic<bool> Tracer::enabled(false);
+
+namespace
+{
+/**
+ * A slot in a ring buffer. Its thread may overwrite it while save reads it,
+ * so the fields are atomics, and save checks the sequence number before and
+ * after reading them, to skip spans which were not read intact.
+ */
+struct Span {
+    std::atomic<quint64> seq{0}; // 2 * (index + 1) once the span with that index is written, odd while writing
+    std::atomic<const char *> category{nullptr};
+    std::atomic<const char *> name{nullptr};
+    std::atomic<qint64> start{0};
+    std::atomic<qint64> duration{0};
+};
+
+/// Spans of one thread, only that thread writes to it
+struct Buffer {
+    Span spans[Tracer::BUFFER_SIZE];
+    std::atomic<quint64> written{0};
+    int tid = 0;
+    QByteArray thread_name;
+};
+
+/// All buffers, they are never freed, so the spans of threads which have finished can still be saved
+struct Registry {
+    QMutex mutex;
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    std::unordered_set<std::string> strings;
+};
+
+Registry &TheRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+thread_local Buffer *thread_buffer = nullptr;
+
+Buffer *RegisterThread()
+{
+    auto buffer = std::make_unique<Buffer>();
+    QThread *thread = QThread::currentThread();
+    QCoreApplication *app = QCoreApplication::instance();
+
+    Registry &r = TheRegistry();
+    QMutexLocker lock(&r.mutex);
+    buffer->tid = int(r.buffers.size()) + 1;
+    if (app && thread == app->thread())
+        buffer->thread_name = "Main thread";
+    else if (!thread->objectName().isEmpty())
+        buffer->thread_name = thread->objectName().toUtf8() + ' ' + QByteArray::number(buffer->tid);
+    else
+        buffer->thread_name = "Thread " + QByteArray::number(buffer->tid);
+
+    r.buffers.push_back(std::move(buffer));
+    return r.buffers.back().get();
+}
+
+void AppendString(QByteArray &out, const char *str)
+{
+    out += '"';
+    for (const char *c = str; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            out += '\\';
+            out += *c;
+        } else if ((unsigned char)*c < 0x20) {
+            out += "\\u00";
+            out += QByteArray::number((unsigned char)*c, 16).rightJustified(2, '0');
+        } else {
+            out += *c;
+        }
+    }
+    out += '"';
+}
+
+/// Chrome traces are in microseconds
+void AppendTime(QByteArray &out, qint64 ns)
+{
+    out += QByteArray::number(ns / 1000) + '.' + QByteArray::number(ns % 1000).rightJustified(3, '0');
+}
+}
+
+void Tracer::setEnabled(bool on)
+{
+#ifdef KT_NO_TRACING
+    if (on)
+        Out(SYS_GEN | LOG_NOTICE) << "Tracing is not supported by this build" << endl;
+#else
+    enabled = on;
+#endif
+}
+
+qint64 Tracer::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Tracer::record(const char *category, const char *name, qint64 start, qint64 duration)
+{
+    if (!thread_buffer)
+        thread_buffer = RegisterThread();
+
+    const quint64 idx = thread_buffer->written.load(std::memory_order_relaxed);
+    Span &s = thread_buffer->spans[idx % BUFFER_SIZE];
+    s.seq.store(2 * idx + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.category.store(category, std::memory_order_relaxed);
+    s.name.store(name, std::memory_order_relaxed);
+    s.start.store(start, std::memory_order_relaxed);
+    s.duration.store(duration, std::memory_order_relaxed);
+    s.seq.store(2 * idx + 2, std::memory_order_release);
+    thread_buffer->written.store(idx + 1, std::memory_order_release);
+}
+
+const char *Tracer::intern(const QString &str)
+{
+    Registry &r = TheRegistry();
+    QMutexLocker lock(&r.mutex);
+    return r.strings.insert(str.toStdString()).first->c_str();
+}
+
+bool Tracer::save(const QString &file)
+{
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    QByteArray out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    int num = 0;
+    const auto separator = [&out, &num]() {
+        if (num++ > 0)
+            out += ",\n";
+        else
+            out += '\n';
+    };
+
+    Registry &r = TheRegistry();
+    QMutexLocker lock(&r.mutex);
+    const size_t num_threads = r.buffers.size();
+    for (const std::unique_ptr<Buffer> &b : r.buffers) {
+        const QByteArray tid = QByteArray::number(b->tid);
+        separator();
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"args\":{\"name\":";
+        AppendString(out, b->thread_name.constData());
+        out += "}}";
+
+        // The thread may go on recording while we read, skip the spans it overwrites in the meantime
+        const quint64 end = b->written.load(std::memory_order_acquire);
+        const quint64 begin = end > quint64(BUFFER_SIZE) ? end - BUFFER_SIZE : 0;
+        for (quint64 i = begin; i < end; i++) {
+            const Span &s = b->spans[i % BUFFER_SIZE];
+            const quint64 seq = s.seq.load(std::memory_order_acquire);
+            const char *category = s.category.load(std::memory_order_relaxed);
+            const char *name = s.name.load(std::memory_order_relaxed);
+            const qint64 start = s.start.load(std::memory_order_relaxed);
+            const qint64 duration = s.duration.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq != 2 * i + 2 || s.seq.load(std::memory_order_relaxed) != seq)
+                continue;
+
+            separator();
+            out += "{\"name\":";
+            AppendString(out, name);
+            out += ",\"cat\":";
+            AppendString(out, category);
+            out += ",\"ph\":\"X\",\"ts\":";
+            AppendTime(out, start);
+            out += ",\"dur\":";
+            AppendTime(out, duration);
+            out += ",\"pid\":" + pid + ",\"tid\":" + tid + '}';
+        }
+    }
+    lock.unlock();
+    out += "\n]}\n";
+
+    QSaveFile fptr(file);
+    if (!fptr.open(QIODevice::WriteOnly)) {
+        Out(SYS_GEN | LOG_IMPORTANT) << "Failed to open " << file << " : " << fptr.errorString() << endl;
+        return false;
+    }
+
+    fptr.write(out);
+    if (!fptr.commit()) {
+        Out(SYS_GEN | LOG_IMPORTANT) << "Failed to write " << file << " : " << fptr.errorString() << endl;
+        return false;
+    }
+
+    Out(SYS_GEN | LOG_NOTICE) << "Saved trace of " << num_threads << " threads to " << file << endl;
+    return true;
+}
+
+}
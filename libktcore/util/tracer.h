@@ -0,0 +1,114 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_TRACER_H
+#define KT_TRACER_H
+
+#include <atomic>
+
+#include <QString>
+#include <QtGlobal>
+
+#include <ktcore_export.h>
+
+namespace kt
+{
+/**
+ * @brief Records how long pieces of code take, for profiling real sessions
+ *
+ * Spans are recorded with KT_TRACE_SCOPE, which measures the time until the
+ * end of the scope it is in. Tracing is off by default, a span then costs a
+ * single check of an atomic flag. Building with -DENABLE_TRACING=OFF removes
+ * the spans entirely.
+ *
+ * Every thread records into its own ring buffer, so recording does not take
+ * any locks, only the first span of a thread registers its buffer. When a
+ * buffer is full the oldest spans are overwritten.
+ *
+ * The spans are saved in the Chrome trace event format, which can be opened
+ * in chrome://tracing, Perfetto or speedscope.
+ */
+class KTCORE_EXPORT Tracer
+{
+public:
+    /// Number of spans kept per thread
+    static const int BUFFER_SIZE = 16384;
+
+    /// Is tracing switched on
+    static bool isEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /// Switch tracing on or off, spans recorded so far are kept
+    static void setEnabled(bool on);
+
+    /// Current time in ns, on the clock spans are recorded with
+    static qint64 now();
+
+    /**
+     * Record a span of the current thread.
+     * @param category The category, must stay valid (a string literal or interned)
+     * @param name The name, must stay valid (a string literal or interned)
+     * @param start Start time as returned by now
+     * @param duration Duration in ns
+     */
+    static void record(const char *category, const char *name, qint64 start, qint64 duration);
+
+    /// Get a copy of a string which stays valid, to use dynamic names for spans
+    static const char *intern(const QString &str);
+
+    /**
+     * Save the spans of all threads in Chrome trace event JSON.
+     * @param file The file
+     * @return true if the file was written
+     */
+    static bool save(const QString &file);
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+/**
+ * Records a span from its construction until its destruction, if tracing was
+ * switched on when it was constructed. Use it through KT_TRACE_SCOPE.
+ */
+class TraceSpan
+{
+public:
+    TraceSpan(const char *category, const char *name)
+        : category(category)
+        , name(name)
+        , start(Tracer::isEnabled() ? Tracer::now() : -1)
+    {
+    }
+
+    ~TraceSpan()
+    {
+        if (start >= 0)
+            Tracer::record(category, name, start, Tracer::now() - start);
+    }
+
+    Q_DISABLE_COPY(TraceSpan)
+
+private:
+    const char *category;
+    const char *name;
+    qint64 start;
+};
+
+}
+
+#define KT_TRACE_CONCAT_(a, b) a##b
+#define KT_TRACE_CONCAT(a, b) KT_TRACE_CONCAT_(a, b)
+
+#ifdef KT_NO_TRACING
+#define KT_TRACE_SCOPE(category, name)
+#else
+/// Record the time until the end of the current scope
+#define KT_TRACE_SCOPE(category, name) kt::TraceSpan KT_TRACE_CONCAT(kt_trace_span_, __LINE__)(category, name)
+#endif
+
+#endif
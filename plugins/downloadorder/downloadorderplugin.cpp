@@ -44,6 +44,7 @@ void DownloadOrderPlugin::load()
     TorrentActivityInterface *ta = getGUI()->getTorrentActivity();
     ta->addViewListener(this);
     connect(getCore(), &CoreInterface::torrentAdded, this, &DownloadOrderPlugin::torrentAdded);
+    connect(getCore(), &CoreInterface::torrentLoaded, this, &DownloadOrderPlugin::torrentAdded);
     connect(getCore(), &CoreInterface::torrentRemoved, this, &DownloadOrderPlugin::torrentRemoved);
     currentTorrentChanged(ta->getCurrentTorrent());
 
@@ -57,6 +58,7 @@ void DownloadOrderPlugin::unload()
     TorrentActivityInterface *ta = getGUI()->getTorrentActivity();
     ta->removeViewListener(this);
     disconnect(getCore(), &CoreInterface::torrentAdded, this, &DownloadOrderPlugin::torrentAdded);
+    disconnect(getCore(), &CoreInterface::torrentLoaded, this, &DownloadOrderPlugin::torrentAdded);
     disconnect(getCore(), &CoreInterface::torrentRemoved, this, &DownloadOrderPlugin::torrentRemoved);
     managers.clear();
 }
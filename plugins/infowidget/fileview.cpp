@@ -292,7 +292,8 @@ void FileView::rename()
     auto renameDialog = new KIO::RenameFileDialog(KFileItemList({item}), nullptr);
     renameDialog->open();
     connect(renameDialog, &KIO::RenameFileDialog::renamingFinished, this, [=](const QList<QUrl> &urls) {
-        model->setData(index, urls.first().fileName(), Qt::EditRole);
+        if (model->setData(index, urls.first().fileName(), Qt::EditRole) && curr_tc)
+            Q_EMIT filesChanged(curr_tc.data());
     });
 }
 
@@ -383,6 +384,7 @@ void FileView::moveFiles()
 
         if (moves.count() > 0) {
             tc->moveTorrentFiles(moves);
+            Q_EMIT filesChanged(tc);
         }
     } else {
         QString recentDirClass;
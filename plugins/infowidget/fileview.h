@@ -47,6 +47,10 @@ public:
 public Q_SLOTS:
     void onTorrentRemoved(bt::TorrentInterface *tc);
 
+Q_SIGNALS:
+    /// Emitted when files of a torrent have been renamed or moved
+    void filesChanged(bt::TorrentInterface *tc);
+
 private Q_SLOTS:
     void showContextMenu(const QPoint &p);
     void onDoubleClicked(const QModelIndex &index);
@@ -13,6 +13,7 @@
 #include <interfaces/guiinterface.h>
 #include <interfaces/torrentinterface.h>
 #include <settings.h>
+#include <torrent/queuemanager.h>
 #include <util/log.h>
 #include <util/logsystemmanager.h>
 
@@ -49,6 +50,7 @@ void InfoWidgetPlugin::load()
     status_tab = new StatusTab(nullptr);
     file_view = new FileView(nullptr);
     file_view->loadState(KSharedConfig::openConfig());
+    connect(file_view, &FileView::filesChanged, getCore()->getQueueManager(), &QueueManager::filesChanged);
     connect(getCore(), &CoreInterface::torrentRemoved, this, &InfoWidgetPlugin::torrentRemoved);
 
     pref = new IWPrefPage(nullptr);
@@ -0,0 +1,148 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "blocklistholder.h"
+
+#include <memory>
+#include <vector>
+
+#include <QMutex>
+#include <QTimer>
+#include <QWaitCondition>
+
+#include "ipblocklist.h"
+
+using namespace bt;
+
+namespace kt
+{
+/// Time between attempts to delete replaced lists, in milliseconds
+static const int RECLAIM_INTERVAL = 100;
+
+/// Longest a waiting destructor sleeps before it checks the readers again, in milliseconds
+static const int WAIT_INTERVAL = 10;
+
+namespace
+{
+/// Epoch a thread is reading in, 0 if it is not in a blocked call
+struct alignas(64) ReaderSlot {
+    std::atomic<Uint64> epoch{0};
+};
+
+/// The readers of all holders
+struct Readers {
+    std::atomic<Uint64> epoch{1};
+    std::atomic<Uint32> waiters{0};
+    QMutex mutex; // protects slots
+    QWaitCondition left;
+    // slots are kept when their thread finishes, they stay at 0 then
+    std::vector<std::unique_ptr<ReaderSlot>> slots;
+};
+
+Readers readers;
+
+thread_local ReaderSlot *reader_slot = nullptr;
+
+ReaderSlot *ThreadSlot()
+{
+    if (!reader_slot) {
+        QMutexLocker lock(&readers.mutex);
+        readers.slots.push_back(std::make_unique<ReaderSlot>());
+        reader_slot = readers.slots.back().get();
+    }
+    return reader_slot;
+}
+
+/// Has every blocked call which started before epoch returned, must be called with the mutex locked
+bool Quiescent(Uint64 epoch)
+{
+    for (const std::unique_ptr<ReaderSlot> &s : readers.slots) {
+        const Uint64 e = s->epoch.load();
+        if (e != 0 && e < epoch)
+            return false;
+    }
+    return true;
+}
+}
+
+BlockListHolder::BlockListHolder()
+    : current(nullptr)
+    , stats(QStringLiteral("antip2p"))
+{
+}
+
+BlockListHolder::~BlockListHolder()
+{
+    IPBlockList *last = current.exchange(nullptr);
+    const Uint64 epoch = readers.epoch.fetch_add(1) + 1;
+
+    // Wait for the calls which are still going on, they wake us up when they return
+    {
+        QMutexLocker lock(&readers.mutex);
+        readers.waiters++;
+        while (!Quiescent(epoch))
+            readers.left.wait(&readers.mutex, WAIT_INTERVAL);
+        readers.waiters--;
+    }
+
+    delete last;
+    for (const Retired &r : std::as_const(retired))
+        delete r.list;
+}
+
+bool BlockListHolder::blocked(const net::Address &addr) const
+{
+    // Announce ourselves before loading the pointer, publish starts a new epoch after
+    // swapping it, so a slot with an older epoch may still be using the old list
+    ReaderSlot *slot = ThreadSlot();
+    slot->epoch.store(readers.epoch.load(std::memory_order_acquire));
+    const IPBlockList *list = current.load();
+    bool ret = list && list->blocked(addr);
+    slot->epoch.store(0, std::memory_order_release);
+
+    // Only a destructor waits, if the wake up is missed it checks again after WAIT_INTERVAL
+    if (readers.waiters.load(std::memory_order_relaxed) > 0) {
+        QMutexLocker lock(&readers.mutex);
+        readers.left.wakeAll();
+    }
+    return ret;
+}
+
+void BlockListHolder::publish(IPBlockList *list)
+{
+    if (list)
+        list->setStats(&stats);
+
+    IPBlockList *old = current.exchange(list);
+    if (old)
+        retired.append({old, readers.epoch.fetch_add(1) + 1});
+
+    reclaim();
+}
+
+void BlockListHolder::reclaim()
+{
+    if (retired.isEmpty())
+        return;
+
+    {
+        QMutexLocker lock(&readers.mutex);
+        for (auto i = retired.begin(); i != retired.end();) {
+            if (Quiescent(i->epoch)) {
+                delete i->list;
+                i = retired.erase(i);
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    if (!retired.isEmpty())
+        QTimer::singleShot(RECLAIM_INTERVAL, this, &BlockListHolder::reclaim);
+}
+
+}
+
+#include "moc_blocklistholder.cpp"
@@ -0,0 +1,86 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KTBLOCKLISTHOLDER_H
+#define KTBLOCKLISTHOLDER_H
+
+#include <atomic>
+
+#include <QList>
+#include <QObject>
+
+#include <interfaces/blocklistinterface.h>
+#include <util/blockliststats.h>
+#include <util/constants.h>
+
+namespace kt
+{
+class IPBlockList;
+
+/**
+ * @brief Double buffered IPBlockList
+ *
+ * The holder is registered with the AccessManager once, and forwards blocked
+ * calls to the current IPBlockList. A new list is published with an atomic
+ * pointer swap, so connection checks never wait for an update and never see
+ * a half loaded list. Replaced lists are deleted once every blocked call
+ * which could still see them has returned.
+ *
+ * To know that, every thread which calls blocked has its own slot, on its
+ * own cache line, in which it stores the current epoch while it is in a
+ * blocked call. Replacing a list starts a new epoch, and the old list can
+ * go once no slot holds an older epoch. Lookups never write to memory shared
+ * with other threads, and because each call picks up the latest epoch, a
+ * replaced list can always be deleted soon, even under a steady stream of
+ * lookups.
+ *
+ * Lookups on the published lists are counted in stats, which is registered
+ * as "antip2p".
+ */
+class BlockListHolder : public QObject, public bt::BlockListInterface
+{
+    Q_OBJECT
+public:
+    BlockListHolder();
+    ~BlockListHolder() override;
+
+    bool blocked(const net::Address &addr) const override;
+
+    /**
+     * Publish a new list, the holder takes ownership of it.
+     * Must be called from the thread which owns the holder.
+     * @param list The new list, nullptr to stop filtering
+     */
+    void publish(IPBlockList *list);
+
+    /// Whether or not there is a list to filter with
+    bool loaded() const
+    {
+        return current.load() != nullptr;
+    }
+
+    /// Get the current list, it stays valid until the next publish on the owning thread
+    const IPBlockList *list() const
+    {
+        return current.load();
+    }
+
+private:
+    void reclaim();
+
+private:
+    struct Retired {
+        IPBlockList *list;
+        bt::Uint64 epoch; // first epoch in which it cannot be seen anymore
+    };
+
+    std::atomic<IPBlockList *> current;
+    QList<Retired> retired;
+    BlockListStats stats;
+};
+
+}
+
+#endif
@@ -0,0 +1,604 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "blocklistparser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <vector>
+
+#include <QThread>
+#include <QThreadPool>
+
+using namespace bt;
+
+namespace kt
+{
+static inline bool IsDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline bool IsHex(char c)
+{
+    return IsDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static inline Uint32 HexValue(char c)
+{
+    if (IsDigit(c))
+        return c - '0';
+    else if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    else
+        return c - 'A' + 10;
+}
+
+static inline bool IsIPv6Char(char c)
+{
+    return IsHex(c) || c == ':' || c == '.';
+}
+
+/**
+ * Match a dotted quad at p, in the same way as the regular expression
+ * (?:[0-9]{1,3}\.){3}[0-9]{1,3} would.
+ * @param p Start of the match
+ * @param end End of the data
+ * @param ip The address
+ * @param valid Set to false if one of the numbers is larger then 255
+ * @return The end of the match, or nullptr if there is no match
+ */
+static const char *MatchQuad(const char *p, const char *end, Uint32 &ip, bool &valid)
+{
+    ip = 0;
+    valid = true;
+    for (int c = 0; c < 4; c++) {
+        Uint32 v = 0;
+        int digits = 0;
+        while (digits < 3 && p < end && IsDigit(*p)) {
+            v = v * 10 + (*p - '0');
+            p++;
+            digits++;
+        }
+
+        if (digits == 0)
+            return nullptr;
+
+        if (v > 255)
+            valid = false;
+
+        ip = (ip << 8) | (v & 0xFF);
+        if (c < 3) {
+            if (p >= end || *p != '.')
+                return nullptr;
+            p++;
+        }
+    }
+    return p;
+}
+
+bool ParseIPv6(const char *p, const char *end, Uint128 &ip)
+{
+    Uint32 groups[8];
+    int n = 0;
+    int gap = -1; // position of the ::
+    if (p == end)
+        return false;
+
+    if (*p == ':') {
+        if (end - p < 2 || p[1] != ':')
+            return false;
+        gap = 0;
+        p += 2;
+    }
+
+    while (p < end) {
+        const char *q = p;
+        while (q < end && IsHex(*q))
+            q++;
+
+        if (q < end && *q == '.') {
+            // The last 32 bits can be written as an IPv4 address
+            Uint32 v4 = 0;
+            bool valid = false;
+            const char *r = MatchQuad(p, end, v4, valid);
+            if (!r || r != end || !valid || n > 6)
+                return false;
+
+            groups[n++] = v4 >> 16;
+            groups[n++] = v4 & 0xFFFF;
+            p = r;
+            break;
+        }
+
+        if (q == p || q - p > 4 || n >= 8)
+            return false;
+
+        Uint32 g = 0;
+        for (; p < q; p++)
+            g = (g << 4) | HexValue(*p);
+        groups[n++] = g;
+
+        if (p == end)
+            break;
+        else if (*p != ':')
+            return false;
+
+        p++;
+        if (p < end && *p == ':') {
+            if (gap >= 0)
+                return false;
+            gap = n;
+            p++;
+        } else if (p == end) {
+            return false;
+        }
+    }
+
+    if (gap < 0 ? n != 8 : n > 7)
+        return false;
+
+    // Expand the ::
+    Uint32 full[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    const int head = gap < 0 ? n : gap;
+    for (int i = 0; i < head; i++)
+        full[i] = groups[i];
+    for (int i = head; i < n; i++)
+        full[8 - n + i] = groups[i];
+
+    ip.hi = ((Uint64)full[0] << 48) | ((Uint64)full[1] << 32) | ((Uint64)full[2] << 16) | full[3];
+    ip.lo = ((Uint64)full[4] << 48) | ((Uint64)full[5] << 32) | ((Uint64)full[6] << 16) | full[7];
+    return true;
+}
+
+/**
+ * Find the IPv6 address which ends at pos. The p2p format puts a description followed
+ * by a colon in front of it, so we take the longest run of address characters which
+ * parses, starting at a word boundary or after a colon.
+ */
+static bool ParseIPv6Before(const char *begin, const char *pos, Uint128 &ip)
+{
+    const char *b = pos;
+    while (b > begin && IsIPv6Char(b[-1]))
+        b--;
+
+    // Don't start in the middle of a word, like the "c" of "Some Inc:2001:db8::1"
+    const bool word_boundary = b == begin || !(isalnum((unsigned char)b[-1]) || b[-1] == '_');
+    for (const char *i = b; i < pos; i++) {
+        if (((i == b && word_boundary) || (i > b && i[-1] == ':')) && ParseIPv6(i, pos, ip))
+            return true;
+    }
+    return false;
+}
+
+/// Parse an IPv6 range, as start-end or as a prefix (address/length)
+static bool ParseIPv6Range(const char *begin, const char *end, IPBlock6 &block)
+{
+    for (const char *p = begin; p < end; p++) {
+        if (*p == '-') {
+            const char *e = p + 1;
+            while (e < end && IsIPv6Char(*e))
+                e++;
+
+            if (ParseIPv6Before(begin, p, block.ip1) && ParseIPv6(p + 1, e, block.ip2) && block.ip1 <= block.ip2)
+                return true;
+        } else if (*p == '/') {
+            const char *e = p + 1;
+            int prefix_len = 0;
+            while (e < end && IsDigit(*e) && e - p <= 3) {
+                prefix_len = prefix_len * 10 + (*e - '0');
+                e++;
+            }
+
+            if (e == p + 1 || prefix_len > 128 || !ParseIPv6Before(begin, p, block.ip1))
+                continue;
+
+            // Clear the host bits for the start, and set them for the end
+            Uint64 hi_mask = prefix_len >= 64 ? ~0ULL : (prefix_len == 0 ? 0 : ~0ULL << (64 - prefix_len));
+            Uint64 lo_mask = prefix_len <= 64 ? 0 : (prefix_len == 128 ? ~0ULL : ~0ULL << (128 - prefix_len));
+            block.ip1.hi &= hi_mask;
+            block.ip1.lo &= lo_mask;
+            block.ip2.hi = block.ip1.hi | ~hi_mask;
+            block.ip2.lo = block.ip1.lo | ~lo_mask;
+            return true;
+        }
+    }
+    return false;
+}
+
+BlockListParser::BlockListParser()
+    : num_lines(0)
+{
+}
+
+BlockListParser::~BlockListParser()
+{
+}
+
+void BlockListParser::parseLine(const char *begin, const char *end)
+{
+    num_lines++;
+
+    Uint32 addresses[2] = {0, 0};
+    int found = 0;
+    bool valid = true;
+    const char *p = begin;
+    while (p < end) {
+        if (IsDigit(*p)) {
+            Uint32 ip = 0;
+            bool ok = false;
+            const char *q = MatchQuad(p, end, ip, ok);
+            if (q) {
+                if (found < 2)
+                    addresses[found] = ip;
+                found++;
+                valid = valid && ok;
+                p = q;
+                continue;
+            }
+        }
+        p++;
+    }
+
+    // if we have found two addresses, create a block out of it
+    if (found == 2) {
+        if (!valid)
+            return;
+
+        IPBlock block;
+        block.ip1 = qMin(addresses[0], addresses[1]);
+        block.ip2 = qMax(addresses[0], addresses[1]);
+        v4.append(block);
+    } else if (found == 0) {
+        IPBlock6 block;
+        if (ParseIPv6Range(begin, end, block))
+            v6.append(block);
+    }
+}
+
+/**
+ * Parse all lines in [data, data + size).
+ * @param parser The parser
+ * @param parsed Incremented regularly with the number of bytes parsed, may be nullptr
+ * @param abort Stop when this becomes true, may be nullptr
+ */
+static void ParseLines(BlockListParser &parser, const char *data, Uint64 size, std::atomic<Uint64> *parsed, const std::atomic<bool> *abort)
+{
+    const Uint64 report_interval = 64 * 1024;
+    const char *p = data;
+    const char *end = data + size;
+    const char *reported = data;
+    while (p < end) {
+        const char *nl = static_cast<const char *>(memchr(p, '\n', end - p));
+        const char *eol = nl ? nl : end;
+        if (eol > p && eol[-1] == '\r')
+            eol--;
+
+        parser.parseLine(p, eol);
+        p = nl ? nl + 1 : end;
+
+        if (Uint64(p - reported) >= report_interval) {
+            if (parsed)
+                parsed->fetch_add(p - reported, std::memory_order_relaxed);
+            reported = p;
+            if (abort && abort->load(std::memory_order_relaxed))
+                return;
+        }
+    }
+
+    if (parsed)
+        parsed->fetch_add(p - reported, std::memory_order_relaxed);
+}
+
+void BlockListParser::parse(const char *data, Uint64 size)
+{
+    ParseLines(*this, data, size, nullptr, nullptr);
+}
+
+void BlockListParser::feed(const char *data, Uint64 size)
+{
+    const char *end = data + size;
+    if (!partial.isEmpty()) {
+        // Complete the line of the previous chunk first
+        const char *nl = static_cast<const char *>(memchr(data, '\n', size));
+        if (!nl) {
+            partial.append(data, size);
+            return;
+        }
+
+        partial.append(data, nl - data);
+        ParseLines(*this, partial.constData(), partial.size(), nullptr, nullptr);
+        partial.clear();
+        data = nl + 1;
+    }
+
+    // Parse all complete lines, and keep the rest for the next chunk
+    const char *last = end;
+    while (last > data && last[-1] != '\n')
+        last--;
+
+    if (last > data)
+        ParseLines(*this, data, last - data, nullptr, nullptr);
+    partial.append(last, end - last);
+}
+
+void BlockListParser::finish()
+{
+    if (!partial.isEmpty()) {
+        ParseLines(*this, partial.constData(), partial.size(), nullptr, nullptr);
+        partial.clear();
+    }
+}
+
+void BlockListParser::parseParallel(const char *data, Uint64 size, const ProgressCallback &progress, const std::atomic<bool> *abort)
+{
+    const Uint64 min_block_size = 1024 * 1024;
+    const int num_threads = qMax(1, QThread::idealThreadCount());
+    const Uint64 num_blocks = qMin<Uint64>(num_threads * 4, size / min_block_size + 1);
+
+    // Split the data into blocks, at line boundaries
+    std::vector<std::pair<const char *, const char *>> blocks;
+    const char *p = data;
+    const char *end = data + size;
+    for (Uint64 i = 0; i < num_blocks && p < end; i++) {
+        const char *e = i + 1 == num_blocks ? end : data + size * (i + 1) / num_blocks;
+        if (e < p)
+            e = p;
+
+        const char *nl = static_cast<const char *>(memchr(e, '\n', end - e));
+        e = nl ? nl + 1 : end;
+        blocks.push_back(std::make_pair(p, e));
+        p = e;
+    }
+
+    if (blocks.size() <= 1) {
+        std::atomic<Uint64> parsed(0);
+        ParseLines(*this, data, size, &parsed, abort);
+        if (progress)
+            progress(size, size);
+        return;
+    }
+
+    std::vector<BlockListParser> parsers(blocks.size());
+    std::atomic<Uint64> parsed(0);
+    QThreadPool pool;
+    pool.setMaxThreadCount(num_threads);
+    for (size_t i = 0; i < blocks.size(); i++) {
+        BlockListParser *parser = &parsers[i];
+        const std::pair<const char *, const char *> block = blocks[i];
+        pool.start([parser, block, &parsed, abort]() {
+            ParseLines(*parser, block.first, block.second - block.first, &parsed, abort);
+        });
+    }
+
+    // Only report progress from this thread, and not too often
+    while (!pool.waitForDone(100)) {
+        if (progress)
+            progress(parsed.load(std::memory_order_relaxed), size);
+    }
+
+    qsizetype total = v4.size();
+    qsizetype total6 = v6.size();
+    for (const BlockListParser &parser : parsers) {
+        total += parser.v4.size();
+        total6 += parser.v6.size();
+    }
+
+    v4.reserve(total);
+    v6.reserve(total6);
+    for (const BlockListParser &parser : parsers) {
+        v4.append(parser.v4);
+        v6.append(parser.v6);
+        num_lines += parser.num_lines;
+    }
+
+    if (progress)
+        progress(size, size);
+}
+
+void SortBlocks(QList<IPBlock> &blocks)
+{
+    // LSD radix sort on the start address, one byte per pass
+    const qsizetype n = blocks.size();
+    if (n < 2)
+        return;
+
+    QList<IPBlock> tmp(n);
+    IPBlock *src = blocks.data();
+    IPBlock *dst = tmp.data();
+    for (int shift = 0; shift < 32; shift += 8) {
+        qsizetype count[257];
+        std::fill(count, count + 257, 0);
+        for (qsizetype i = 0; i < n; i++)
+            count[((src[i].ip1 >> shift) & 0xFF) + 1]++;
+
+        // Skip the pass if all blocks have the same byte here
+        if (count[((src[0].ip1 >> shift) & 0xFF) + 1] == n)
+            continue;
+
+        for (int i = 1; i < 257; i++)
+            count[i] += count[i - 1];
+
+        for (qsizetype i = 0; i < n; i++)
+            dst[count[(src[i].ip1 >> shift) & 0xFF]++] = src[i];
+
+        std::swap(src, dst);
+    }
+
+    if (src != blocks.data())
+        std::copy(src, src + n, blocks.data());
+}
+
+void SortBlocks(QList<IPBlock6> &blocks)
+{
+    std::sort(blocks.begin(), blocks.end(), [](const IPBlock6 &a, const IPBlock6 &b) {
+        return a.ip1 < b.ip1;
+    });
+}
+
+template<class Block>
+static void MergeSortedBlocks(QList<Block> &blocks)
+{
+    if (blocks.size() < 2) // noting to merge
+        return;
+
+    // Blocks are sorted on their start, so only the end of the last output block matters
+    Block *b = blocks.data();
+    qsizetype out = 0;
+    for (qsizetype i = 1; i < blocks.size(); i++) {
+        if (b[out].ip2 < b[i].ip1)
+            b[++out] = b[i];
+        else if (b[out].ip2 < b[i].ip2)
+            b[out].ip2 = b[i].ip2;
+    }
+    blocks.resize(out + 1);
+}
+
+void MergeBlocks(QList<IPBlock> &blocks)
+{
+    MergeSortedBlocks(blocks);
+}
+
+void MergeBlocks(QList<IPBlock6> &blocks)
+{
+    MergeSortedBlocks(blocks);
+}
+
+static const QList<IPBlock> &SourceBlocks(const BlockListSource &source, const IPBlock *)
+{
+    return source.blocks;
+}
+
+static const QList<IPBlock6> &SourceBlocks(const BlockListSource &source, const IPBlock6 *)
+{
+    return source.blocks6;
+}
+
+static bool IsMax(Uint32 ip)
+{
+    return ip == 0xFFFFFFFF;
+}
+
+static Uint32 Next(Uint32 ip)
+{
+    return ip + 1;
+}
+
+static Uint32 Prev(Uint32 ip)
+{
+    return ip - 1;
+}
+
+static bool IsMax(const Uint128 &ip)
+{
+    return ip.hi == ~0ULL && ip.lo == ~0ULL;
+}
+
+static Uint128 Next(const Uint128 &ip)
+{
+    Uint128 r = {ip.lo == ~0ULL ? ip.hi + 1 : ip.hi, ip.lo + 1};
+    return r;
+}
+
+static Uint128 Prev(const Uint128 &ip)
+{
+    Uint128 r = {ip.lo == 0 ? ip.hi - 1 : ip.hi, ip.lo - 1};
+    return r;
+}
+
+template<class Block, class Key>
+static void AppendSourceBlock(QList<Block> &blocks, QList<Uint32> &masks, const Key &ip1, const Key &ip2, Uint32 mask)
+{
+    // Adjacent blocks of the same sources can be one block
+    if (!blocks.isEmpty() && masks.last() == mask && Next(blocks.last().ip2) == ip1) {
+        blocks.last().ip2 = ip2;
+        return;
+    }
+
+    Block b;
+    b.ip1 = ip1;
+    b.ip2 = ip2;
+    blocks.append(b);
+    masks.append(mask);
+}
+
+template<class Block>
+static void MergeSourceBlocks(const QList<BlockListSource> &sources, QList<Block> &blocks, QList<Uint32> &masks)
+{
+    typedef decltype(Block::ip1) Key;
+
+    // Sweep over the starts and ends of the blocks of all sources, every time a source
+    // starts or stops covering the addresses a new block begins, so each output block
+    // has exactly the sources which cover it. The blocks of a source are disjoint, so
+    // at most one of them covers an address. There are only a few sources, so finding
+    // the next start or end with a linear scan is fine.
+    const int k = sources.count();
+    std::vector<const QList<Block> *> lists(k);
+    std::vector<qsizetype> pos(k, 0);
+    qsizetype total = 0;
+    for (int i = 0; i < k; i++) {
+        lists[i] = &SourceBlocks(sources[i], static_cast<const Block *>(nullptr));
+        total += lists[i]->size();
+    }
+
+    blocks.clear();
+    masks.clear();
+    blocks.reserve(total);
+    masks.reserve(total);
+
+    Uint32 mask = 0; // sources covering cur
+    Key cur{}; // start of the block being built
+    bool open = false; // false when the last end was the highest address
+    while (true) {
+        // A start comes before an end at the same address, ends are inclusive
+        int next = -1;
+        bool next_start = false;
+        Key at{};
+        for (int i = 0; i < k; i++) {
+            const bool active = mask & (1u << i);
+            if (!active && pos[i] >= lists[i]->size())
+                continue;
+
+            const Block &b = lists[i]->at(pos[i]);
+            const Key &key = active ? b.ip2 : b.ip1;
+            if (next < 0 || key < at || (key == at && !active && !next_start)) {
+                next = i;
+                next_start = !active;
+                at = key;
+            }
+        }
+
+        if (next < 0)
+            break;
+
+        if (next_start) {
+            if (mask != 0 && open && cur < at)
+                AppendSourceBlock(blocks, masks, cur, Prev(at), mask);
+            mask |= 1u << next;
+            cur = at;
+            open = true;
+        } else {
+            if (open && cur <= at)
+                AppendSourceBlock(blocks, masks, cur, at, mask);
+            mask &= ~(1u << next);
+            pos[next]++;
+            open = !IsMax(at);
+            if (open)
+                cur = Next(at);
+        }
+    }
+}
+
+void MergeSources(const QList<BlockListSource> &sources, QList<IPBlock> &blocks, QList<Uint32> &masks)
+{
+    MergeSourceBlocks(sources, blocks, masks);
+}
+
+void MergeSources(const QList<BlockListSource> &sources, QList<IPBlock6> &blocks, QList<Uint32> &masks)
+{
+    MergeSourceBlocks(sources, blocks, masks);
+}
+}
@@ -0,0 +1,134 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KTBLOCKLISTPARSER_H
+#define KTBLOCKLISTPARSER_H
+
+#include <atomic>
+#include <functional>
+
+#include <QByteArray>
+#include <QString>
+
+#include "ipblocklist.h"
+
+namespace kt
+{
+/**
+ * @brief Parser for text block lists
+ *
+ * Hand written scanner for the text formats of block lists. A line with
+ * exactly two dotted quad IPv4 addresses in it is an IPv4 range, whatever
+ * else is on the line (this covers the p2p and the dat format). A line
+ * without IPv4 addresses is checked for an IPv6 range, written as
+ * start-end (optionally after a p2p style description) or as a prefix.
+ */
+class BlockListParser
+{
+public:
+    BlockListParser();
+    ~BlockListParser();
+
+    /**
+     * Parse a buffer of complete lines, the last line does not need to end in a newline.
+     * @param data The data
+     * @param size Size of the data
+     */
+    void parse(const char *data, bt::Uint64 size);
+
+    /// Progress callback for parseParallel, gets the number of bytes parsed and the total
+    typedef std::function<void(bt::Uint64, bt::Uint64)> ProgressCallback;
+
+    /**
+     * Parse a buffer of complete lines, split into blocks which are parsed on
+     * several threads. The results are in the same order as with parse.
+     * @param data The data
+     * @param size Size of the data
+     * @param progress Called regularly on the calling thread, may be empty
+     * @param abort Stop parsing when this becomes true, may be nullptr
+     */
+    void parseParallel(const char *data, bt::Uint64 size, const ProgressCallback &progress, const std::atomic<bool> *abort);
+
+    /**
+     * Parse the next chunk of a stream, lines may be split over several chunks.
+     * @param data The data
+     * @param size Size of the data
+     */
+    void feed(const char *data, bt::Uint64 size);
+
+    /// Parse the last line of a stream, if it did not end in a newline
+    void finish();
+
+    /// Get the IPv4 blocks which have been found
+    QList<IPBlock> &blocks()
+    {
+        return v4;
+    }
+
+    /// Get the IPv6 blocks which have been found
+    QList<IPBlock6> &blocks6()
+    {
+        return v6;
+    }
+
+    /// Get the number of lines parsed
+    bt::Uint64 numLines() const
+    {
+        return num_lines;
+    }
+
+    /**
+     * Parse a single line.
+     * @param begin Start of the line
+     * @param end End of the line (not including the newline)
+     */
+    void parseLine(const char *begin, const char *end);
+
+private:
+    QList<IPBlock> v4;
+    QList<IPBlock6> v6;
+    bt::Uint64 num_lines;
+    QByteArray partial; // incomplete line at the end of the last chunk fed
+};
+
+/// Blocks of one block list
+struct BlockListSource {
+    QString name; // the URL the list was downloaded from
+    QString file; // text file to parse, if the list has not been parsed yet
+    QList<IPBlock> blocks;
+    QList<IPBlock6> blocks6;
+};
+
+/// Sort IPv4 blocks on their start address, using a radix sort
+void SortBlocks(QList<IPBlock> &blocks);
+
+/// Sort IPv6 blocks on their start address
+void SortBlocks(QList<IPBlock6> &blocks);
+
+/// Merge overlapping blocks of a sorted list, in linear time
+void MergeBlocks(QList<IPBlock> &blocks);
+
+/// Merge overlapping blocks of a sorted list, in linear time
+void MergeBlocks(QList<IPBlock6> &blocks);
+
+/**
+ * Merge the blocks of several sources into one sorted list of disjoint blocks.
+ * The blocks of every source must already be sorted and merged. Where blocks
+ * of different sources overlap they are split, so the mask of every merged
+ * block has a bit set for exactly the sources which cover all of it.
+ * @param sources The sources, at most IPBLOCKLIST_MAX_SOURCES
+ * @param blocks The merged blocks
+ * @param masks For every merged block, the bit mask of sources it came from
+ */
+void MergeSources(const QList<BlockListSource> &sources, QList<IPBlock> &blocks, QList<bt::Uint32> &masks);
+
+/// IPv6 version of MergeSources
+void MergeSources(const QList<BlockListSource> &sources, QList<IPBlock6> &blocks, QList<bt::Uint32> &masks);
+
+/// Parse an IPv6 address in [begin, end), returns false if it is not a valid address
+bool ParseIPv6(const char *begin, const char *end, Uint128 &ip);
+}
+
+#endif
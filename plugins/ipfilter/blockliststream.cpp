@@ -0,0 +1,169 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "blockliststream.h"
+
+#include <KCompressionDevice>
+#include <KFilterBase>
+
+#include <util/log.h>
+
+using namespace bt;
+
+namespace kt
+{
+/// Number of bytes needed to determine the format, the gzip header must be complete as well
+static const int HEAD_SIZE = 4096;
+
+/// Size of the buffer for decompressed data
+static const uint DECOMPRESS_BUFFER_SIZE = 64 * 1024;
+
+BlockListStream::BlockListStream(const QString &fallback_file)
+    : fmt(UNKNOWN)
+    , fallback(fallback_file)
+    , header_read(false)
+    , end_of_stream(false)
+    , decompressed(0)
+{
+}
+
+BlockListStream::~BlockListStream()
+{
+    if (filter)
+        filter->terminate();
+}
+
+bool BlockListStream::write(const QByteArray &data)
+{
+    if (fmt != UNKNOWN)
+        return process(data.constData(), data.size());
+
+    head.append(data);
+    if (head.size() < HEAD_SIZE)
+        return true;
+
+    return detectFormat();
+}
+
+bool BlockListStream::finish()
+{
+    if (fmt == UNKNOWN && !detectFormat())
+        return false;
+
+    switch (fmt) {
+    case OTHER:
+        fallback.close();
+        return true;
+    case GZIP:
+    case BZIP2:
+        // Flush what the decompressor still holds, the last chunk may have filled the output buffer exactly
+        if (!end_of_stream && !decompress(nullptr, 0))
+            return false;
+
+        if (!end_of_stream)
+            Out(SYS_IPF | LOG_NOTICE) << "Compressed block list ended prematurely" << endl;
+        blocklist_parser.finish();
+        return end_of_stream;
+    default:
+        blocklist_parser.finish();
+        return true;
+    }
+}
+
+bool BlockListStream::detectFormat()
+{
+    const char *d = head.constData();
+    const int n = head.size();
+    if (n >= 2 && (quint8)d[0] == 0x1F && (quint8)d[1] == 0x8B) {
+        fmt = GZIP;
+        filter.reset(KCompressionDevice::filterForCompressionType(KCompressionDevice::GZip));
+    } else if (n >= 3 && d[0] == 'B' && d[1] == 'Z' && d[2] == 'h') {
+        fmt = BZIP2;
+        filter.reset(KCompressionDevice::filterForCompressionType(KCompressionDevice::BZip2));
+    } else {
+        // Anything with control characters in it (zip, 7z, ...) is left to the caller
+        fmt = TEXT;
+        for (int i = 0; i < qMin(n, 32); i++) {
+            quint8 c = d[i];
+            if (c < 32 && c != 9 && c != 10 && c != 13) {
+                fmt = OTHER;
+                break;
+            }
+        }
+    }
+
+    if ((fmt == GZIP || fmt == BZIP2) && (!filter || !filter->init(QIODevice::ReadOnly))) {
+        Out(SYS_IPF | LOG_NOTICE) << "Cannot initialize decompression of block list" << endl;
+        return false;
+    }
+
+    if (fmt == OTHER && !fallback.open(QIODevice::WriteOnly)) {
+        Out(SYS_IPF | LOG_NOTICE) << "Cannot open " << fallback.fileName() << ": " << fallback.errorString() << endl;
+        return false;
+    }
+
+    QByteArray data;
+    data.swap(head);
+    return process(data.constData(), data.size());
+}
+
+bool BlockListStream::process(const char *data, Uint64 size)
+{
+    switch (fmt) {
+    case TEXT:
+        decompressed += size;
+        blocklist_parser.feed(data, size);
+        return true;
+    case GZIP:
+    case BZIP2:
+        return decompress(data, size);
+    case OTHER:
+        return fallback.write(data, size) == qint64(size);
+    default:
+        return false;
+    }
+}
+
+bool BlockListStream::decompress(const char *data, Uint64 size)
+{
+    if (end_of_stream) // trailing garbage after the compressed data
+        return true;
+
+    filter->setInBuffer(data, size);
+    if (!header_read) {
+        // Like KCompressionDevice, the first chunk must contain the complete header
+        header_read = true;
+        if (!filter->readHeader()) {
+            Out(SYS_IPF | LOG_NOTICE) << "Invalid header in compressed block list" << endl;
+            return false;
+        }
+    }
+
+    QByteArray buffer(DECOMPRESS_BUFFER_SIZE, Qt::Uninitialized);
+    while (true) {
+        const bool input_left = filter->inBufferAvailable() > 0;
+        filter->setOutBuffer(buffer.data(), DECOMPRESS_BUFFER_SIZE);
+        KFilterBase::Result res = filter->uncompress();
+        const uint produced = DECOMPRESS_BUFFER_SIZE - filter->outBufferAvailable();
+        decompressed += produced;
+        blocklist_parser.feed(buffer.constData(), produced);
+
+        if (res == KFilterBase::End) {
+            end_of_stream = true;
+            return true;
+        } else if (res == KFilterBase::Error) {
+            // Without input, zlib reports that it could not make any progress as an error
+            if (!input_left && produced == 0)
+                return true;
+
+            Out(SYS_IPF | LOG_NOTICE) << "Error while decompressing block list" << endl;
+            return false;
+        } else if (filter->inBufferAvailable() == 0 && produced < DECOMPRESS_BUFFER_SIZE) {
+            return true; // everything consumed, wait for more data
+        }
+    }
+}
+
+}
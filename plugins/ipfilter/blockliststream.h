@@ -0,0 +1,95 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KTBLOCKLISTSTREAM_H
+#define KTBLOCKLISTSTREAM_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QScopedPointer>
+
+#include "blocklistparser.h"
+
+class KFilterBase;
+
+namespace kt
+{
+/**
+ * @brief Parses a block list while it is being downloaded
+ *
+ * Data written to the stream is decompressed (gzip and bzip2) and fed to a
+ * BlockListParser chunk by chunk, so nothing needs to be stored on disk.
+ * Formats which cannot be handled as a stream (zip files for example) are
+ * written to a fallback file instead, to be dealt with once the download
+ * is finished.
+ */
+class BlockListStream
+{
+public:
+    enum Format {
+        UNKNOWN,
+        TEXT,
+        GZIP,
+        BZIP2,
+        OTHER,
+    };
+
+    /**
+     * Constructor
+     * @param fallback_file File to write the data to, if it cannot be handled as a stream
+     */
+    explicit BlockListStream(const QString &fallback_file);
+    ~BlockListStream();
+
+    /**
+     * Write the next chunk of data.
+     * @param data The data
+     * @return false if the data cannot be decompressed or the fallback file cannot be written
+     */
+    bool write(const QByteArray &data);
+
+    /**
+     * Signal the end of the data.
+     * @return false if the data cannot be decompressed or the fallback file cannot be written
+     */
+    bool finish();
+
+    /// Get the format of the data, it is known after the first few bytes
+    Format format() const
+    {
+        return fmt;
+    }
+
+    /// Get the parser with the results
+    BlockListParser &parser()
+    {
+        return blocklist_parser;
+    }
+
+    /// Get the number of bytes of decompressed data
+    bt::Uint64 decompressedSize() const
+    {
+        return decompressed;
+    }
+
+private:
+    bool detectFormat();
+    bool process(const char *data, bt::Uint64 size);
+    bool decompress(const char *data, bt::Uint64 size);
+
+private:
+    Format fmt;
+    QByteArray head; // data received before the format is known
+    QFile fallback;
+    QScopedPointer<KFilterBase> filter;
+    bool header_read;
+    bool end_of_stream;
+    bt::Uint64 decompressed;
+    BlockListParser blocklist_parser;
+};
+
+}
+
+#endif
@@ -51,6 +51,11 @@ void ConvertDialog::progress(int val, int total)
     max = total;
 }
 
+void ConvertDialog::setInput(const QList<BlockListSource> &sources)
+{
+    this->sources = sources;
+}
+
 void ConvertDialog::update()
 {
     QMutexLocker lock(&mutex);
@@ -65,6 +70,8 @@ void ConvertDialog::convert()
         return;
 
     convert_thread = new ConvertThread(this);
+    convert_thread->setInput(sources);
+    sources.clear();
     connect(convert_thread, &ConvertThread::finished, this, &ConvertDialog::threadFinished, Qt::QueuedConnection);
     convert_thread->start();
     timer.start(500);
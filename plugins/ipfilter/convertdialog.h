@@ -12,6 +12,7 @@
 #include <QThread>
 #include <QTimer>
 
+#include "blocklistparser.h"
 #include "ui_convertdialog.h"
 
 namespace kt
@@ -38,6 +39,13 @@ public:
      */
     void progress(int val, int total);
 
+    /**
+     * Set the block lists to convert into one filter file.
+     * Must be called before the conversion starts.
+     * @param sources The block lists
+     */
+    void setInput(const QList<BlockListSource> &sources);
+
 private Q_SLOTS:
     void convert();
     void threadFinished();
@@ -54,6 +62,7 @@ private:
     QMutex mutex;
     QTimer timer;
     bool canceled;
+    QList<BlockListSource> sources;
 };
 }
 #endif
@@ -4,24 +4,25 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 
-#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <errno.h>
-#include <regex>
-#include <string>
+#include <vector>
 
 #include <QFile>
-#include <QTextStream>
-#include <QTimer>
+#include <QFileInfo>
 
 #include <KIO/Job>
 #include <KLocalizedString>
 
+#include "blocklistparser.h"
 #include "convertdialog.h"
 #include "convertthread.h"
 #include <interfaces/functions.h>
 #include <util/constants.h>
 #include <util/fileops.h>
 #include <util/log.h>
+#include <util/mmapfile.h>
 
 using namespace bt;
 
@@ -31,9 +32,8 @@ ConvertThread::ConvertThread(ConvertDialog *dlg)
     : dlg(dlg)
     , abort(false)
 {
-    txt_file = kt::DataDir() + QStringLiteral("level1.txt");
     dat_file = kt::DataDir() + QStringLiteral("level1.dat");
-    tmp_file = kt::DataDir() + QStringLiteral("level1.dat.tmp");
+    tmp_file = kt::DataDir() + QStringLiteral("level1.dat.new");
 }
 
 ConvertThread::~ConvertThread()
@@ -42,118 +42,192 @@ ConvertThread::~ConvertThread()
 
 void ConvertThread::run()
 {
-    readInput();
+    if (sources.count() > int(IPBLOCKLIST_MAX_SOURCES)) {
+        failure_reason = i18n("Too many block lists, at most %1 can be used", IPBLOCKLIST_MAX_SOURCES);
+        return;
+    }
+
+    for (BlockListSource &source : sources) {
+        if (!source.file.isEmpty() && (!readInput(source) || abort))
+            return;
+    }
     writeOutput();
 }
 
-void ConvertThread::readInput()
+bool ConvertThread::readInput(BlockListSource &src)
 {
     /*    READ INPUT FILE  */
-    QFile source(txt_file);
-    if (!source.open(QIODevice::ReadOnly)) {
+    const QString &txt_file = src.file;
+    QFileInfo info(txt_file);
+    if (info.exists() && info.size() == 0) {
+        // Empty files cannot be mapped, but there is nothing to convert either
+        return true;
+    }
+
+    MMapFile source;
+    if (!source.open(txt_file, QIODevice::ReadOnly)) {
         Out(SYS_IPF | LOG_IMPORTANT) << "Cannot find level1.txt file" << endl;
         failure_reason = i18n("Cannot open %1: %2", txt_file, QString::fromLatin1(strerror(errno)));
-        return;
+        return false;
     }
 
     Out(SYS_IPF | LOG_NOTICE) << "Loading " << txt_file << " ..." << endl;
     dlg->message(i18n("Loading txt file..."));
 
-    ulong source_size = source.size();
-    QTextStream stream(&source);
-
-    int i = 0;
-    const std::regex rx("(?:[0-9]{1,3}\\.){3}[0-9]{1,3}");
-
-    while (!stream.atEnd() && !abort) {
-        std::string line = stream.readLine().toStdString();
-        i += line.length() * sizeof(char); // rough estimation of string size
-        dlg->progress(i, source_size);
-        ++i;
-
-        std::vector<std::string> addresses;
-        for (auto it = std::sregex_iterator(line.begin(), line.end(), rx); it != std::sregex_iterator(); ++it) {
-            addresses.push_back(it->str());
-        }
-
-        // if we have found two addresses, create a block out of it
-        if (addresses.size() == 2) {
-            input += IPBlock(QString::fromStdString(addresses[0]), QString::fromStdString(addresses[1]));
-        }
-    }
+    BlockListParser parser;
+    parser.parseParallel(reinterpret_cast<const char *>(source.getData(0)),
+                         source.getSize(),
+                         [this](Uint64 parsed, Uint64 total) {
+                             // progress works with ints, so report in KiB
+                             dlg->progress(parsed / 1024, total / 1024);
+                         },
+                         &abort);
     source.close();
-    Out(SYS_IPF | LOG_NOTICE) << "Loaded " << input.count() << " lines" << endl;
+
+    src.blocks = parser.blocks();
+    src.blocks6 = parser.blocks6();
+    Out(SYS_IPF | LOG_NOTICE) << "Loaded " << src.blocks.count() << " IPv4 and " << src.blocks6.count() << " IPv6 ranges from " << parser.numLines()
+                              << " lines" << endl;
     dlg->progress(100, 100);
+    return true;
 }
 
-static bool LessThan(const IPBlock &a, const IPBlock &b)
+void ConvertThread::sort()
 {
-    if (a.ip1 == b.ip1)
-        return a.ip2 < b.ip2;
-    else
-        return a.ip1 < b.ip1;
+    for (BlockListSource &source : sources) {
+        SortBlocks(source.blocks);
+        SortBlocks(source.blocks6);
+    }
 }
 
-void ConvertThread::sort()
+void ConvertThread::merge()
 {
-    std::sort(input.begin(), input.end(), LessThan);
+    // Merge the blocks within every source, and then the sources with each other
+    for (BlockListSource &source : sources) {
+        MergeBlocks(source.blocks);
+        MergeBlocks(source.blocks6);
+    }
+
+    MergeSources(sources, input, masks);
+    MergeSources(sources, input6, masks6);
 }
 
-void ConvertThread::merge()
+template<class T>
+bool ConvertThread::writeArray(QFile &target, const std::vector<T> &data)
 {
-    if (input.count() < 2) // noting to merge
-        return;
+    // Write the data in chunks
+    const int chunk_size = 1024;
+    int tot = data.size();
+    for (int i = 0; i < tot; i += chunk_size) {
+        dlg->progress(i, tot);
+        int n = qMin(chunk_size, tot - i);
+        if (target.write((const char *)(data.data() + i), n * sizeof(T)) != qint64(n * sizeof(T))) {
+            failure_reason = i18n("Cannot write to %1: %2", tmp_file, target.errorString());
+            return false;
+        }
 
-    QList<IPBlock>::iterator i = input.begin();
-    QList<IPBlock>::iterator j = i;
-    j++;
-    while (j != input.end() && i != input.end()) {
-        IPBlock &a = *i;
-        IPBlock &b = *j;
-        if (a.ip2 < b.ip1 || b.ip2 < a.ip1) {
-            // separate ranges, so go to the next pair
-            i = j;
-            j++;
-        } else {
-            // merge b into a
-            a.ip1 = (a.ip1 < b.ip1) ? a.ip1 : b.ip1;
-            a.ip2 = (a.ip2 > b.ip2) ? a.ip2 : b.ip2;
-
-            // remove b
-            j = input.erase(j);
+        if (abort) {
+            return false;
         }
     }
+    return true;
 }
 
 void ConvertThread::writeOutput()
 {
-    if (input.count() == 0) {
-        failure_reason = i18n("There are no IP addresses to convert in %1", txt_file);
-        return;
-    }
-
     sort(); // sort the block
     merge(); // merge neighbouring blocks
 
-    QFile target(dat_file);
+    if (input.count() == 0 && input6.count() == 0) {
+        failure_reason = i18n("There are no IP addresses to convert");
+        return;
+    }
+
+    // Write to a new file, and only replace level1.dat when it is complete, the
+    // old level1.dat may still be memory mapped and in use by the plugin
+    QFile target(tmp_file);
     if (!target.open(QIODevice::WriteOnly)) {
         Out(SYS_IPF | LOG_IMPORTANT) << "Unable to open file for writing" << endl;
-        failure_reason = i18n("Cannot open %1: %2", dat_file, QString::fromLatin1(strerror(errno)));
+        failure_reason = i18n("Cannot open %1: %2", tmp_file, QString::fromLatin1(strerror(errno)));
         return;
     }
 
     Out(SYS_IPF | LOG_NOTICE) << "Loading finished, starting conversion..." << endl;
     dlg->message(i18n("Converting..."));
 
-    int i = 0;
-    int tot = input.count();
-    for (const IPBlock &block : std::as_const(input)) {
-        dlg->progress(i, tot);
-        target.write((char *)&block, sizeof(IPBlock));
-        if (abort) {
-            return;
-        }
-        i++;
+    IPBlockListHeader hdr;
+    memset(&hdr, 0, sizeof(IPBlockListHeader));
+    memcpy(hdr.magic, IPBLOCKLIST_MAGIC, sizeof(IPBLOCKLIST_MAGIC));
+    hdr.version = IPBLOCKLIST_VERSION;
+
+    // The source masks are stored per slot of the nodes, so they can be looked up with the result of find
+    std::vector<RangeIndexNode> nodes(RangeIndex::numNodes(input.count()));
+    std::vector<Uint32> slot_masks(nodes.size() * RangeIndexNode::KEYS, 0);
+    const IPBlock *blocks = input.constData();
+    const Uint32 *block_masks = masks.constData();
+    hdr.num_blocks = input.count();
+    hdr.max_end = RangeIndex::build(
+        nodes.data(),
+        input.count(),
+        [blocks](Uint32 i, Uint32 &start, Uint32 &end) {
+            start = blocks[i].ip1;
+            end = blocks[i].ip2;
+        },
+        [&slot_masks, block_masks](Uint32 i, Uint32 slot) {
+            slot_masks[slot] = block_masks[i];
+        });
+
+    std::vector<RangeIndex6Node> nodes6(RangeIndex6::numNodes(input6.count()));
+    std::vector<Uint32> slot_masks6(nodes6.size() * RangeIndex6Node::KEYS, 0);
+    const IPBlock6 *blocks6 = input6.constData();
+    const Uint32 *block_masks6 = masks6.constData();
+    hdr.num_blocks6 = input6.count();
+    hdr.max_end6 = RangeIndex6::build(
+        nodes6.data(),
+        input6.count(),
+        [blocks6](Uint32 i, Uint128 &start, Uint128 &end) {
+            start = blocks6[i].ip1;
+            end = blocks6[i].ip2;
+        },
+        [&slot_masks6, block_masks6](Uint32 i, Uint32 slot) {
+            slot_masks6[slot] = block_masks6[i];
+        });
+
+    std::vector<IPBlockListSource> source_table(sources.count());
+    memset(source_table.data(), 0, source_table.size() * sizeof(IPBlockListSource));
+    for (int i = 0; i < sources.count(); i++) {
+        const QByteArray name = sources[i].name.toUtf8();
+        source_table[i].num_blocks = sources[i].blocks.count();
+        source_table[i].num_blocks6 = sources[i].blocks6.count();
+        memcpy(source_table[i].name, name.constData(), qMin<size_t>(name.size(), sizeof(source_table[i].name) - 1));
+    }
+
+    hdr.num_sources = sources.count();
+    hdr.checksum = IPBlockList::checksum(nodes.data(), nodes.size() * sizeof(RangeIndexNode));
+    hdr.checksum = IPBlockList::checksum(nodes6.data(), nodes6.size() * sizeof(RangeIndex6Node), hdr.checksum);
+    hdr.checksum = IPBlockList::checksum(slot_masks.data(), slot_masks.size() * sizeof(Uint32), hdr.checksum);
+    hdr.checksum = IPBlockList::checksum(slot_masks6.data(), slot_masks6.size() * sizeof(Uint32), hdr.checksum);
+    hdr.checksum = IPBlockList::checksum(source_table.data(), source_table.size() * sizeof(IPBlockListSource), hdr.checksum);
+    target.write((const char *)&hdr, sizeof(IPBlockListHeader));
+    if (!writeArray(target, nodes) || !writeArray(target, nodes6) || !writeArray(target, slot_masks) || !writeArray(target, slot_masks6)
+        || !writeArray(target, source_table)) {
+        target.remove();
+        return;
     }
+
+    target.close();
+
+    // Read back what we wrote, so that we don't end up with a broken filter
+    IPBlockList written;
+    if (!written.load(tmp_file) || !written.verify()) {
+        Out(SYS_IPF | LOG_IMPORTANT) << "Verification of " << tmp_file << " failed" << endl;
+        failure_reason = i18n("Verification of %1 failed", tmp_file);
+        target.remove();
+    } else if (rename(QFile::encodeName(tmp_file).constData(), QFile::encodeName(dat_file).constData()) != 0) {
+        // rename replaces level1.dat atomically, anybody who has the old one mapped keeps it
+        failure_reason = i18n("Cannot write to %1: %2", dat_file, QString::fromLatin1(strerror(errno)));
+        target.remove();
+    }
+    dlg->progress(100, 100);
 }
 }
@@ -7,8 +7,13 @@
 #ifndef KTCONVERTTHREAD_H
 #define KTCONVERTTHREAD_H
 
+#include "blocklistparser.h"
 #include "ipblocklist.h"
 #include <QThread>
+#include <atomic>
+#include <vector>
+
+class QFile;
 
 namespace kt
 {
@@ -36,20 +41,32 @@ public:
         abort = true;
     }
 
+    /// Set the block lists to convert, the ones with a file are read by the thread
+    void setInput(const QList<BlockListSource> &input)
+    {
+        sources = input;
+    }
+
 private:
-    void readInput();
+    bool readInput(BlockListSource &src);
     void writeOutput();
     void cleanUp(bool failed);
     void sort();
     void merge();
 
+    template<class T>
+    bool writeArray(QFile &target, const std::vector<T> &data);
+
 private:
     ConvertDialog *dlg;
-    bool abort;
-    QString txt_file;
+    std::atomic<bool> abort;
     QString dat_file;
     QString tmp_file;
+    QList<BlockListSource> sources;
     QList<IPBlock> input;
+    QList<IPBlock6> input6;
+    QList<bt::Uint32> masks;
+    QList<bt::Uint32> masks6;
     QString failure_reason;
 };
 
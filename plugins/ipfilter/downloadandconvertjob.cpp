@@ -9,10 +9,12 @@
 
 #include <KIO/FileCopyJob>
 #include <KIO/JobUiDelegate>
+#include <KIO/TransferJob>
 #include <KLocalizedString>
 #include <KMessageBox>
 #include <KZip>
 
+#include "blockliststream.h"
 #include "convertdialog.h"
 #include "downloadandconvertjob.h"
 #include <interfaces/functions.h>
@@ -27,26 +29,117 @@ using namespace bt;
 
 namespace kt
 {
-DownloadAndConvertJob::DownloadAndConvertJob(const QUrl &url, Mode mode)
-    : url(url)
+DownloadAndConvertJob::DownloadAndConvertJob(const QList<QUrl> &urls, Mode mode)
+    : urls(urls)
+    , current(0)
+    , active_job(nullptr)
     , unzip(false)
     , convert_dlg(nullptr)
     , mode(mode)
+    , stream_error(false)
 {
+    // Data must be processed in order, so only one thread
+    stream_pool.setMaxThreadCount(1);
 }
 
 DownloadAndConvertJob::~DownloadAndConvertJob()
 {
+    stopStream();
 }
 
 void DownloadAndConvertJob::start()
 {
-    QString temp = kt::DataDir() + QStringLiteral("tmp-") + url.fileName();
+    current = 0;
+    sources.clear();
+    startDownload();
+}
+
+QString DownloadAndConvertJob::tempFile() const
+{
+    return kt::DataDir() + QStringLiteral("tmp-%1-").arg(current) + url.fileName();
+}
+
+QString DownloadAndConvertJob::textFile() const
+{
+    return kt::DataDir() + QStringLiteral("level1-%1.txt").arg(current);
+}
+
+void DownloadAndConvertJob::startDownload()
+{
+    url = urls.at(current);
+    unzip = false;
+    QString temp = tempFile();
     if (bt::Exists(temp))
         bt::Delete(temp, true);
 
-    active_job = KIO::file_copy(url, QUrl::fromLocalFile(temp), -1, KIO::Overwrite);
-    connect(active_job, &KJob::result, this, &DownloadAndConvertJob::downloadFileFinished);
+    // Parse the data as it comes in, temp is only written if the file is not a (compressed) text file
+    stream.reset(new BlockListStream(temp));
+    stream_error = false;
+    KIO::TransferJob *job = KIO::get(url, KIO::NoReload);
+    connect(job, &KIO::TransferJob::data, this, &DownloadAndConvertJob::dataReceived);
+    connect(job, &KJob::result, this, &DownloadAndConvertJob::downloadFileFinished);
+    active_job = job;
+}
+
+void DownloadAndConvertJob::dataReceived(KIO::Job *job, const QByteArray &data)
+{
+    if (job != active_job || data.isEmpty())
+        return;
+
+    if (stream_error) {
+        active_job = nullptr;
+        job->kill(KJob::Quietly);
+        streamFailed();
+        return;
+    }
+
+    // Decompressing and parsing is done by the worker, so the GUI stays responsive
+    BlockListStream *s = stream.data();
+    stream_pool.start([this, s, data]() {
+        if (!stream_error && !s->write(data))
+            stream_error = true;
+    });
+}
+
+void DownloadAndConvertJob::stopStream()
+{
+    // Skip the data which is still queued, and wait until the worker is done with the stream
+    stream_error = true;
+    stream_pool.clear();
+    stream_pool.waitForDone();
+    stream.reset();
+}
+
+void DownloadAndConvertJob::streamFinished(bool ok)
+{
+    if (!ok) {
+        streamFailed();
+        return;
+    }
+
+    if (stream->format() != BlockListStream::OTHER) {
+        Out(SYS_IPF | LOG_NOTICE) << "Parsed " << stream->decompressedSize() << " bytes of block list while downloading" << endl;
+        sourceFinished(QString());
+        return;
+    }
+
+    stream.reset();
+    handleDownloadedFile(tempFile());
+}
+
+void DownloadAndConvertJob::streamFailed()
+{
+    QString msg = i18n("Cannot decompress or store the block list downloaded from %1", url.toDisplayString());
+    Out(SYS_IPF | LOG_NOTICE) << "IP filter update failed: " << msg << endl;
+    if (mode == Verbose)
+        KMessageBox::error(nullptr, msg);
+    else
+        Q_EMIT notification(i18n("Automatic update of IP filter failed: %1", msg));
+
+    stopStream();
+    cleanUpFiles();
+    setError(UNZIP_FAILED);
+    emitResult();
 }
 
 void DownloadAndConvertJob::kill(KJob::KillVerbosity)
@@ -68,9 +161,28 @@ void DownloadAndConvertJob::convert(KJob *j)
             QString msg = i18n("Automatic update of IP filter failed: %1", j->errorString());
             Q_EMIT notification(msg);
         }
+        cleanUpFiles();
         setError(unzip ? UNZIP_FAILED : MOVE_FAILED);
         emitResult();
     } else
+        sourceFinished(textFile());
+}
+
+void DownloadAndConvertJob::sourceFinished(const QString &file)
+{
+    BlockListSource source;
+    source.name = url.toDisplayString();
+    source.file = file;
+    if (stream) {
+        source.blocks = stream->parser().blocks();
+        source.blocks6 = stream->parser().blocks6();
+        stream.reset();
+    }
+    sources.append(source);
+
+    if (++current < urls.count())
+        startDownload();
+    else
         convert();
 }
 
@@ -103,13 +215,28 @@ void DownloadAndConvertJob::downloadFileFinished(KJob *j)
             Q_EMIT notification(msg);
         }
 
+        stopStream();
+        cleanUpFiles();
         setError(DOWNLOAD_FAILED);
         emitResult();
         return;
     }
 
-    QString temp = kt::DataDir() + QStringLiteral("tmp-") + url.fileName();
+    // Finish after the data which is still queued, and continue on this thread
+    BlockListStream *s = stream.data();
+    stream_pool.start([this, s]() {
+        const bool ok = !stream_error && s->finish();
+        QMetaObject::invokeMethod(
+            this,
+            [this, ok]() {
+                streamFinished(ok);
+            },
+            Qt::QueuedConnection);
+    });
+}
 
+void DownloadAndConvertJob::handleDownloadedFile(const QString &temp)
+{
     // now determine if it's ZIP or TXT file
     QMimeDatabase db;
     QMimeType ptr = db.mimeTypeForFile(temp, QMimeDatabase::MatchContent);
@@ -127,15 +254,16 @@ void DownloadAndConvertJob::downloadFileFinished(KJob *j)
         else
             Q_EMIT notification(msg);
 
+        cleanUpFiles();
         setError(UNZIP_FAILED);
         emitResult();
     } else if (ptr.name() == QStringLiteral("application/gzip") || ptr.name() == QStringLiteral("application/x-bzip")) {
-        active_job = new bt::DecompressFileJob(temp, kt::DataDir() + QStringLiteral("level1.txt"));
+        active_job = new bt::DecompressFileJob(temp, textFile());
         connect(active_job, &KJob::result, this, qOverload<KJob *>(&DownloadAndConvertJob::convert));
         active_job->start();
     } else if (!isBinaryData(temp) || ptr.name() == QStringLiteral("text/plain")) {
         active_job = KIO::file_move(QUrl::fromLocalFile(temp),
-                                    QUrl::fromLocalFile(kt::DataDir() + QStringLiteral("level1.txt")),
+                                    QUrl::fromLocalFile(textFile()),
                                     -1,
                                     KIO::HideProgressInfo | KIO::Overwrite);
         connect(active_job, &KJob::result, this, qOverload<KJob *>(&DownloadAndConvertJob::convert));
@@ -146,6 +274,7 @@ void DownloadAndConvertJob::downloadFileFinished(KJob *j)
         else
             Q_EMIT notification(msg);
 
+        cleanUpFiles();
         setError(UNZIP_FAILED);
         emitResult();
     }
@@ -162,6 +291,7 @@ void DownloadAndConvertJob::extract(KJob *j)
             QString msg = i18n("Automatic update of IP filter failed: %1", j->errorString());
             Q_EMIT notification(msg);
         }
+        cleanUpFiles();
         setError(MOVE_FAILED);
         emitResult();
         return;
@@ -178,13 +308,14 @@ void DownloadAndConvertJob::extract(KJob *j)
             Q_EMIT notification(msg);
         }
 
+        delete zip;
+        cleanUpFiles();
         setError(UNZIP_FAILED);
         emitResult();
-        delete zip;
         return;
     }
 
-    QString destination = kt::DataDir() + QStringLiteral("level1.txt");
+    QString destination = textFile();
     QStringList entries = zip->directory()->entries();
     if (entries.count() >= 1) {
         active_job = new bt::ExtractFileJob(zip, entries.front(), destination);
@@ -200,38 +331,10 @@ void DownloadAndConvertJob::extract(KJob *j)
             Q_EMIT notification(msg);
         }
 
-        setError(UNZIP_FAILED);
-        emitResult();
         delete zip;
-    }
-}
-
-void DownloadAndConvertJob::revertBackupFinished(KJob *)
-{
-    active_job = nullptr;
-    cleanUpFiles();
-    setError(CANCELED);
-    emitResult();
-}
-
-void DownloadAndConvertJob::makeBackupFinished(KJob *j)
-{
-    if (j && j->error()) {
-        Out(SYS_IPF | LOG_NOTICE) << "IP filter update failed: " << j->errorString() << endl;
-        if (mode == Verbose) {
-            j->uiDelegate()->showErrorMessage();
-        } else {
-            QString msg = i18n("Automatic update of IP filter failed: %1", j->errorString());
-            Q_EMIT notification(msg);
-        }
-        setError(BACKUP_FAILED);
+        cleanUpFiles();
+        setError(UNZIP_FAILED);
         emitResult();
-    } else {
-        convert_dlg = new ConvertDialog(nullptr);
-        if (mode == Verbose)
-            convert_dlg->show();
-        connect(convert_dlg, &ConvertDialog::accepted, this, &DownloadAndConvertJob::convertAccepted);
-        connect(convert_dlg, &ConvertDialog::rejected, this, &DownloadAndConvertJob::convertRejected);
     }
 }
 
@@ -248,31 +351,22 @@ void DownloadAndConvertJob::convertRejected()
 {
     convert_dlg->deleteLater();
     convert_dlg = nullptr;
-    // shit happened move back backup stuff
-    QString dat_file = kt::DataDir() + QStringLiteral("level1.dat");
-    QString tmp_file = kt::DataDir() + QStringLiteral("level1.dat.tmp");
-
-    if (bt::Exists(tmp_file)) {
-        active_job = KIO::file_copy(QUrl::fromLocalFile(tmp_file), QUrl::fromLocalFile(dat_file), -1, KIO::HideProgressInfo | KIO::Overwrite);
-        connect(active_job, &KJob::result, this, &DownloadAndConvertJob::revertBackupFinished);
-    } else {
-        cleanUpFiles();
-        setError(CANCELED);
-        emitResult();
-    }
+    // level1.dat is only replaced when the conversion succeeds, so there is nothing to restore
+    cleanUpFiles();
+    setError(CANCELED);
+    emitResult();
 }
 
 void DownloadAndConvertJob::convert()
 {
-    if (bt::Exists(kt::DataDir() + QStringLiteral("level1.dat"))) {
-        // make backup of data file, if stuff fails we can always go back
-        QString dat_file = kt::DataDir() + QStringLiteral("level1.dat");
-        QString tmp_file = kt::DataDir() + QStringLiteral("level1.dat.tmp");
-
-        KIO::Job *job = KIO::file_copy(QUrl::fromLocalFile(dat_file), QUrl::fromLocalFile(tmp_file), -1, KIO::HideProgressInfo | KIO::Overwrite);
-        connect(job, &KIO::Job::result, this, &DownloadAndConvertJob::makeBackupFinished);
-    } else
-        makeBackupFinished(nullptr);
+    // Sources which have already been parsed only need to be sorted, merged and written
+    convert_dlg = new ConvertDialog(nullptr);
+    convert_dlg->setInput(sources);
+    sources.clear();
+    if (mode == Verbose)
+        convert_dlg->show();
+    connect(convert_dlg, &ConvertDialog::accepted, this, &DownloadAndConvertJob::convertAccepted);
+    connect(convert_dlg, &ConvertDialog::rejected, this, &DownloadAndConvertJob::convertRejected);
 }
 
 void DownloadAndConvertJob::cleanUpFiles()
@@ -280,8 +374,13 @@ void DownloadAndConvertJob::cleanUpFiles()
     // cleanup temp files
     cleanUp(kt::DataDir() + QStringLiteral("level1.zip"));
     cleanUp(kt::DataDir() + QStringLiteral("level1.txt"));
+    for (int i = 0; i < urls.count(); i++) {
+        cleanUp(kt::DataDir() + QStringLiteral("level1-%1.txt").arg(i));
+        cleanUp(kt::DataDir() + QStringLiteral("tmp-%1-").arg(i) + urls.at(i).fileName());
+    }
     cleanUp(kt::DataDir() + QStringLiteral("level1.tmp"));
     cleanUp(kt::DataDir() + QStringLiteral("level1.dat.tmp"));
+    cleanUp(kt::DataDir() + QStringLiteral("level1.dat.new"));
 }
 
 void DownloadAndConvertJob::cleanUp(const QString &path)
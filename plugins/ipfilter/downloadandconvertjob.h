@@ -7,14 +7,28 @@
 #ifndef KTDOWNLOADANDCONVERTJOB_H
 #define KTDOWNLOADANDCONVERTJOB_H
 
+#include <atomic>
+
 #include <KIO/Job>
+#include <QList>
+#include <QScopedPointer>
+#include <QThreadPool>
+
+#include "blocklistparser.h"
 
 namespace kt
 {
 class ConvertDialog;
+class BlockListStream;
 
 /**
-    Job to download and convert a filter file
+    Job to download and convert one or more filter files into one filter
+
+    The files are downloaded one after the other. Plain text, gzip and bzip2
+    files are decompressed and parsed while they are being downloaded, on a
+    worker thread which gets the data in the order it arrives. Other
+    files (zip) are downloaded first and extracted, and then parsed by the
+    ConvertThread.
 */
 class DownloadAndConvertJob : public KIO::Job
 {
@@ -24,7 +38,7 @@ public:
         Verbose,
         Quietly,
     };
-    DownloadAndConvertJob(const QUrl &url, Mode mode);
+    DownloadAndConvertJob(const QList<QUrl> &urls, Mode mode);
     ~DownloadAndConvertJob() override;
 
     enum ErrorCode {
@@ -48,25 +62,38 @@ Q_SIGNALS:
     void notification(const QString &msg);
 
 private Q_SLOTS:
+    void dataReceived(KIO::Job *job, const QByteArray &data);
     void downloadFileFinished(KJob *);
     void convert(KJob *);
     void extract(KJob *);
-    void makeBackupFinished(KJob *);
-    void revertBackupFinished(KJob *);
     void convertAccepted();
     void convertRejected();
 
 private:
+    void startDownload();
+    void sourceFinished(const QString &file);
+    QString tempFile() const;
+    QString textFile() const;
+    void handleDownloadedFile(const QString &temp);
+    void streamFinished(bool ok);
+    void streamFailed();
+    void stopStream();
     void convert();
     void cleanUp(const QString &path);
     void cleanUpFiles();
 
 private:
+    QList<QUrl> urls;
+    int current; // index of the url being downloaded
     QUrl url;
+    QList<BlockListSource> sources;
     KJob *active_job;
     bool unzip;
     ConvertDialog *convert_dlg;
     Mode mode;
+    QScopedPointer<BlockListStream> stream;
+    QThreadPool stream_pool; // one thread, which feeds the data to stream
+    std::atomic<bool> stream_error;
 };
 
 }
@@ -7,6 +7,7 @@
 
 #include "downloadandconvertjob.h"
 #include "ipblockingprefpage.h"
+#include "ipblocklist.h"
 #include "ipfilterplugin.h"
 #include "ipfilterpluginsettings.h"
 #include <util/log.h>
@@ -37,11 +38,13 @@ void IPBlockingPrefPage::checkUseLevel1Toggled(bool check)
 {
     if (check) {
         kcfg_filterURL->setEnabled(true);
+        kcfg_additionalFilterURLs->setEnabled(true);
         m_download->setEnabled(true);
         m_plugin->loadAntiP2P();
     } else {
         m_status->setText(QString());
         kcfg_filterURL->setEnabled(false);
+        kcfg_additionalFilterURLs->setEnabled(false);
         m_download->setEnabled(false);
         m_plugin->unloadAntiP2P();
     }
@@ -52,6 +55,7 @@ void IPBlockingPrefPage::checkUseLevel1Toggled(bool check)
         m_status->setText(i18n("Status: Not loaded."));
 
     updateAutoUpdate();
+    updateSources();
 }
 
 void IPBlockingPrefPage::loadDefaults()
@@ -73,6 +77,7 @@ void IPBlockingPrefPage::loadSettings()
             m_status->setText(i18n("Status: Not loaded."));
 
         kcfg_filterURL->setEnabled(true);
+        kcfg_additionalFilterURLs->setEnabled(true);
         m_download->setEnabled(true);
         m_last_updated->clear();
         m_next_update->clear();
@@ -81,6 +86,7 @@ void IPBlockingPrefPage::loadSettings()
     } else {
         m_status->setText(i18n("Status: Not loaded."));
         kcfg_filterURL->setEnabled(false);
+        kcfg_additionalFilterURLs->setEnabled(false);
         m_download->setEnabled(false);
         m_last_updated->clear();
         m_next_update->clear();
@@ -89,20 +95,29 @@ void IPBlockingPrefPage::loadSettings()
     }
 
     updateAutoUpdate();
+    updateSources();
 }
 
 void IPBlockingPrefPage::downloadClicked()
 {
-    QUrl url = kcfg_filterURL->url();
+    QList<QUrl> urls;
+    urls << kcfg_filterURL->url();
+    const QStringList additional = kcfg_additionalFilterURLs->items();
+    for (const QString &str : additional) {
+        QUrl url = QUrl::fromUserInput(str.trimmed());
+        if (url.isValid() && !urls.contains(url))
+            urls << url;
+    }
 
     // block GUI so you cannot do stuff during conversion
     m_download->setEnabled(false);
     m_status->setText(i18n("Status: Downloading and converting new block list..."));
     kcfg_useLevel1->setEnabled(false);
     kcfg_filterURL->setEnabled(false);
+    kcfg_additionalFilterURLs->setEnabled(false);
 
-    m_plugin->unloadAntiP2P();
-    m_job = new DownloadAndConvertJob(url, m_verbose ? DownloadAndConvertJob::Verbose : DownloadAndConvertJob::Quietly);
+    // Keep filtering with the current list while the new one is downloaded and converted
+    m_job = new DownloadAndConvertJob(urls, m_verbose ? DownloadAndConvertJob::Verbose : DownloadAndConvertJob::Quietly);
     connect(m_job, &DownloadAndConvertJob::result, this, &IPBlockingPrefPage::downloadAndConvertFinished);
     connect(m_job, &DownloadAndConvertJob::notification, m_plugin, &IPFilterPlugin::notification);
     m_job->start();
@@ -129,11 +144,28 @@ void IPBlockingPrefPage::restoreGUI()
     m_download->setEnabled(true);
     kcfg_useLevel1->setEnabled(true);
     kcfg_filterURL->setEnabled(true);
+    kcfg_additionalFilterURLs->setEnabled(true);
 
     if (m_plugin->loadedAndRunning())
         m_status->setText(i18n("Status: Loaded and running."));
     else
         m_status->setText(i18n("Status: Not loaded."));
+    updateSources();
+}
+
+void IPBlockingPrefPage::updateSources()
+{
+    m_sources->clear();
+    const IPBlockList *list = m_plugin->filterList();
+    if (!list)
+        return;
+
+    for (Uint32 i = 0; i < list->numSources(); i++) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(m_sources);
+        item->setText(0, list->sourceName(i));
+        item->setText(1, QString::number(list->sourceCount(i) + list->sourceCount6(i)));
+        item->setText(2, QString::number(list->sourceHits(i)));
+    }
 }
 
 void IPBlockingPrefPage::downloadAndConvertFinished(KJob *j)
@@ -153,7 +185,10 @@ void IPBlockingPrefPage::downloadAndConvertFinished(KJob *j)
     g.sync();
 
     m_job = nullptr;
-    m_plugin->loadAntiP2P();
+    if (!j->error())
+        m_plugin->reloadAntiP2P(); // swap in the new list, the old one keeps working until then
+    else
+        m_plugin->loadAntiP2P();
     restoreGUI();
     updateAutoUpdate();
     Q_EMIT updateFinished();
@@ -47,6 +47,7 @@ private Q_SLOTS:
 
 private:
     void updateAutoUpdate();
+    void updateSources();
 
 Q_SIGNALS:
     void updateFinished();
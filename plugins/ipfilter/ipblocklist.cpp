@@ -5,9 +5,12 @@
 
 #include "ipblocklist.h"
 #include <QFile>
+#include <cstring>
 #include <net/address.h>
+#include <util/blockliststats.h>
 #include <util/constants.h>
 #include <util/log.h>
+#include <util/mmapfile.h>
 
 using namespace bt;
 
@@ -33,12 +36,6 @@ IPBlock::IPBlock()
 {
 }
 
-IPBlock::IPBlock(const IPBlock &block)
-    : ip1(block.ip1)
-    , ip2(block.ip2)
-{
-}
-
 IPBlock::IPBlock(const QString &start, const QString &end)
 {
     ip1 = StringToUint32(start);
@@ -46,65 +43,240 @@ IPBlock::IPBlock(const QString &start, const QString &end)
 }
 
 IPBlockList::IPBlockList()
+    : mapped_nodes(nullptr)
+    , mapped_size(0)
+    , expected_checksum(0)
+    , source_masks(nullptr)
+    , source_masks6(nullptr)
+    , sources(nullptr)
+    , num_sources(0)
+    , stats(nullptr)
+    , added_dirty(false)
 {
 }
 
 IPBlockList::~IPBlockList()
 {
+    unload();
 }
 
 bool IPBlockList::blocked(const net::Address &addr) const
 {
-    if (addr.protocol() == QAbstractSocket::IPv6Protocol || blocks.empty())
-        return false;
+    buildAdded();
+
+    BlockListStats::Lookup lookup(stats);
+    Uint32 slot = RangeIndex::NOT_FOUND;
+    if (addr.ipVersion() == 4 || addr.isIPv4Mapped()) {
+        slot = index.find(addr.ipVersion() == 4 ? addr.toIPv4Address() : addr.convertIPv4Mapped().toIPv4Address());
+        if (slot != RangeIndex::NOT_FOUND) {
+            if (source_masks)
+                countHit(source_masks[slot]);
+            if (stats) {
+                Uint32 start, end;
+                index.range(slot, start, end);
+                stats->addHit(Uint128::fromIPv4(start), Uint128::fromIPv4(end));
+            }
+        }
+    } else if (index6.count() > 0) {
+        Q_IPV6ADDR ip = addr.toIPv6Address();
+        slot = index6.find(Uint128::fromBytes(ip.c));
+        if (slot != RangeIndex6::NOT_FOUND) {
+            if (source_masks6)
+                countHit(source_masks6[slot]);
+            if (stats) {
+                Uint128 start, end;
+                index6.range(slot, start, end);
+                stats->addHit(start, end);
+            }
+        }
+    }
+
+    return slot != RangeIndex::NOT_FOUND;
+}
 
-    // Binary search the list of blocks which are sorted
-    quint32 ip = addr.toIPv4Address();
-    int begin = 0;
-    int end = blocks.size() - 1;
-    while (true) {
-        if (begin == end)
-            return blocks[begin].contains(ip);
-        else if (begin == end - 1)
-            return blocks[begin].contains(ip) || blocks[end].contains(ip);
-
-        int pivot = begin + (end - begin) / 2;
-        if (blocks[pivot].contains(ip))
-            return true;
-        else if (ip < blocks[pivot].ip1)
-            end = pivot - 1; // continue in the range [begin, pivot - 1]
-        else // ip > blocks[pivot].ip2
-            begin = pivot + 1; // continue in the range [pivot + 1, end]
+void IPBlockList::countHit(Uint32 mask) const
+{
+    // Hits are rare compared to lookups, so a relaxed atomic per source is cheap enough
+    for (Uint32 i = 0; i < num_sources; i++) {
+        if (mask & (1u << i))
+            hits[i].fetch_add(1, std::memory_order_relaxed);
     }
-    return false;
+}
+
+QString IPBlockList::sourceName(Uint32 source) const
+{
+    if (source >= num_sources)
+        return QString();
+
+    const char *name = sources[source].name;
+    return QString::fromUtf8(name, qstrnlen(name, sizeof(sources[source].name)));
+}
+
+Uint32 IPBlockList::sourceCount(Uint32 source) const
+{
+    return source < num_sources ? sources[source].num_blocks : 0;
+}
+
+Uint32 IPBlockList::sourceCount6(Uint32 source) const
+{
+    return source < num_sources ? sources[source].num_blocks6 : 0;
+}
+
+Uint64 IPBlockList::sourceHits(Uint32 source) const
+{
+    return source < num_sources ? hits[source].load(std::memory_order_relaxed) : 0;
 }
 
 bool IPBlockList::load(const QString &path)
 {
-    QFile file(path);
-    if (!file.open(QIODevice::ReadOnly)) {
-        Out(SYS_IPF | LOG_NOTICE) << "Cannot open " << path << ": " << file.errorString() << endl;
+    unload();
+
+    file.reset(new MMapFile());
+    if (!file->open(path, QIODevice::ReadOnly)) {
+        Out(SYS_IPF | LOG_NOTICE) << "Cannot open " << path << ": " << file->errorString() << endl;
+        file.reset();
         return false;
     }
 
-    // Note: the conversion process has sorted the blocks !
-    int num_blocks = file.size() / sizeof(IPBlock);
-    blocks.reserve(num_blocks);
-    while (!file.atEnd() && blocks.size() < num_blocks) {
-        IPBlock block;
-        if (file.read((char *)&block, sizeof(IPBlock)) == sizeof(IPBlock))
-            addBlock(block);
-        else
-            break;
+    const Uint64 size = file->getSize();
+    const Uint8 *data = file->getData(0);
+    const IPBlockListHeader *hdr = reinterpret_cast<const IPBlockListHeader *>(data);
+    if (size >= sizeof(IPBlockListHeader) && memcmp(hdr->magic, IPBLOCKLIST_MAGIC, sizeof(IPBLOCKLIST_MAGIC)) == 0) {
+        if (hdr->version != IPBLOCKLIST_VERSION) {
+            Out(SYS_IPF | LOG_NOTICE) << "Unsupported version " << hdr->version << " of " << path << ", the filter needs to be updated" << endl;
+            unload();
+            return false;
+        }
+
+        const Uint64 slots4 = (Uint64)RangeIndex::numNodes(hdr->num_blocks) * RangeIndexNode::KEYS;
+        const Uint64 slots6 = (Uint64)RangeIndex6::numNodes(hdr->num_blocks6) * RangeIndex6Node::KEYS;
+        const Uint64 size4 = slots4 / RangeIndexNode::KEYS * sizeof(RangeIndexNode);
+        const Uint64 size6 = slots6 / RangeIndex6Node::KEYS * sizeof(RangeIndex6Node);
+        const Uint64 masks_size = hdr->num_sources > 0 ? (slots4 + slots6) * sizeof(Uint32) : 0;
+        const Uint64 sources_size = (Uint64)hdr->num_sources * sizeof(IPBlockListSource);
+        if (hdr->num_sources > IPBLOCKLIST_MAX_SOURCES || sizeof(IPBlockListHeader) + size4 + size6 + masks_size + sources_size != size) {
+            Out(SYS_IPF | LOG_NOTICE) << "Corrupted filter file " << path << endl;
+            unload();
+            return false;
+        }
+
+        mapped_nodes = data + sizeof(IPBlockListHeader);
+        mapped_size = size - sizeof(IPBlockListHeader);
+        expected_checksum = hdr->checksum;
+        index.setNodes(reinterpret_cast<const RangeIndexNode *>(mapped_nodes), hdr->num_blocks, hdr->max_end);
+        index6.setNodes(reinterpret_cast<const RangeIndex6Node *>(mapped_nodes + size4), hdr->num_blocks6, hdr->max_end6);
+        if (hdr->num_sources > 0) {
+            source_masks = reinterpret_cast<const Uint32 *>(mapped_nodes + size4 + size6);
+            source_masks6 = source_masks + slots4;
+            sources = reinterpret_cast<const IPBlockListSource *>(mapped_nodes + size4 + size6 + masks_size);
+            num_sources = hdr->num_sources;
+            hits.reset(new std::atomic<Uint64>[num_sources]);
+            for (Uint32 i = 0; i < num_sources; i++)
+                hits[i] = 0;
+        }
+    } else if (size % sizeof(IPBlock) == 0) {
+        // Files converted by older versions are just the sorted blocks without a header
+        Out(SYS_IPF | LOG_NOTICE) << path << " has no header, it was converted by an older version" << endl;
+        buildIndex(reinterpret_cast<const IPBlock *>(data), size / sizeof(IPBlock));
+        file.reset();
+    } else {
+        Out(SYS_IPF | LOG_NOTICE) << "Corrupted filter file " << path << endl;
+        unload();
+        return false;
     }
 
-    Out(SYS_IPF | LOG_NOTICE) << "Loaded " << blocks.size() << " blocked IP ranges" << endl;
+    Out(SYS_IPF | LOG_NOTICE) << "Loaded " << index.count() << " blocked IPv4 ranges and " << index6.count() << " blocked IPv6 ranges from " << num_sources
+                              << " sources" << endl;
     return true;
 }
 
+bool IPBlockList::verify() const
+{
+    return !mapped_nodes || checksum(mapped_nodes, mapped_size) == expected_checksum;
+}
+
 void IPBlockList::addBlock(const IPBlock &block)
 {
-    blocks.append(block);
+    unloadFile();
+    added_blocks.append(block);
+    added_dirty = true;
+}
+
+void IPBlockList::addBlocks(const QList<IPBlock> &blocks)
+{
+    unloadFile();
+    added_blocks.append(blocks);
+    added_dirty = true;
+}
+
+void IPBlockList::addBlock(const IPBlock6 &block)
+{
+    unloadFile();
+    added_blocks6.append(block);
+    added_dirty = true;
+}
+
+void IPBlockList::addBlocks(const QList<IPBlock6> &blocks)
+{
+    unloadFile();
+    added_blocks6.append(blocks);
+    added_dirty = true;
+}
+
+void IPBlockList::buildAddedIndex() const
+{
+    QMutexLocker lock(&build_mutex);
+    if (!added_dirty.load(std::memory_order_relaxed))
+        return;
+
+    buildIndex(added_blocks.constData(), added_blocks.size());
+    const IPBlock6 *b = added_blocks6.constData();
+    index6.build(added_blocks6.size(), [b](Uint32 i, Uint128 &start, Uint128 &end) {
+        start = b[i].ip1;
+        end = b[i].ip2;
+    });
+    added_dirty.store(false, std::memory_order_release);
+}
+
+void IPBlockList::buildIndex(const IPBlock *blocks, Uint32 num_blocks) const
+{
+    index.build(num_blocks, [blocks](Uint32 i, Uint32 &start, Uint32 &end) {
+        start = blocks[i].ip1;
+        end = blocks[i].ip2;
+    });
+}
+
+void IPBlockList::unloadFile()
+{
+    if (file)
+        unload();
+}
+
+void IPBlockList::unload()
+{
+    index.clear();
+    index6.clear();
+    mapped_nodes = nullptr;
+    mapped_size = 0;
+    expected_checksum = 0;
+    source_masks = source_masks6 = nullptr;
+    sources = nullptr;
+    num_sources = 0;
+    hits.reset();
+    added_blocks.clear();
+    added_blocks6.clear();
+    added_dirty = false;
+    file.reset();
+}
+
+Uint32 IPBlockList::checksum(const void *data, Uint64 size, Uint32 hash)
+{
+    // 32 bit FNV-1a, applied to whole words instead of bytes
+    const Uint32 *words = reinterpret_cast<const Uint32 *>(data);
+    const Uint64 num_words = size / sizeof(Uint32);
+    for (Uint64 i = 0; i < num_words; i++)
+        hash = (hash ^ words[i]) * 16777619u;
+    return hash;
 }
 
 }
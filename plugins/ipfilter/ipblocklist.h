@@ -7,18 +7,30 @@
 #define ANTIP2P_H
 
 #include <QList>
+#include <QMutex>
+#include <QScopedPointer>
+#include <atomic>
+#include <memory>
 
 #include <interfaces/blocklistinterface.h>
 #include <util/constants.h>
+#include <util/rangeindex.h>
+
+namespace bt
+{
+class MMapFile;
+}
 
 namespace kt
 {
+class BlockListStats;
+
 struct IPBlock {
     bt::Uint32 ip1;
     bt::Uint32 ip2;
 
     IPBlock();
-    IPBlock(const IPBlock &block);
+    IPBlock(const IPBlock &block) = default;
     IPBlock(const QString &start, const QString &end);
 
     bool contains(bt::Uint32 ip) const
@@ -27,6 +39,63 @@ struct IPBlock {
     }
 };
 
+static_assert(sizeof(IPBlock) == 8, "IPBlock is stored as is in level1.dat");
+
+/// Range of IPv6 addresses
+struct IPBlock6 {
+    Uint128 ip1;
+    Uint128 ip2;
+
+    bool contains(const Uint128 &ip) const
+    {
+        return ip1 <= ip && ip <= ip2;
+    }
+};
+
+/// Magic at the start of a compiled level1.dat file
+const char IPBLOCKLIST_MAGIC[4] = {'K', 'T', 'B', 'L'};
+
+/// Version of the compiled level1.dat format
+const bt::Uint32 IPBLOCKLIST_VERSION = 4;
+
+/// Maximum number of block lists which can be merged into one filter file
+const bt::Uint32 IPBLOCKLIST_MAX_SOURCES = 32;
+
+/**
+ * Header of a compiled level1.dat file. It is followed by the nodes of a
+ * RangeIndex of the sorted and merged IPv4 blocks, and then by the nodes of
+ * a RangeIndex6 of the IPv6 blocks, in host byte order, so the file can be
+ * memory mapped and searched in place. The header is one cache line, which
+ * keeps the nodes aligned.
+ *
+ * If the file was built from one or more sources, the nodes are followed by a
+ * Uint32 bit mask of sources for every slot of the IPv4 nodes, the same for
+ * the IPv6 nodes, and an IPBlockListSource for every source.
+ */
+struct IPBlockListHeader {
+    char magic[4];
+    bt::Uint32 version;
+    bt::Uint32 num_blocks;
+    bt::Uint32 checksum; // checksum of everything following the header
+    bt::Uint32 max_end; // end of the last IPv4 block
+    bt::Uint32 num_blocks6;
+    bt::Uint32 num_sources;
+    bt::Uint32 reserved1;
+    Uint128 max_end6; // end of the last IPv6 block
+    bt::Uint32 reserved2[4];
+};
+
+static_assert(sizeof(IPBlockListHeader) == 64, "IPBlockListHeader must be one cache line");
+
+/// Description of one of the block lists a filter file was built from
+struct IPBlockListSource {
+    bt::Uint32 num_blocks; // number of IPv4 blocks in the list
+    bt::Uint32 num_blocks6; // number of IPv6 blocks in the list
+    char name[248]; // UTF-8, nul terminated
+};
+
+static_assert(sizeof(IPBlockListSource) == 256, "IPBlockListSource is stored as is in level1.dat");
+
 /**
  * @author Ivan Vasic <ivasic@gmail.com>
  * @brief This class is used to manage anti-p2p filter list, so called level1.
@@ -45,20 +114,125 @@ public:
     bool isBlockedIP(bt::Uint32 ip);
 
     /**
-     * Loads filter file
+     * Loads filter file. The file is memory mapped and searched in place,
+     * so this does not depend on the number of blocks in the file. Files
+     * converted by older versions are indexed in memory.
      * @param path The file to load
      * @return true upon success, false otherwise
      */
     bool load(const QString &path);
 
     /**
-     * Add a single block
+     * Verify the checksum of a loaded filter file. This touches every block,
+     * so it is only done after a conversion, not on every load.
+     * @return true if the checksum matches or there is no checksum
+     */
+    bool verify() const;
+
+    /**
+     * Add a single IPv4 block, blocks must be added in sorted order and may not overlap.
+     * This unloads any loaded filter file. The added blocks are indexed all at once,
+     * on the first lookup after adding them, so adding them one by one is not quadratic.
      * @param block
      */
     void addBlock(const IPBlock &block);
 
+    /**
+     * Add a list of blocks, see addBlock.
+     * @param blocks
+     */
+    void addBlocks(const QList<IPBlock> &blocks);
+
+    /**
+     * Add a single IPv6 block, see addBlock.
+     * @param block
+     */
+    void addBlock(const IPBlock6 &block);
+
+    /**
+     * Add a list of IPv6 blocks, see addBlock.
+     * @param blocks
+     */
+    void addBlocks(const QList<IPBlock6> &blocks);
+
+    /// Get the number of IPv4 blocks
+    bt::Uint32 count() const
+    {
+        buildAdded();
+        return index.count();
+    }
+
+    /// Get the number of IPv6 blocks
+    bt::Uint32 count6() const
+    {
+        buildAdded();
+        return index6.count();
+    }
+
+    /// Get the number of block lists the filter file was built from
+    bt::Uint32 numSources() const
+    {
+        return num_sources;
+    }
+
+    /// Get the name of a source (the URL it was downloaded from)
+    QString sourceName(bt::Uint32 source) const;
+
+    /// Get the number of IPv4 blocks in a source
+    bt::Uint32 sourceCount(bt::Uint32 source) const;
+
+    /// Get the number of IPv6 blocks in a source
+    bt::Uint32 sourceCount6(bt::Uint32 source) const;
+
+    /// Get the number of blocked addresses which matched a range of a source
+    bt::Uint64 sourceHits(bt::Uint32 source) const;
+
+    /**
+     * Calculate the checksum which is stored in the header of level1.dat
+     * @param data The data, a multiple of 4 bytes
+     * @param size Size of the data
+     * @param hash Result of a previous call, to checksum data in multiple parts
+     */
+    static bt::Uint32 checksum(const void *data, bt::Uint64 size, bt::Uint32 hash = 2166136261u);
+
+    /// Set the counters to update on lookups, nullptr to not count anything
+    void setStats(BlockListStats *s)
+    {
+        stats = s;
+    }
+
+private:
+    void unload();
+    void unloadFile();
+    void buildIndex(const IPBlock *blocks, bt::Uint32 num_blocks) const;
+
+    /// Index the added blocks if blocks were added since the last lookup
+    void buildAdded() const
+    {
+        if (added_dirty.load(std::memory_order_acquire))
+            buildAddedIndex();
+    }
+    void buildAddedIndex() const;
+    void countHit(bt::Uint32 mask) const;
+
 private:
-    QList<IPBlock> blocks;
+    QScopedPointer<bt::MMapFile> file;
+    // built on the first lookup after blocks have been added
+    mutable RangeIndex index;
+    mutable RangeIndex6 index6;
+    const bt::Uint8 *mapped_nodes;
+    bt::Uint64 mapped_size;
+    bt::Uint32 expected_checksum;
+    const bt::Uint32 *source_masks;
+    const bt::Uint32 *source_masks6;
+    const IPBlockListSource *sources;
+    bt::Uint32 num_sources;
+    std::unique_ptr<std::atomic<bt::Uint64>[]> hits;
+    BlockListStats *stats;
+    QList<IPBlock> added_blocks;
+    QList<IPBlock6> added_blocks6;
+    mutable std::atomic<bool> added_dirty;
+    mutable QMutex build_mutex;
 };
 }
 #endif
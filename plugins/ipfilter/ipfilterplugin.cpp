@@ -42,6 +42,7 @@ IPFilterPlugin::~IPFilterPlugin()
 void IPFilterPlugin::load()
 {
     LogSystemManager::instance().registerSystem(i18n("IP Filter"), SYS_IPF);
+    AccessManager::instance().addBlockList(&ip_filter);
     pref = new IPBlockingPrefPage(this);
     connect(pref, &IPBlockingPrefPage::updateFinished, this, &IPFilterPlugin::checkAutoUpdate);
     getGUI()->addPrefPage(pref);
@@ -58,39 +59,40 @@ void IPFilterPlugin::unload()
     getGUI()->removePrefPage(pref);
     delete pref;
     pref = nullptr;
-    if (ip_filter) {
-        AccessManager::instance().removeBlockList(ip_filter.data());
-        ip_filter.reset();
-    }
+    AccessManager::instance().removeBlockList(&ip_filter);
+    ip_filter.publish(nullptr);
 }
 
 bool IPFilterPlugin::loadAntiP2P()
 {
-    if (ip_filter)
+    if (ip_filter.loaded())
         return true;
 
-    ip_filter.reset(new IPBlockList());
-    if (!ip_filter->load(kt::DataDir() + QStringLiteral("level1.dat"))) {
-        ip_filter.reset();
+    return reloadAntiP2P();
+}
+
+bool IPFilterPlugin::reloadAntiP2P()
+{
+    // Loading only maps the file and checks the header, the index in it was built by the ConvertThread
+    IPBlockList *list = new IPBlockList();
+    if (!list->load(kt::DataDir() + QStringLiteral("level1.dat"))) {
+        delete list;
         return false;
     }
-    AccessManager::instance().addBlockList(ip_filter.data());
+
+    ip_filter.publish(list);
     return true;
 }
 
 bool IPFilterPlugin::unloadAntiP2P()
 {
-    if (ip_filter) {
-        AccessManager::instance().removeBlockList(ip_filter.data());
-        ip_filter.reset();
-        return true;
-    } else
-        return true;
+    ip_filter.publish(nullptr);
+    return true;
 }
 
 bool IPFilterPlugin::loadedAndRunning()
 {
-    return !ip_filter.isNull();
+    return ip_filter.loaded();
 }
 
 void IPFilterPlugin::checkAutoUpdate()
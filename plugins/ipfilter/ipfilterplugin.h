@@ -6,8 +6,8 @@
 #ifndef KTIPFILTERPLUGIN_H
 #define KTIPFILTERPLUGIN_H
 
+#include "blocklistholder.h"
 #include "ipblockingprefpage.h"
-#include "ipblocklist.h"
 #include <QTimer>
 #include <interfaces/plugin.h>
 
@@ -44,16 +44,25 @@ public:
     /// Unloads the anti-p2p filter list
     bool unloadAntiP2P();
 
+    /// Loads a new version of the anti-p2p filter list, and swaps it with the current one
+    bool reloadAntiP2P();
+
     /// Whether or not the IP filter is loaded and running
     bool loadedAndRunning();
 
+    /// Get the loaded filter list, nullptr if there is none
+    const IPBlockList *filterList() const
+    {
+        return ip_filter.list();
+    }
+
 public Q_SLOTS:
     void checkAutoUpdate();
     void notification(const QString &msg);
 
 private:
     IPBlockingPrefPage *pref;
-    QScopedPointer<IPBlockList> ip_filter;
+    BlockListHolder ip_filter;
     QTimer auto_update_timer;
 };
 
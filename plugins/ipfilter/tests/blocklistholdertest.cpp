@@ -0,0 +1,83 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "../blocklistholder.h"
+#include "../ipblocklist.h"
+#include <QThreadPool>
+#include <QtTest>
+#include <atomic>
+#include <net/address.h>
+#include <util/log.h>
+
+class BlockListHolderTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("blocklistholdertest.log"), false, true);
+    }
+
+    void testPublish()
+    {
+        kt::BlockListHolder holder;
+        const net::Address addr(QStringLiteral("10.1.2.3"), 0);
+        QVERIFY(!holder.loaded());
+        QVERIFY(!holder.blocked(addr));
+
+        holder.publish(makeList(QStringLiteral("10.0.0.0"), QStringLiteral("10.255.255.255")));
+        QVERIFY(holder.loaded());
+        QVERIFY(holder.blocked(addr));
+
+        holder.publish(makeList(QStringLiteral("11.0.0.0"), QStringLiteral("11.255.255.255")));
+        QVERIFY(!holder.blocked(addr));
+        QVERIFY(holder.blocked(net::Address(QStringLiteral("11.1.2.3"), 0)));
+
+        holder.publish(nullptr);
+        QVERIFY(!holder.loaded());
+        QVERIFY(!holder.blocked(addr));
+    }
+
+    void testSwapUnderLoad()
+    {
+        kt::BlockListHolder holder;
+        holder.publish(makeList(QStringLiteral("10.0.0.0"), QStringLiteral("10.255.255.255")));
+
+        // Every list blocks 10.0.0.0/8, so readers must always see it blocked, whichever list they get
+        std::atomic<bool> stop(false);
+        std::atomic<int> misses(0);
+        QThreadPool pool;
+        for (int i = 0; i < 4; i++) {
+            pool.start([&holder, &stop, &misses]() {
+                const net::Address addr(QStringLiteral("10.1.2.3"), 0);
+                while (!stop.load()) {
+                    if (!holder.blocked(addr))
+                        misses++;
+                }
+            });
+        }
+
+        for (int i = 0; i < 200; i++) {
+            holder.publish(makeList(QStringLiteral("10.0.0.0"), QStringLiteral("10.255.255.255")));
+            QTest::qWait(1);
+        }
+
+        stop = true;
+        pool.waitForDone();
+        QCOMPARE(misses.load(), 0);
+    }
+
+private:
+    kt::IPBlockList *makeList(const QString &start, const QString &end)
+    {
+        kt::IPBlockList *list = new kt::IPBlockList();
+        list->addBlock(kt::IPBlock(start, end));
+        return list;
+    }
+};
+
+QTEST_MAIN(BlockListHolderTest)
+
+#include "blocklistholdertest.moc"
@@ -0,0 +1,139 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "../blocklistparser.h"
+#include <QBuffer>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QtTest>
+#include <algorithm>
+#include <regex>
+#include <string>
+#include <vector>
+#include <util/log.h>
+
+static const int NUM_LINES = 300000;
+
+/**
+ * Conversion of a text block list the way ConvertThread used to do it: a QTextStream,
+ * a regular expression per line, a comparison sort and a merge which erases from the
+ * list. Kept here as the reference to compare against.
+ */
+static QList<kt::IPBlock> RegexConvert(const QByteArray &data)
+{
+    QList<kt::IPBlock> input;
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QTextStream stream(&buffer);
+
+    const std::regex rx("(?:[0-9]{1,3}\\.){3}[0-9]{1,3}");
+    while (!stream.atEnd()) {
+        std::string line = stream.readLine().toStdString();
+        std::vector<std::string> addresses;
+        for (auto it = std::sregex_iterator(line.begin(), line.end(), rx); it != std::sregex_iterator(); ++it)
+            addresses.push_back(it->str());
+
+        if (addresses.size() == 2)
+            input += kt::IPBlock(QString::fromStdString(addresses[0]), QString::fromStdString(addresses[1]));
+    }
+
+    std::sort(input.begin(), input.end(), [](const kt::IPBlock &a, const kt::IPBlock &b) {
+        return a.ip1 == b.ip1 ? a.ip2 < b.ip2 : a.ip1 < b.ip1;
+    });
+
+    if (input.count() < 2)
+        return input;
+
+    QList<kt::IPBlock>::iterator i = input.begin();
+    QList<kt::IPBlock>::iterator j = i + 1;
+    while (j != input.end()) {
+        if (i->ip2 < j->ip1) {
+            i = j;
+            j++;
+        } else {
+            i->ip2 = qMax(i->ip2, j->ip2);
+            j = input.erase(j);
+        }
+    }
+    return input;
+}
+
+static QList<kt::IPBlock> ParserConvert(const QByteArray &data)
+{
+    kt::BlockListParser parser;
+    parser.parseParallel(data.constData(), data.size(), kt::BlockListParser::ProgressCallback(), nullptr);
+    QList<kt::IPBlock> blocks = parser.blocks();
+    kt::SortBlocks(blocks);
+    kt::MergeBlocks(blocks);
+    return blocks;
+}
+
+static QByteArray Quad(bt::Uint32 ip)
+{
+    return QByteArray::number(ip >> 24) + '.' + QByteArray::number((ip >> 16) & 0xFF) + '.' + QByteArray::number((ip >> 8) & 0xFF) + '.'
+        + QByteArray::number(ip & 0xFF);
+}
+
+class BlockListParserBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("blocklistparserbenchmark.log"), false, true);
+
+        // Synthetic p2p format list, in random order with some overlapping ranges and comments
+        QRandomGenerator rng(42);
+        for (int i = 0; i < NUM_LINES; i++) {
+            if (i % 100 == 0) {
+                data += "# comment line\n";
+                continue;
+            }
+
+            bt::Uint32 start = rng.generate();
+            bt::Uint32 end = start + rng.bounded(65536);
+            if (end < start)
+                end = 0xFFFFFFFF;
+            data += "Some Organization " + QByteArray::number(i) + ':' + Quad(start) + '-' + Quad(end) + '\n';
+        }
+    }
+
+    void testSameResults()
+    {
+        QList<kt::IPBlock> expected = RegexConvert(data);
+        QList<kt::IPBlock> result = ParserConvert(data);
+        QCOMPARE(result.count(), expected.count());
+        for (qsizetype i = 0; i < result.count(); i++) {
+            QCOMPARE(result[i].ip1, expected[i].ip1);
+            QCOMPARE(result[i].ip2, expected[i].ip2);
+        }
+    }
+
+    void benchmarkRegex()
+    {
+        qsizetype n = 0;
+        QBENCHMARK {
+            n = RegexConvert(data).count();
+        }
+        QVERIFY(n > 0);
+    }
+
+    void benchmarkParser()
+    {
+        qsizetype n = 0;
+        QBENCHMARK {
+            n = ParserConvert(data).count();
+        }
+        QVERIFY(n > 0);
+    }
+
+private:
+    QByteArray data;
+};
+
+QTEST_MAIN(BlockListParserBenchmark)
+
+#include "blocklistparserbenchmark.moc"
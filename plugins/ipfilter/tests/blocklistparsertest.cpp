@@ -0,0 +1,134 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "../blocklistparser.h"
+#include <QtTest>
+#include <util/log.h>
+
+class BlockListParserTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("blocklistparsertest.log"), false, true);
+    }
+
+    void testIPv4()
+    {
+        const QByteArray data(
+            "# comment\r\n"
+            "Some Inc:1.2.3.0-1.2.3.255\r\n"
+            "010.000.000.000 - 010.255.255.255 , 000 , Private\n"
+            "Broken:1.2.3.4-1.2.3.256\n"
+            "Three:1.1.1.1-2.2.2.2 3.3.3.3\n"
+            "Reversed:9.9.9.9-8.8.8.8");
+
+        kt::BlockListParser parser;
+        parser.parse(data.constData(), data.size());
+        QCOMPARE(parser.numLines(), bt::Uint64(6));
+        QCOMPARE(parser.blocks().count(), 3);
+        QCOMPARE(parser.blocks()[0].ip1, 0x01020300u);
+        QCOMPARE(parser.blocks()[0].ip2, 0x010203FFu);
+        QCOMPARE(parser.blocks()[1].ip1, 0x0A000000u);
+        QCOMPARE(parser.blocks()[1].ip2, 0x0AFFFFFFu);
+        QCOMPARE(parser.blocks()[2].ip1, 0x08080808u);
+        QCOMPARE(parser.blocks()[2].ip2, 0x09090909u);
+        QVERIFY(parser.blocks6().isEmpty());
+    }
+
+    void testIPv6()
+    {
+        const QByteArray data(
+            "Cafe Inc:2001:db8::1-2001:db8::ff\n"
+            "2001:db8:1::/48\n"
+            "No addresses here\n");
+
+        kt::BlockListParser parser;
+        parser.parse(data.constData(), data.size());
+        QCOMPARE(parser.blocks6().count(), 2);
+
+        const kt::IPBlock6 &a = parser.blocks6()[0];
+        QCOMPARE(a.ip1.hi, 0x20010DB800000000ULL);
+        QCOMPARE(a.ip1.lo, 0x1ULL);
+        QCOMPARE(a.ip2.lo, 0xFFULL);
+
+        const kt::IPBlock6 &b = parser.blocks6()[1];
+        QCOMPARE(b.ip1.hi, 0x20010DB800010000ULL);
+        QCOMPARE(b.ip1.lo, 0x0ULL);
+        QCOMPARE(b.ip2.hi, 0x20010DB80001FFFFULL);
+        QCOMPARE(b.ip2.lo, 0xFFFFFFFFFFFFFFFFULL);
+    }
+
+    void testSortAndMerge()
+    {
+        QList<kt::IPBlock> blocks;
+        blocks << kt::IPBlock(QStringLiteral("10.0.0.0"), QStringLiteral("10.0.0.20"));
+        blocks << kt::IPBlock(QStringLiteral("1.0.0.0"), QStringLiteral("1.0.0.10"));
+        blocks << kt::IPBlock(QStringLiteral("10.0.0.5"), QStringLiteral("10.0.0.30"));
+        blocks << kt::IPBlock(QStringLiteral("1.0.0.11"), QStringLiteral("1.0.0.12"));
+        blocks << kt::IPBlock(QStringLiteral("10.0.0.10"), QStringLiteral("10.0.0.15"));
+
+        kt::SortBlocks(blocks);
+        kt::MergeBlocks(blocks);
+        QCOMPARE(blocks.count(), 3);
+        QCOMPARE(blocks[0].ip1, 0x01000000u);
+        QCOMPARE(blocks[0].ip2, 0x0100000Au);
+        QCOMPARE(blocks[1].ip1, 0x0100000Bu);
+        QCOMPARE(blocks[2].ip1, 0x0A000000u);
+        QCOMPARE(blocks[2].ip2, 0x0A00001Eu);
+    }
+
+    void testMergeSources()
+    {
+        QList<kt::BlockListSource> sources(3);
+        sources[0].blocks << kt::IPBlock(QStringLiteral("1.0.0.0"), QStringLiteral("1.0.0.10"));
+        sources[0].blocks << kt::IPBlock(QStringLiteral("10.0.0.0"), QStringLiteral("10.0.0.20"));
+        sources[1].blocks << kt::IPBlock(QStringLiteral("5.0.0.0"), QStringLiteral("5.0.0.10"));
+        sources[1].blocks << kt::IPBlock(QStringLiteral("10.0.0.15"), QStringLiteral("10.0.0.30"));
+        sources[2].blocks << kt::IPBlock(QStringLiteral("10.0.0.25"), QStringLiteral("10.0.0.40"));
+
+        QList<kt::IPBlock> blocks;
+        QList<bt::Uint32> masks;
+        kt::MergeSources(sources, blocks, masks);
+        QCOMPARE(blocks.count(), 7);
+        QCOMPARE(masks.count(), 7);
+        QCOMPARE(blocks[0].ip1, 0x01000000u);
+        QCOMPARE(masks[0], 0x1u);
+        QCOMPARE(blocks[1].ip1, 0x05000000u);
+        QCOMPARE(masks[1], 0x2u);
+
+        // overlapping blocks are split, so every part has exactly the sources which cover it
+        const bt::Uint32 ends[] = {0x0A00000Eu, 0x0A000014u, 0x0A000018u, 0x0A00001Eu, 0x0A000028u};
+        const bt::Uint32 expected[] = {0x1u, 0x3u, 0x2u, 0x6u, 0x4u};
+        bt::Uint32 start = 0x0A000000u;
+        for (int i = 0; i < 5; i++) {
+            QCOMPARE(blocks[i + 2].ip1, start);
+            QCOMPARE(blocks[i + 2].ip2, ends[i]);
+            QCOMPARE(masks[i + 2], expected[i]);
+            start = ends[i] + 1;
+        }
+
+        // adjacent parts with the same sources are one block, also at the end of the address space
+        sources = QList<kt::BlockListSource>(2);
+        sources[0].blocks << kt::IPBlock(QStringLiteral("1.0.0.0"), QStringLiteral("255.255.255.255"));
+        sources[1].blocks << kt::IPBlock(QStringLiteral("1.0.0.0"), QStringLiteral("1.0.0.9"));
+        sources[1].blocks << kt::IPBlock(QStringLiteral("1.0.0.10"), QStringLiteral("255.255.255.255"));
+        kt::MergeSources(sources, blocks, masks);
+        QCOMPARE(blocks.count(), 1);
+        QCOMPARE(blocks[0].ip1, 0x01000000u);
+        QCOMPARE(blocks[0].ip2, 0xFFFFFFFFu);
+        QCOMPARE(masks[0], 0x3u);
+
+        QList<kt::IPBlock6> blocks6;
+        kt::MergeSources(sources, blocks6, masks);
+        QVERIFY(blocks6.isEmpty());
+        QVERIFY(masks.isEmpty());
+    }
+};
+
+QTEST_MAIN(BlockListParserTest)
+
+#include "blocklistparsertest.moc"
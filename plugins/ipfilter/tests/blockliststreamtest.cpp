@@ -0,0 +1,145 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "../blockliststream.h"
+#include <KCompressionDevice>
+#include <KIO/TransferJob>
+#include <QBuffer>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <util/log.h>
+
+class BlockListStreamTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("blockliststreamtest.log"), false, true);
+        QVERIFY(dir.isValid());
+
+        for (int i = 0; i < 20000; i++) {
+            text += "Range " + QByteArray::number(i) + ":" + QByteArray::number(i % 200) + ".0." + QByteArray::number(i % 250) + ".0-"
+                + QByteArray::number(i % 200) + ".0." + QByteArray::number(i % 250) + ".255\r\n";
+        }
+        text += "2001:db8::/32"; // no newline at the end
+
+        kt::BlockListParser parser;
+        parser.parse(text.constData(), text.size());
+        expected = parser.blocks();
+        expected6 = parser.blocks6();
+        QCOMPARE(expected.count(), 20000);
+        QCOMPARE(expected6.count(), 1);
+    }
+
+    void testText()
+    {
+        kt::BlockListStream stream(dir.filePath(QStringLiteral("text")));
+        feed(stream, text, 7);
+        QCOMPARE(stream.format(), kt::BlockListStream::TEXT);
+        checkResults(stream);
+    }
+
+    void testGZip()
+    {
+        QByteArray compressed;
+        QBuffer buffer(&compressed);
+        KCompressionDevice dev(&buffer, false, KCompressionDevice::GZip);
+        QVERIFY(dev.open(QIODevice::WriteOnly));
+        QCOMPARE(dev.write(text), qint64(text.size()));
+        dev.close();
+
+        kt::BlockListStream stream(dir.filePath(QStringLiteral("gzip")));
+        feed(stream, compressed, 1000);
+        QCOMPARE(stream.format(), kt::BlockListStream::GZIP);
+        QCOMPARE(stream.decompressedSize(), bt::Uint64(text.size()));
+        checkResults(stream);
+    }
+
+    void testTruncatedGZip()
+    {
+        QByteArray compressed;
+        QBuffer buffer(&compressed);
+        KCompressionDevice dev(&buffer, false, KCompressionDevice::GZip);
+        QVERIFY(dev.open(QIODevice::WriteOnly));
+        dev.write(text);
+        dev.close();
+
+        kt::BlockListStream stream(dir.filePath(QStringLiteral("truncated")));
+        QVERIFY(stream.write(compressed.left(compressed.size() / 2)));
+        QVERIFY(!stream.finish());
+    }
+
+    void testOther()
+    {
+        QByteArray zip("PK\x03\x04", 4);
+        zip += QByteArray(10000, '\0');
+        const QString path = dir.filePath(QStringLiteral("other"));
+        kt::BlockListStream stream(path);
+        feed(stream, zip, 333);
+        QCOMPARE(stream.format(), kt::BlockListStream::OTHER);
+
+        QFile fptr(path);
+        QVERIFY(fptr.open(QIODevice::ReadOnly));
+        QCOMPARE(fptr.readAll(), zip);
+    }
+
+    void testLocalUrl()
+    {
+        const QString path = dir.filePath(QStringLiteral("level1.txt"));
+        QFile fptr(path);
+        QVERIFY(fptr.open(QIODevice::WriteOnly));
+        fptr.write(text);
+        fptr.close();
+
+        kt::BlockListStream stream(dir.filePath(QStringLiteral("download")));
+        bool ok = true;
+        KIO::TransferJob *job = KIO::get(QUrl::fromLocalFile(path), KIO::NoReload, KIO::HideProgressInfo);
+        connect(job, &KIO::TransferJob::data, this, [&stream, &ok](KIO::Job *, const QByteArray &data) {
+            ok = ok && stream.write(data);
+        });
+
+        QSignalSpy spy(job, &KJob::result);
+        QVERIFY(spy.wait(10000));
+        QCOMPARE(job->error(), 0);
+        QVERIFY(ok);
+        QVERIFY(stream.finish());
+        checkResults(stream);
+    }
+
+private:
+    void feed(kt::BlockListStream &stream, const QByteArray &data, int chunk_size)
+    {
+        for (int i = 0; i < data.size(); i += chunk_size)
+            QVERIFY(stream.write(data.mid(i, chunk_size)));
+        QVERIFY(stream.finish());
+    }
+
+    void checkResults(kt::BlockListStream &stream)
+    {
+        const QList<kt::IPBlock> &blocks = stream.parser().blocks();
+        QCOMPARE(blocks.count(), expected.count());
+        for (qsizetype i = 0; i < blocks.count(); i++) {
+            QCOMPARE(blocks[i].ip1, expected[i].ip1);
+            QCOMPARE(blocks[i].ip2, expected[i].ip2);
+        }
+
+        const QList<kt::IPBlock6> &blocks6 = stream.parser().blocks6();
+        QCOMPARE(blocks6.count(), expected6.count());
+        QVERIFY(blocks6[0].ip1 == expected6[0].ip1);
+        QVERIFY(blocks6[0].ip2 == expected6[0].ip2);
+    }
+
+private:
+    QTemporaryDir dir;
+    QByteArray text;
+    QList<kt::IPBlock> expected;
+    QList<kt::IPBlock6> expected6;
+};
+
+QTEST_MAIN(BlockListStreamTest)
+
+#include "blockliststreamtest.moc"
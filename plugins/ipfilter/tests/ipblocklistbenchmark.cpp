@@ -0,0 +1,101 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent developers
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "../ipblocklist.h"
+#include <QRandomGenerator>
+#include <QtTest>
+#include <net/address.h>
+#include <util/log.h>
+
+static const bt::Uint32 NUM_RANGES = 500000;
+static const int NUM_LOOKUPS = 1000000;
+
+/**
+ * Binary search over a QList of blocks, the way IPBlockList::blocked used
+ * to work. Kept here as the reference to compare against.
+ */
+static bool BinarySearchBlocked(const QList<kt::IPBlock> &blocks, bt::Uint32 ip)
+{
+    int begin = 0;
+    int end = blocks.size() - 1;
+    while (begin <= end) {
+        int pivot = begin + (end - begin) / 2;
+        if (blocks[pivot].contains(ip))
+            return true;
+        else if (ip < blocks[pivot].ip1)
+            end = pivot - 1;
+        else
+            begin = pivot + 1;
+    }
+    return false;
+}
+
+class IPBlockListBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("ipblocklistbenchmark.log"), false, true);
+
+        // Synthetic list of disjoint ranges spread over the whole address space
+        QRandomGenerator rng(42);
+        const bt::Uint32 step = 0xFFFFFFFFu / NUM_RANGES;
+        for (bt::Uint32 i = 0; i < NUM_RANGES; i++) {
+            kt::IPBlock b;
+            b.ip1 = i * step + rng.bounded(step / 2);
+            b.ip2 = b.ip1 + rng.bounded(step / 2);
+            blocks << b;
+        }
+        block_list.addBlocks(blocks);
+
+        addresses.reserve(NUM_LOOKUPS);
+        for (int i = 0; i < NUM_LOOKUPS; i++)
+            addresses << net::Address(QHostAddress(rng.generate()), 0);
+    }
+
+    void testSameResults()
+    {
+        for (const net::Address &addr : std::as_const(addresses))
+            QCOMPARE(block_list.blocked(addr), BinarySearchBlocked(blocks, addr.toIPv4Address()));
+    }
+
+    void benchmarkBinarySearch()
+    {
+        int hits = 0;
+        QBENCHMARK {
+            for (const net::Address &addr : std::as_const(addresses))
+                hits += BinarySearchBlocked(blocks, addr.toIPv4Address()) ? 1 : 0;
+        }
+        report(hits);
+    }
+
+    void benchmarkIPBlockList()
+    {
+        int hits = 0;
+        QBENCHMARK {
+            for (const net::Address &addr : std::as_const(addresses))
+                hits += block_list.blocked(addr) ? 1 : 0;
+        }
+        report(hits);
+    }
+
+private:
+    void report(int hits)
+    {
+        // Keep the compiler from optimizing the lookups away
+        QVERIFY(hits >= 0);
+        qDebug() << NUM_LOOKUPS << "lookups per iteration in" << NUM_RANGES << "ranges";
+    }
+
+private:
+    QList<kt::IPBlock> blocks;
+    kt::IPBlockList block_list;
+    QList<net::Address> addresses;
+};
+
+QTEST_MAIN(IPBlockListBenchmark)
+
+#include "ipblocklistbenchmark.moc"
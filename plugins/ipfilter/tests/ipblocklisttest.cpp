@@ -4,7 +4,10 @@
 */
 
 #include "../ipblocklist.h"
+#include <QTemporaryDir>
 #include <QtTest>
+#include <cstring>
+#include <vector>
 #include <net/address.h>
 #include <util/log.h>
 
@@ -41,7 +44,131 @@ private Q_SLOTS:
         QVERIFY(bl.blocked(net::Address(QStringLiteral("197.25.25.25"), 0)));
     }
 
+    void testLoad()
+    {
+        QList<kt::IPBlock> blocks;
+        blocks << kt::IPBlock(QStringLiteral("1.0.0.0"), QStringLiteral("50.255.255.255"));
+        blocks << kt::IPBlock(QStringLiteral("127.0.0.0"), QStringLiteral("127.255.255.255"));
+        blocks << kt::IPBlock(QStringLiteral("140.0.0.0"), QStringLiteral("200.255.255.255"));
+
+        std::vector<kt::RangeIndexNode> nodes(kt::RangeIndex::numNodes(blocks.count()));
+        kt::IPBlockListHeader hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, kt::IPBLOCKLIST_MAGIC, sizeof(kt::IPBLOCKLIST_MAGIC));
+        hdr.version = kt::IPBLOCKLIST_VERSION;
+        hdr.num_blocks = blocks.count();
+        hdr.max_end = kt::RangeIndex::build(nodes.data(), blocks.count(), [&blocks](bt::Uint32 i, bt::Uint32 &start, bt::Uint32 &end) {
+            start = blocks[i].ip1;
+            end = blocks[i].ip2;
+        });
+        hdr.checksum = kt::IPBlockList::checksum(nodes.data(), nodes.size() * sizeof(kt::RangeIndexNode));
+        QByteArray node_data((const char *)nodes.data(), nodes.size() * sizeof(kt::RangeIndexNode));
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        // Current format
+        QString path = dir.filePath(QStringLiteral("level1.dat"));
+        QVERIFY(writeFile(path, QByteArray((const char *)&hdr, sizeof(hdr)) + node_data));
+        kt::IPBlockList bl;
+        QVERIFY(bl.load(path));
+        QCOMPARE(bl.count(), (bt::Uint32)blocks.count());
+        QVERIFY(bl.verify());
+        QVERIFY(bl.blocked(net::Address(QStringLiteral("25.25.25.25"), 0)));
+        QVERIFY(!bl.blocked(net::Address(QStringLiteral("130.255.255.255"), 0)));
+        QVERIFY(bl.blocked(net::Address(QStringLiteral("197.25.25.25"), 0)));
+        QVERIFY(!bl.blocked(net::Address(QStringLiteral("255.255.255.255"), 0)));
+
+        // Corrupted data, header is fine but the checksum is wrong
+        hdr.checksum++;
+        QVERIFY(writeFile(path, QByteArray((const char *)&hdr, sizeof(hdr)) + node_data));
+        QVERIFY(bl.load(path));
+        QVERIFY(!bl.verify());
+
+        // Truncated file
+        QVERIFY(writeFile(path, QByteArray((const char *)&hdr, sizeof(hdr)) + node_data.left(12)));
+        QVERIFY(!bl.load(path));
+        QCOMPARE(bl.count(), (bt::Uint32)0);
+
+        // Headerless file written by older versions
+        QVERIFY(writeFile(path, blockData(blocks)));
+        QVERIFY(bl.load(path));
+        QCOMPARE(bl.count(), (bt::Uint32)blocks.count());
+        QVERIFY(bl.verify());
+        QVERIFY(bl.blocked(net::Address(QStringLiteral("127.25.25.25"), 0)));
+        QVERIFY(!bl.blocked(net::Address(QStringLiteral("75.25.25.25"), 0)));
+    }
+
+    void testIPv6()
+    {
+        kt::IPBlockList bl;
+        bl.addBlock(kt::IPBlock(QStringLiteral("127.0.0.0"), QStringLiteral("127.255.255.255")));
+        bl.addBlock(block6(QStringLiteral("2001:db8::"), QStringLiteral("2001:db8::ffff")));
+        bl.addBlock(block6(QStringLiteral("2001:db8:1::"), QStringLiteral("2001:db8:1:ffff:ffff:ffff:ffff:ffff")));
+        QCOMPARE(bl.count(), (bt::Uint32)1);
+        QCOMPARE(bl.count6(), (bt::Uint32)2);
+
+        QVERIFY(bl.blocked(net::Address(QStringLiteral("2001:db8::1"), 0)));
+        QVERIFY(bl.blocked(net::Address(QStringLiteral("2001:db8::ffff"), 0)));
+        QVERIFY(!bl.blocked(net::Address(QStringLiteral("2001:db8::1:0"), 0)));
+        QVERIFY(bl.blocked(net::Address(QStringLiteral("2001:db8:1:abcd::1"), 0)));
+        QVERIFY(!bl.blocked(net::Address(QStringLiteral("2001:db8:2::"), 0)));
+        QVERIFY(!bl.blocked(net::Address(QStringLiteral("::1"), 0)));
+
+        // IPv4 mapped addresses are checked against the IPv4 blocks
+        QVERIFY(bl.blocked(net::Address(QStringLiteral("::ffff:127.0.0.1"), 0)));
+        QVERIFY(!bl.blocked(net::Address(QStringLiteral("::ffff:128.0.0.1"), 0)));
+        QVERIFY(bl.blocked(net::Address(QStringLiteral("127.0.0.1"), 0)));
+    }
+
+    void testManyBlocks()
+    {
+        // Enough blocks for a tree of several levels
+        QList<kt::IPBlock> blocks;
+        for (bt::Uint32 i = 0; i < 10000; i++) {
+            kt::IPBlock b;
+            b.ip1 = i * 1000 + 100;
+            b.ip2 = i * 1000 + 199;
+            blocks << b;
+        }
+
+        kt::IPBlockList bl;
+        bl.addBlocks(blocks);
+        QCOMPARE(bl.count(), (bt::Uint32)blocks.count());
+        for (bt::Uint32 i = 0; i < 10000; i++) {
+            QVERIFY(!bl.blocked(net::Address(QHostAddress(i * 1000 + 99), 0)));
+            QVERIFY(bl.blocked(net::Address(QHostAddress(i * 1000 + 100), 0)));
+            QVERIFY(bl.blocked(net::Address(QHostAddress(i * 1000 + 150), 0)));
+            QVERIFY(bl.blocked(net::Address(QHostAddress(i * 1000 + 199), 0)));
+            QVERIFY(!bl.blocked(net::Address(QHostAddress(i * 1000 + 200), 0)));
+        }
+        QVERIFY(!bl.blocked(net::Address(QHostAddress(0u), 0)));
+        QVERIFY(!bl.blocked(net::Address(QHostAddress(0xFFFFFFFFu), 0)));
+    }
+
 private:
+    static kt::IPBlock6 block6(const QString &start, const QString &end)
+    {
+        Q_IPV6ADDR s = QHostAddress(start).toIPv6Address();
+        Q_IPV6ADDR e = QHostAddress(end).toIPv6Address();
+        kt::IPBlock6 b;
+        b.ip1 = kt::Uint128::fromBytes(s.c);
+        b.ip2 = kt::Uint128::fromBytes(e.c);
+        return b;
+    }
+
+    static QByteArray blockData(const QList<kt::IPBlock> &blocks)
+    {
+        return QByteArray((const char *)blocks.constData(), blocks.count() * sizeof(kt::IPBlock));
+    }
+
+    static bool writeFile(const QString &path, const QByteArray &data)
+    {
+        QFile fptr(path);
+        if (!fptr.open(QIODevice::WriteOnly))
+            return false;
+        return fptr.write(data) == data.size();
+    }
 };
 
 QTEST_MAIN(IPBlockListTest)
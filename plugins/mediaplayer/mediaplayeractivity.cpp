@@ -77,6 +77,7 @@ MediaPlayerActivity::MediaPlayerActivity(CoreInterface *core, KActionCollection
     tabs->setTabBarAutoHide(true);
 
     connect(core, &CoreInterface::torrentAdded, media_model, &MediaModel::onTorrentAdded);
+    connect(core, &CoreInterface::torrentLoaded, media_model, &MediaModel::onTorrentAdded);
     connect(core, &CoreInterface::torrentRemoved, media_model, &MediaModel::onTorrentRemoved);
     connect(media_player, &MediaPlayer::enableActions, this, &MediaPlayerActivity::enableActions);
     connect(media_player, &MediaPlayer::openVideo, this, &MediaPlayerActivity::openVideo);
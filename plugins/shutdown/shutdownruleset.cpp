@@ -27,6 +27,7 @@ ShutdownRuleSet::ShutdownRuleSet(kt::CoreInterface *core, QObject *parent)
     , all_rules_must_be_hit(false)
 {
     connect(core, &CoreInterface::torrentAdded, this, &ShutdownRuleSet::torrentAdded);
+    connect(core, &CoreInterface::torrentLoaded, this, &ShutdownRuleSet::torrentAdded);
     connect(core, &CoreInterface::torrentRemoved, this, &ShutdownRuleSet::torrentRemoved);
     QueueManager *qman = core->getQueueManager();
     for (QueueManager::iterator i = qman->begin(); i != qman->end(); i++) {
@@ -50,6 +51,8 @@ void ShutdownRuleSet::addRule(kt::Action action, kt::Target target, kt::Trigger
     rule.target = target;
     rule.trigger = trigger;
     rule.tc = tc;
+    if (tc)
+        rule.hash = tc->getInfoHash();
     rule.hit = false;
     rules.append(rule);
 }
@@ -107,6 +110,12 @@ void ShutdownRuleSet::torrentAdded(bt::TorrentInterface *tc)
 {
     connect(tc, &bt::TorrentInterface::seedingAutoStopped, this, &ShutdownRuleSet::seedingAutoStopped);
     connect(tc, &bt::TorrentInterface::finished, this, &ShutdownRuleSet::torrentFinished);
+
+    // Rules loaded before the torrent was
+    for (ShutdownRule &r : rules) {
+        if (r.target == SPECIFIC_TORRENT && !r.tc && r.hash == tc->getInfoHash())
+            r.tc = tc;
+    }
 }
 
 void ShutdownRuleSet::torrentRemoved(bt::TorrentInterface *tc)
@@ -141,9 +150,8 @@ void ShutdownRuleSet::save(const QString &file)
         enc.write("Trigger", (bt::Uint32)i->trigger);
         enc.write("Target", (bt::Uint32)i->target);
         if (i->target == SPECIFIC_TORRENT) {
-            bt::SHA1Hash hash = i->tc->getInfoHash();
             enc.write(QByteArrayLiteral("Torrent"));
-            enc.write(hash.getData(), 20);
+            enc.write(i->hash.getData(), 20);
         }
         enc.write(QByteArrayLiteral("hit"), i->hit);
         enc.end();
@@ -188,11 +196,12 @@ void ShutdownRuleSet::load(const QString &file)
             rule.tc = nullptr;
             if (d->getValue(QByteArrayLiteral("Torrent"))) {
                 const QByteArray hash = d->getByteArray(QByteArrayLiteral("Torrent"));
-                bt::TorrentInterface *const tc = torrentForHash(hash);
-                if (tc)
-                    rule.tc = tc;
-                else
-                    continue; // no valid torrent found so skip this rule
+                if (hash.size() != 20)
+                    continue;
+
+                // The torrent may not be loaded yet, torrentAdded picks it up then
+                rule.hash = bt::SHA1Hash((const bt::Uint8 *)hash.data());
+                rule.tc = torrentForHash(rule.hash);
             }
             rules.append(rule);
         }
@@ -209,17 +218,9 @@ void ShutdownRuleSet::load(const QString &file)
     delete node;
 }
 
-bt::TorrentInterface *ShutdownRuleSet::torrentForHash(const QByteArray &hash)
+bt::TorrentInterface *ShutdownRuleSet::torrentForHash(const bt::SHA1Hash &hash)
 {
-    bt::SHA1Hash ih((const bt::Uint8 *)hash.data());
-    QueueManager *qman = core->getQueueManager();
-    for (QueueManager::iterator i = qman->begin(); i != qman->end(); i++) {
-        bt::TorrentInterface *t = *i;
-        if (t->getInfoHash() == ih)
-            return t;
-    }
-
-    return nullptr;
+    return core->getQueueManager()->find(hash);
 }
 
 kt::Action ShutdownRuleSet::currentAction() const
@@ -324,14 +325,15 @@ bool ShutdownRule::seedingFinished(bt::TorrentInterface *tor, QueueManager *qman
 
 QString ShutdownRule::toolTip() const
 {
+    const QString name = tc ? tc->getDisplayName() : hash.toString();
     if (target == ALL_TORRENTS && trigger == kt::DOWNLOADING_COMPLETED)
         return i18n("<b>All torrents</b> finish downloading");
     else if (target == ALL_TORRENTS && trigger == kt::SEEDING_COMPLETED)
         return i18n("<b>All torrents</b> finish seeding");
     else if (target == SPECIFIC_TORRENT && trigger == kt::DOWNLOADING_COMPLETED)
-        return i18n("<b>%1</b> finishes downloading", tc->getDisplayName());
+        return i18n("<b>%1</b> finishes downloading", name);
     else if (target == SPECIFIC_TORRENT && trigger == kt::SEEDING_COMPLETED)
-        return i18n("<b>%1</b> finishes seeding", tc->getDisplayName());
+        return i18n("<b>%1</b> finishes seeding", name);
     else
         return QString();
 }
@@ -36,6 +36,7 @@ struct ShutdownRule {
     Target target;
     Action action;
     bt::TorrentInterface *tc;
+    bt::SHA1Hash hash; // info hash of tc, known before tc is loaded
     bool hit;
 
     bool downloadingFinished(bt::TorrentInterface *tor, QueueManager *qman);
@@ -129,7 +130,7 @@ private Q_SLOTS:
     void torrentRemoved(bt::TorrentInterface *tc);
 
 private:
-    bt::TorrentInterface *torrentForHash(const QByteArray &hash);
+    bt::TorrentInterface *torrentForHash(const bt::SHA1Hash &hash);
     void triggered(Trigger trigger, bt::TorrentInterface *tc);
 
 private:
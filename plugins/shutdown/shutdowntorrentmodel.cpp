@@ -25,6 +25,7 @@ ShutdownTorrentModel::ShutdownTorrentModel(CoreInterface *core, QObject *parent)
     }
 
     connect(core, &CoreInterface::torrentAdded, this, &ShutdownTorrentModel::torrentAdded);
+    connect(core, &CoreInterface::torrentLoaded, this, &ShutdownTorrentModel::torrentAdded);
     connect(core, &CoreInterface::torrentRemoved, this, &ShutdownTorrentModel::torrentRemoved);
 }
 
@@ -73,14 +73,12 @@ void LinkDownloader::downloadFinished(KJob *j)
     }
 
     if (isTorrent(job->data())) {
-        bt::TorrentInterface *tc = nullptr;
-        if (verbose)
-            tc = core->load(job->data(), url, group, location);
-        else
-            tc = core->loadSilently(job->data(), url, group, location);
-
-        if (tc && !move_on_completion.isEmpty())
-            tc->setMoveWhenCompletedDir(move_on_completion);
+        MagnetLinkLoadOptions options;
+        options.silently = !verbose;
+        options.group = group;
+        options.location = location;
+        options.move_on_completion = move_on_completion;
+        core->load(job->data(), url, options);
 
         Q_EMIT finished(true);
         deleteLater();
@@ -198,14 +196,12 @@ void LinkDownloader::torrentDownloadFinished(KJob *j)
         } else
             tryTorrentLinks();
     } else if (isTorrent(job->data())) {
-        bt::TorrentInterface *tc = nullptr;
-        if (verbose)
-            tc = core->load(job->data(), link_url, group, location);
-        else
-            tc = core->loadSilently(job->data(), link_url, group, location);
-
-        if (tc && !move_on_completion.isEmpty())
-            tc->setMoveWhenCompletedDir(move_on_completion);
+        MagnetLinkLoadOptions options;
+        options.silently = !verbose;
+        options.group = group;
+        options.location = location;
+        options.move_on_completion = move_on_completion;
+        core->load(job->data(), link_url, options);
 
         Q_EMIT finished(true);
         deleteLater();
@@ -33,6 +33,7 @@ void ZeroConfPlugin::load()
     LogSystemManager::instance().registerSystem(i18n("ZeroConf"), SYS_ZCO);
     CoreInterface *core = getCore();
     connect(core, &CoreInterface::torrentAdded, this, &ZeroConfPlugin::torrentAdded);
+    connect(core, &CoreInterface::torrentLoaded, this, &ZeroConfPlugin::torrentAdded);
     connect(core, &CoreInterface::torrentRemoved, this, &ZeroConfPlugin::torrentRemoved);
 
     // go over existing torrents and add them
@@ -47,6 +48,7 @@ void ZeroConfPlugin::unload()
     LogSystemManager::instance().unregisterSystem(i18n("ZeroConf"));
     CoreInterface *core = getCore();
     disconnect(core, &CoreInterface::torrentAdded, this, &ZeroConfPlugin::torrentAdded);
+    disconnect(core, &CoreInterface::torrentLoaded, this, &ZeroConfPlugin::torrentAdded);
     disconnect(core, &CoreInterface::torrentRemoved, this, &ZeroConfPlugin::torrentRemoved);
 
     bt::PtrMap<bt::TorrentInterface *, TorrentService>::iterator i = services.begin();